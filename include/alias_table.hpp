@@ -0,0 +1,86 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <numeric>
+#include <random>
+#include <vector>
+
+/**
+ * @brief Samples indices with given integer weights in constant time (Walker's
+ * alias method, built with Vose's algorithm).
+ *
+ * Every index owns one column of height `total_`. Column i keeps `threshold_`
+ * of its own weight and gives the rest to `alias_[i]`, so a sample is one
+ * uniform column and one uniform height. Weights are integers, so the
+ * probabilities are exact.
+ */
+class AliasTable {
+  public:
+    AliasTable() = default;
+
+    /**
+     * @brief Builds the table.
+     *
+     * @param weights Weight of every index. Zero weights are never sampled;
+     * at least one weight must be positive.
+     */
+    explicit AliasTable(const std::vector<std::uint64_t>& weights)
+        : threshold_(weights.size()), alias_(weights.size()) {
+        total_ = std::accumulate(weights.begin(), weights.end(),
+                                 std::uint64_t{0});
+        // Scale by n so that the mean column height is `total_`
+        const std::uint64_t      n = weights.size();
+        std::vector<std::uint64_t> scaled(weights.size());
+        std::vector<std::size_t>   small;
+        std::vector<std::size_t>   large;
+        for (std::size_t i = 0; i < weights.size(); ++i) {
+            scaled[i] = weights[i] * n;
+            (scaled[i] < total_ ? small : large).push_back(i);
+        }
+        while (!small.empty() && !large.empty()) {
+            const std::size_t s = small.back();
+            const std::size_t l = large.back();
+            small.pop_back();
+            threshold_[s] = scaled[s];
+            alias_[s]     = l;
+            scaled[l] -= total_ - scaled[s];
+            if (scaled[l] < total_) {
+                large.pop_back();
+                small.push_back(l);
+            }
+        }
+        for (std::size_t i : large) {
+            threshold_[i] = total_;
+            alias_[i]     = i;
+        }
+        for (std::size_t i : small) {
+            threshold_[i] = total_;
+            alias_[i]     = i;
+        }
+    }
+
+    /// @brief Number of indices.
+    std::size_t Size() const { return alias_.size(); }
+
+    /**
+     * @brief Draws an index with probability proportional to its weight.
+     *
+     * @param rng Uniform random bit generator.
+     */
+    template <typename Engine> std::size_t Sample(Engine& rng) const {
+        std::uniform_int_distribution<std::size_t>   column(0, Size() - 1);
+        std::uniform_int_distribution<std::uint64_t> height(0, total_ - 1);
+        const std::size_t                            i = column(rng);
+        return height(rng) < threshold_[i] ? i : alias_[i];
+    }
+
+  private:
+    /// @brief Sum of the weights: height of every column.
+    std::uint64_t total_{0};
+
+    /// @brief Height of every column that belongs to its own index.
+    std::vector<std::uint64_t> threshold_;
+
+    /// @brief Index that owns the rest of every column.
+    std::vector<std::size_t> alias_;
+};
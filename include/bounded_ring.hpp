@@ -0,0 +1,115 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+/**
+ * @brief Bounded queue that any number of threads can push to and pop from
+ * without locks (Vyukov's bounded MPMC queue).
+ *
+ * Every cell has a sequence number that tells whose turn it is: a pusher
+ * claims cell `tail_` when its sequence equals `tail_`, a popper claims cell
+ * `head_` when its sequence equals `head_ + 1`. Claims are one
+ * compare-and-swap; a full or empty queue fails at once instead of waiting.
+ *
+ * @tparam T Movable value type.
+ */
+template <typename T> class BoundedRing {
+  public:
+    /**
+     * @brief Creates an empty ring.
+     * @param capacity Minimum number of values, rounded up to a power of two.
+     */
+    explicit BoundedRing(std::size_t capacity)
+        : capacity_(std::bit_ceil(std::max<std::size_t>(capacity, 2))),
+          cells_(std::make_unique<cell[]>(capacity_)) {
+        for (std::size_t i = 0; i < capacity_; ++i) {
+            cells_[i].sequence_.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    BoundedRing(const BoundedRing&)            = delete;
+    BoundedRing& operator=(const BoundedRing&) = delete;
+
+    /**
+     * @brief Appends a value, unless the ring is full.
+     * @param value Value to append, moved from on success.
+     * @return false if the ring is full.
+     */
+    bool TryPush(T& value) {
+        std::size_t pos = tail_.load(std::memory_order_relaxed);
+        while (true) {
+            cell&             c   = cells_[pos & (capacity_ - 1)];
+            const std::size_t seq = c.sequence_.load(std::memory_order_acquire);
+            if (seq == pos) {
+                if (tail_.compare_exchange_weak(pos, pos + 1,
+                                                std::memory_order_relaxed)) {
+                    c.value_ = std::move(value);
+                    c.sequence_.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (seq < pos) {
+                return false;
+            } else {
+                pos = tail_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /**
+     * @brief Removes the oldest value, unless the ring is empty.
+     * @param value Receives the value on success.
+     * @return false if the ring is empty.
+     */
+    bool TryPop(T& value) {
+        std::size_t pos = head_.load(std::memory_order_relaxed);
+        while (true) {
+            cell&             c   = cells_[pos & (capacity_ - 1)];
+            const std::size_t seq = c.sequence_.load(std::memory_order_acquire);
+            if (seq == pos + 1) {
+                if (head_.compare_exchange_weak(pos, pos + 1,
+                                                std::memory_order_relaxed)) {
+                    value = std::move(c.value_);
+                    c.sequence_.store(pos + capacity_,
+                                      std::memory_order_release);
+                    return true;
+                }
+            } else if (seq < pos + 1) {
+                return false;
+            } else {
+                pos = head_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /**
+     * @brief Returns the number of values, exact when no thread is pushing or
+     * popping.
+     */
+    std::size_t Size() const {
+        const std::size_t head = head_.load(std::memory_order_acquire);
+        const std::size_t tail = tail_.load(std::memory_order_acquire);
+        return tail > head ? tail - head : 0;
+    }
+
+    /// @brief Maximum number of values.
+    std::size_t Capacity() const { return capacity_; }
+
+  private:
+    struct cell {
+        std::atomic<std::size_t> sequence_;
+        T                        value_;
+    };
+
+    std::size_t             capacity_;
+    std::unique_ptr<cell[]> cells_;
+
+    /// @brief Next position to pop, on its own cache line.
+    alignas(64) std::atomic<std::size_t> head_{0};
+
+    /// @brief Next position to push, on its own cache line.
+    alignas(64) std::atomic<std::size_t> tail_{0};
+};
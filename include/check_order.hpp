@@ -0,0 +1,96 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Order of checks that a candidate must all pass, adapted to the
+ * measured cost and rejection rate of every check.
+ *
+ * For independent checks, running them by increasing cost / rejection rate
+ * minimises the expected time spent on a candidate: a cheap check that
+ * rejects often goes first, an expensive check that seldom rejects goes
+ * last. The order is recomputed every REORDER_PERIOD_ candidates, and the
+ * measures are halved every DECAY_PERIOD_ candidates, so the order follows
+ * the candidates when they change, e.g. with the level.
+ *
+ * Checks are small numbers chosen by the caller. A check that has not run
+ * yet counts as one run of PRIOR_NS_ nanoseconds that rejected half of a
+ * candidate.
+ */
+class CheckOrder {
+  public:
+    /// @brief Candidates between two reorders.
+    static constexpr std::uint64_t REORDER_PERIOD_ = 64;
+
+    /// @brief Candidates between two halvings of the measures.
+    static constexpr std::uint64_t DECAY_PERIOD_ = 4096;
+
+    /// @brief Assumed cost of a check that has not run, in nanoseconds.
+    static constexpr double PRIOR_NS_ = 1000.0;
+
+    /**
+     * @brief Creates an order that starts as given.
+     * @param checks Every check, in the order to use until measured.
+     */
+    explicit CheckOrder(std::vector<std::uint8_t> checks)
+        : order_(std::move(checks)),
+          measures_(order_.empty() ? 0 : *std::ranges::max_element(order_) +
+                                             std::size_t{1}) {}
+
+    /// @brief Checks in the order to run them.
+    const std::vector<std::uint8_t>& Order() const { return order_; }
+
+    /**
+     * @brief Counts one run of a check. The order does not change before
+     * FinishCandidate, so a loop over Order can record as it goes.
+     */
+    void Record(std::uint8_t check, std::uint64_t ns, bool rejected) {
+        measure& m = measures_[check];
+        m.runs_ += 1;
+        m.rejections_ += rejected ? 1 : 0;
+        m.total_ns_ += static_cast<double>(ns);
+    }
+
+    /// @brief Ends the checks of a candidate, reordering them if it is time.
+    void FinishCandidate() {
+        ++candidates_;
+        if (candidates_ % DECAY_PERIOD_ == 0) {
+            for (measure& m : measures_) {
+                m.runs_ /= 2;
+                m.rejections_ /= 2;
+                m.total_ns_ /= 2;
+            }
+        }
+        if (candidates_ % REORDER_PERIOD_ == 0) {
+            std::ranges::stable_sort(order_, {}, [&](std::uint8_t check) {
+                return Rank(check);
+            });
+        }
+    }
+
+    /**
+     * @brief Returns the expected time the check spends per rejected
+     * candidate, in nanoseconds: its mean cost over its rejection rate.
+     */
+    double Rank(std::uint8_t check) const {
+        const measure& m    = measures_[check];
+        const double   cost = (m.total_ns_ + PRIOR_NS_) / (m.runs_ + 1.0);
+        const double   rate = (m.rejections_ + 0.5) / (m.runs_ + 1.0);
+        return cost / rate;
+    }
+
+  private:
+    /// @brief Runs, rejections and time of one check.
+    struct measure {
+        double runs_{0};
+        double rejections_{0};
+        double total_ns_{0};
+    };
+
+    std::vector<std::uint8_t> order_;
+    std::vector<measure>      measures_;
+    std::uint64_t             candidates_{0};
+};
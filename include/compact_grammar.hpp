@@ -0,0 +1,131 @@
+#pragma once
+#include "grammar.hpp"
+#include "symbol_table.hpp"
+#include <cstdint>
+#include <ranges>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief Flat, read-only representation of a grammar.
+ *
+ * Productions are stored in compressed sparse row (CSR) form: the right-hand
+ * sides of all productions live in one contiguous symbol array, and each
+ * production is identified by a stable index into per-production offset and
+ * antecedent arrays. Productions are grouped by antecedent, so the
+ * productions of every non-terminal form a contiguous index range.
+ *
+ * For a grammar with productions
+ *
+ *     S -> A $
+ *     A -> a A | EPSILON
+ *
+ * the arrays look like (ids shown as names):
+ *
+ *     symbols_     = [A, $, a, A, EPSILON]
+ *     rhs_offsets_ = [0, 2, 4, 5]
+ *     lhs_         = [S, A, A]
+ *
+ * Analyses iterate production indices linearly instead of walking the map of
+ * vectors of `Grammar::g_`. The compact grammar keeps its own copy of the
+ * symbol table, so it stays valid when the source grammar is edited.
+ */
+struct CompactGrammar {
+    CompactGrammar() = default;
+
+    /**
+     * @brief Builds the compact form of a grammar.
+     *
+     * Productions of each non-terminal keep the order they have in
+     * `grammar.g_`; non-terminals are laid out in symbol table order.
+     *
+     * @param grammar The grammar to flatten. Every symbol in `grammar.g_`
+     * must be interned in `grammar.st_`.
+     */
+    explicit CompactGrammar(const Grammar& grammar);
+
+    /**
+     * @brief Converts the compact grammar back to the map form.
+     *
+     * @return A Grammar with the same rules, axiom and symbol table.
+     */
+    Grammar ToGrammar() const;
+
+    /**
+     * @brief Returns the rules in the map form used by `Grammar::g_`.
+     */
+    std::unordered_map<std::string, std::vector<production>> ToRules() const;
+
+    /**
+     * @brief Number of productions in the grammar.
+     */
+    std::uint32_t ProductionCount() const {
+        return static_cast<std::uint32_t>(lhs_.size());
+    }
+
+    /**
+     * @brief Returns the antecedent of a production.
+     *
+     * @param p Index of the production.
+     */
+    SymbolId Lhs(std::uint32_t p) const { return lhs_[p]; }
+
+    /**
+     * @brief Returns the right-hand side of a production.
+     *
+     * @param p Index of the production.
+     * @return A view into the symbol arena.
+     */
+    std::span<const SymbolId> Rhs(std::uint32_t p) const {
+        return std::span<const SymbolId>(symbols_).subspan(
+            rhs_offsets_[p], rhs_offsets_[p + 1] - rhs_offsets_[p]);
+    }
+
+    /**
+     * @brief Returns the indices of the productions of a non-terminal.
+     *
+     * @param nt SymbolId of the non-terminal.
+     * @return A (possibly empty) contiguous range of production indices.
+     */
+    auto ProductionsOf(SymbolId nt) const {
+        if (nt >= st_.Size() || st_.IsTerminal(nt)) {
+            return std::views::iota(std::uint32_t{0}, std::uint32_t{0});
+        }
+        const std::uint32_t k = st_.kind_index_[nt];
+        return std::views::iota(nt_offsets_[k], nt_offsets_[k + 1]);
+    }
+
+    /**
+     * @brief Checks if a production is `A -> EPSILON`.
+     *
+     * @param p Index of the production.
+     */
+    bool IsEpsilon(std::uint32_t p) const {
+        std::span<const SymbolId> rhs = Rhs(p);
+        return rhs.size() == 1 && rhs[0] == SymbolTable::EPSILON_ID_;
+    }
+
+    /// @brief Symbol table of the grammar, copied from the source grammar.
+    SymbolTable st_;
+
+    /// @brief SymbolId of the axiom.
+    SymbolId axiom_{0};
+
+    /// @brief Right-hand sides of all productions, back to back.
+    std::vector<SymbolId> symbols_;
+
+    /// @brief Start of every production in `symbols_`, plus a final sentinel.
+    std::vector<std::uint32_t> rhs_offsets_{0};
+
+    /// @brief Antecedent of every production.
+    std::vector<SymbolId> lhs_;
+
+    /**
+     * @brief First production of every non-terminal, plus a final sentinel.
+     *
+     * Indexed by the non-terminal position (`SymbolTable::kind_index_`).
+     */
+    std::vector<std::uint32_t> nt_offsets_{0};
+};
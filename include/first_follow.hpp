@@ -0,0 +1,575 @@
+#pragma once
+#include "compact_grammar.hpp"
+#include "symbol_table.hpp"
+#include "terminal_set.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <unordered_set>
+#include <variant>
+#include <vector>
+
+/**
+ * @brief A list of index lists stored back to back (CSR layout), e.g. a graph
+ * over non-terminal positions where `lists[a]` holds the nodes `a` has an
+ * edge to.
+ *
+ * Lists are filled in order: push the items of list 0, call Close(), push the
+ * items of list 1, and so on.
+ */
+struct index_lists {
+    /// @brief Start of every list in `items_`, plus the end of the last one.
+    std::vector<std::uint32_t> offsets_{0};
+
+    /// @brief Items of all lists.
+    std::vector<std::uint32_t> items_;
+
+    /// @brief Ends the list being filled.
+    void Close() {
+        offsets_.push_back(static_cast<std::uint32_t>(items_.size()));
+    }
+
+    /// @brief Number of closed lists.
+    std::size_t Size() const { return offsets_.size() - 1; }
+
+    /// @brief Items of list `i`.
+    std::span<const std::uint32_t> operator[](std::size_t i) const {
+        return std::span<const std::uint32_t>(items_).subspan(
+            offsets_[i], offsets_[i + 1] - offsets_[i]);
+    }
+
+    /**
+     * @brief Returns the transposed lists: list `j` of the result holds every
+     * `i` whose list contains `j`, in increasing order.
+     *
+     * @param size Number of lists of the result; every item must be lower.
+     */
+    index_lists Transposed(std::size_t size) const;
+};
+
+/**
+ * @brief Computes the strongly connected components of a graph (Tarjan's
+ * algorithm, without recursion).
+ *
+ * Components are returned in reverse topological order: every component comes
+ * after all the components it has edges to.
+ *
+ * @param graph The graph, `graph[a]` being the nodes `a` has an edge to.
+ * @return The nodes of every component.
+ */
+index_lists StronglyConnectedComponents(const index_lists& graph);
+
+/**
+ * @brief Finds the non-terminals that can derive the empty string.
+ *
+ * A production is nullable if every symbol before the first EOL is EPSILON or
+ * a nullable non-terminal, which is exactly when FIRST of its right-hand side
+ * contains EPSILON. Linear in the size of the grammar: each production keeps
+ * a count of the non-terminals that still block it.
+ *
+ * @param grammar The grammar.
+ * @return Nullability of every non-terminal, by non-terminal position.
+ */
+std::vector<bool> NullableNonTerminals(const CompactGrammar& grammar);
+
+/**
+ * @brief Work done by the last FIRST computation.
+ */
+struct first_stats {
+    /// @brief Times the productions of a non-terminal were evaluated.
+    std::size_t iterations_{0};
+
+    /// @brief FIRST evaluations of single productions.
+    std::size_t evaluations_{0};
+
+    /// @brief Strongly connected components of the dependency graph.
+    std::size_t components_{0};
+
+    /// @brief Components with a cycle, the only ones that need to iterate.
+    std::size_t cyclic_components_{0};
+};
+
+/**
+ * @brief FIRST and FOLLOW sets of every non-terminal of a grammar, stored as
+ * terminal bitsets.
+ *
+ * Sets are indexed by the non-terminal position in the symbol table
+ * (`SymbolTable::kind_index_`) and hold terminal positions, where EOL is bit
+ * 0 and EPSILON bit 1. `Set` is SmallTerminalSet or DynamicTerminalSet; use
+ * MakeTerminalSets to pick the right one for a grammar.
+ *
+ * The grammar is not stored: every method receives the CompactGrammar the sets
+ * were created for, so the object can be copied and moved along with its
+ * owner.
+ *
+ * @tparam Set Terminal set type.
+ */
+template <typename Set> class FirstFollow {
+  public:
+    /// @brief Bit of the EOL terminal.
+    static constexpr std::uint32_t EOL_BIT_ = 0;
+
+    /// @brief Bit of the EPSILON terminal.
+    static constexpr std::uint32_t EPSILON_BIT_ = 1;
+
+    FirstFollow() = default;
+
+    /**
+     * @brief Creates empty FIRST and FOLLOW sets for every non-terminal of
+     * `grammar`.
+     */
+    explicit FirstFollow(const CompactGrammar& grammar)
+        : terminals_(grammar.st_.terminal_ids_.size()),
+          first_(grammar.st_.non_terminal_ids_.size(), Set(terminals_)),
+          follow_(grammar.st_.non_terminal_ids_.size(), Set(terminals_)) {}
+
+    /// @brief Returns an empty set sized for the grammar.
+    Set MakeSet() const { return Set(terminals_); }
+
+    /**
+     * @brief Adds FIRST(rule) to `result`.
+     *
+     * EPSILON is added if every symbol of the rule can derive the empty
+     * string. Reaching EOL also adds EPSILON, since EOL cannot be in a FIRST
+     * set.
+     *
+     * @param grammar The grammar the sets were created for.
+     * @param rule Sequence of symbols.
+     * @param result Set where FIRST(rule) is added.
+     */
+    void First(const CompactGrammar& grammar, std::span<const SymbolId> rule,
+               Set& result) const {
+        for (SymbolId symbol : rule) {
+            if (symbol == SymbolTable::EPSILON_ID_) {
+                continue;
+            }
+            if (grammar.st_.IsTerminal(symbol)) {
+                // EOL cannot be in first sets, if we reach EOL it means that
+                // the axiom is nullable, so epsilon is included instead
+                result.Insert(symbol == SymbolTable::EOL_ID_
+                                  ? EPSILON_BIT_
+                                  : grammar.st_.kind_index_[symbol]);
+                return;
+            }
+            const Set& fii = first_[grammar.st_.kind_index_[symbol]];
+            result.UnionWith(fii, EPSILON_BIT_);
+            if (!fii.Contains(EPSILON_BIT_)) {
+                return;
+            }
+        }
+        result.Insert(EPSILON_BIT_);
+    }
+
+    /**
+     * @brief Computes the FIRST set of every non-terminal.
+     *
+     * Builds the graph where A has an edge to B if FIRST(A) reads FIRST(B)
+     * (B appears in a production of A after a nullable prefix) and solves its
+     * strongly connected components in reverse topological order, so every
+     * non-terminal is evaluated after the ones it depends on. Acyclic
+     * components are evaluated once; only cyclic components iterate, with a
+     * worklist of the members whose dependencies changed. Nullable
+     * non-terminals are found first, so EPSILON never has to propagate
+     * through the iteration.
+     *
+     * The work done is recorded in `first_stats_`.
+     *
+     * @param grammar The grammar the sets were created for.
+     */
+    void ComputeFirstSets(const CompactGrammar& grammar) {
+        ComputeFirstSets(grammar, NullableNonTerminals(grammar));
+    }
+
+    /**
+     * @brief Computes the FIRST set of every non-terminal, reusing nullable
+     * non-terminals that are already known.
+     *
+     * @param grammar The grammar the sets were created for.
+     * @param nullable Result of NullableNonTerminals for `grammar`.
+     */
+    void ComputeFirstSets(const CompactGrammar&    grammar,
+                          const std::vector<bool>& nullable) {
+        const SymbolTable& st = grammar.st_;
+        const std::size_t  n  = first_.size();
+        for (Set& set : first_) {
+            set.Clear();
+        }
+        first_stats_ = {};
+
+        nullable_ = nullable;
+        for (std::size_t a = 0; a < n; ++a) {
+            if (nullable_[a]) {
+                first_[a].Insert(EPSILON_BIT_);
+            }
+        }
+
+        // Productions are grouped by non-terminal position, so the edges of
+        // every non-terminal are pushed together
+        index_lists deps;
+        for (std::uint32_t a = 0; a < n; ++a) {
+            for (std::uint32_t p :
+                 grammar.ProductionsOf(st.non_terminal_ids_[a])) {
+                for (SymbolId symbol : grammar.Rhs(p)) {
+                    if (symbol == SymbolTable::EPSILON_ID_) {
+                        continue;
+                    }
+                    if (st.IsTerminal(symbol)) {
+                        break;
+                    }
+                    const std::uint32_t b = st.kind_index_[symbol];
+                    deps.items_.push_back(b);
+                    if (!nullable_[b]) {
+                        break;
+                    }
+                }
+            }
+            deps.Close();
+        }
+        const index_lists dependents = deps.Transposed(n);
+
+        Set  temp = MakeSet();
+        auto eval = [&](std::uint32_t a) {
+            ++first_stats_.iterations_;
+            bool changed = false;
+            for (std::uint32_t p :
+                 grammar.ProductionsOf(st.non_terminal_ids_[a])) {
+                ++first_stats_.evaluations_;
+                temp.Clear();
+                First(grammar, grammar.Rhs(p), temp);
+                changed |= first_[a].UnionWith(temp);
+            }
+            return changed;
+        };
+
+        std::vector<std::uint32_t> component_of(n);
+        std::vector<bool>          queued(n, false);
+        std::vector<std::uint32_t> worklist;
+        const index_lists components = StronglyConnectedComponents(deps);
+        for (std::uint32_t c = 0; c < components.Size(); ++c) {
+            const std::span<const std::uint32_t> members = components[c];
+            for (std::uint32_t a : members) {
+                component_of[a] = c;
+            }
+            ++first_stats_.components_;
+
+            const std::uint32_t head = members[0];
+            if (members.size() == 1 &&
+                std::ranges::find(deps[head], head) == deps[head].end()) {
+                eval(head);
+                continue;
+            }
+
+            ++first_stats_.cyclic_components_;
+            worklist.assign(members.begin(), members.end());
+            for (std::uint32_t a : members) {
+                queued[a] = true;
+            }
+            while (!worklist.empty()) {
+                const std::uint32_t a = worklist.back();
+                worklist.pop_back();
+                queued[a] = false;
+                if (!eval(a)) {
+                    continue;
+                }
+                for (std::uint32_t d : dependents[a]) {
+                    if (component_of[d] == c && !queued[d]) {
+                        queued[d] = true;
+                        worklist.push_back(d);
+                    }
+                }
+            }
+        }
+        ComputeSuffixFirst(grammar);
+    }
+
+    /**
+     * @brief Computes the FIRST set of every non-terminal as a least fixed
+     * point over all productions.
+     *
+     * Reference implementation of ComputeFirstSets, which must give the same
+     * sets. It is kept to cross-check the component solver and to measure it
+     * in the benchmarks; the work done is recorded in `first_stats_`.
+     *
+     * @param grammar The grammar the sets were created for.
+     */
+    void ComputeFirstSetsFixpoint(const CompactGrammar& grammar) {
+        for (Set& set : first_) {
+            set.Clear();
+        }
+        first_stats_ = {};
+        Set  temp    = MakeSet();
+        bool changed;
+        do {
+            changed = false;
+            for (SymbolId nt : grammar.st_.non_terminal_ids_) {
+                ++first_stats_.iterations_;
+                for (std::uint32_t p : grammar.ProductionsOf(nt)) {
+                    ++first_stats_.evaluations_;
+                    temp.Clear();
+                    First(grammar, grammar.Rhs(p), temp);
+                    changed |= first_[grammar.st_.kind_index_[nt]].UnionWith(
+                        temp);
+                }
+            }
+        } while (changed);
+        ComputeSuffixFirst(grammar);
+    }
+
+    /**
+     * @brief Computes FIRST of every suffix of every production.
+     *
+     * One right-to-left sweep per production: FIRST(Xᵢ…Xₙ) is built from
+     * Xᵢ and FIRST(Xᵢ₊₁…Xₙ), following the same rules as First, so EPSILON
+     * marks the nullable suffixes. Called by the FIRST computations once the
+     * FIRST sets are known.
+     *
+     * @param grammar The grammar the sets were created for.
+     */
+    void ComputeSuffixFirst(const CompactGrammar& grammar) {
+        suffix_first_.assign(grammar.symbols_.size() +
+                                 grammar.ProductionCount(),
+                             MakeSet());
+        for (std::uint32_t p = 0; p < grammar.ProductionCount(); ++p) {
+            ComputeSuffixFirst(grammar, p);
+        }
+    }
+
+    /**
+     * @brief Recomputes FIRST of every suffix of one production, e.g. after
+     * the FIRST set of one of its non-terminals changed.
+     *
+     * @param grammar The grammar the sets were created for. The table must
+     * already have room for the production.
+     * @param production Index of the production.
+     */
+    void ComputeSuffixFirst(const CompactGrammar& grammar,
+                            std::uint32_t         production) {
+        const SymbolTable&              st   = grammar.st_;
+        const std::span<const SymbolId> rhs  = grammar.Rhs(production);
+        const std::size_t base = SuffixIndex(grammar, production, 0);
+        suffix_first_[base + rhs.size()].Clear();
+        suffix_first_[base + rhs.size()].Insert(EPSILON_BIT_);
+        for (std::size_t i = rhs.size(); i-- > 0;) {
+            Set&           suffix = suffix_first_[base + i];
+            const Set&     rest   = suffix_first_[base + i + 1];
+            const SymbolId symbol = rhs[i];
+            suffix.Clear();
+            if (symbol == SymbolTable::EPSILON_ID_) {
+                suffix = rest;
+            } else if (symbol == SymbolTable::EOL_ID_) {
+                // EOL ends the rule, see First
+                suffix.Insert(EPSILON_BIT_);
+            } else if (st.IsTerminal(symbol)) {
+                suffix.Insert(st.kind_index_[symbol]);
+            } else {
+                const Set& fii = first_[st.kind_index_[symbol]];
+                suffix.UnionWith(fii, EPSILON_BIT_);
+                if (fii.Contains(EPSILON_BIT_)) {
+                    suffix.UnionWith(rest);
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief Returns FIRST of the suffix of a production that starts at
+     * `position`; it contains EPSILON if the suffix is nullable.
+     *
+     * @param grammar The grammar the sets were created for.
+     * @param production Index of the production.
+     * @param position Start of the suffix, from 0 (the whole right-hand side)
+     * to the length of the right-hand side (the empty suffix).
+     */
+    const Set& SuffixFirst(const CompactGrammar& grammar,
+                           std::uint32_t         production,
+                           std::size_t           position) const {
+        return suffix_first_[SuffixIndex(grammar, production, position)];
+    }
+
+    /**
+     * @brief Computes the FOLLOW set of every non-terminal with the
+     * DeRemer–Pennello digraph method.
+     *
+     * For each production A → αBβ, FIRST(β) \ {ε} is a direct contribution
+     * to FOLLOW(B), and if β can derive ε, B *includes* A: FOLLOW(B) ⊇
+     * FOLLOW(A). FOLLOW(axiom) starts as { $ }. The contributions and the
+     * relation are read from the FIRST-of-suffix table (SuffixFirst); then
+     * the strongly connected components of the relation are solved in
+     * reverse topological order: every member of a component gets the union
+     * of the contributions of the component and of the FOLLOW sets of the
+     * components it includes, which are already final. Linear in the size of
+     * the relation.
+     *
+     * @param grammar The grammar the sets were created for. FIRST sets, and
+     * with them the FIRST-of-suffix table, must already be computed.
+     */
+    void ComputeFollowSets(const CompactGrammar& grammar) {
+        const SymbolTable& st = grammar.st_;
+        const std::size_t  n  = follow_.size();
+        for (Set& set : follow_) {
+            set.Clear();
+        }
+        follow_[st.kind_index_[grammar.axiom_]].Insert(EOL_BIT_);
+
+        // included_in[A]: every B such that FOLLOW(B) includes FOLLOW(A)
+        index_lists included_in;
+        for (std::uint32_t a = 0; a < n; ++a) {
+            for (std::uint32_t p :
+                 grammar.ProductionsOf(st.non_terminal_ids_[a])) {
+                const std::span<const SymbolId> rhs = grammar.Rhs(p);
+                for (std::size_t i = 0; i < rhs.size(); ++i) {
+                    if (st.IsTerminal(rhs[i])) {
+                        continue;
+                    }
+                    const std::uint32_t b    = st.kind_index_[rhs[i]];
+                    const Set&          rest = SuffixFirst(grammar, p, i + 1);
+                    follow_[b].UnionWith(rest, EPSILON_BIT_);
+                    if (rest.Contains(EPSILON_BIT_)) {
+                        included_in.items_.push_back(b);
+                    }
+                }
+            }
+            included_in.Close();
+        }
+        const index_lists includes = included_in.Transposed(n);
+
+        const index_lists components = StronglyConnectedComponents(includes);
+        for (std::uint32_t c = 0; c < components.Size(); ++c) {
+            const std::span<const std::uint32_t> members = components[c];
+            Set& result = follow_[members[0]];
+            for (std::uint32_t b : members) {
+                result.UnionWith(follow_[b]);
+                for (std::uint32_t a : includes[b]) {
+                    result.UnionWith(follow_[a]);
+                }
+            }
+            for (std::uint32_t b : members.subspan(1)) {
+                follow_[b] = result;
+            }
+        }
+    }
+
+    /**
+     * @brief Computes the FOLLOW set of every non-terminal as a least fixed
+     * point over all productions.
+     *
+     * Reference implementation of ComputeFollowSets, which must give the same
+     * sets. For each production A → αBβ, FIRST(β) \ {ε} is added to
+     * FOLLOW(B), and FOLLOW(A) too if β can derive ε, until nothing changes.
+     *
+     * @param grammar The grammar the sets were created for. FIRST sets must
+     * already be computed.
+     */
+    void ComputeFollowSetsFixpoint(const CompactGrammar& grammar) {
+        for (Set& set : follow_) {
+            set.Clear();
+        }
+        follow_[grammar.st_.kind_index_[grammar.axiom_]].Insert(EOL_BIT_);
+
+        Set  first_remaining = MakeSet();
+        bool changed;
+        do {
+            changed = false;
+            for (std::uint32_t p = 0; p < grammar.ProductionCount(); ++p) {
+                const std::span<const SymbolId> rhs = grammar.Rhs(p);
+                const Set& lhs_follow =
+                    follow_[grammar.st_.kind_index_[grammar.Lhs(p)]];
+                for (std::size_t i = 0; i < rhs.size(); ++i) {
+                    if (grammar.st_.IsTerminal(rhs[i])) {
+                        continue;
+                    }
+                    Set& follow = follow_[grammar.st_.kind_index_[rhs[i]]];
+                    first_remaining.Clear();
+                    First(grammar, rhs.subspan(i + 1), first_remaining);
+                    // Add FIRST(β) \ {ε}
+                    changed |=
+                        follow.UnionWith(first_remaining, EPSILON_BIT_);
+                    // If FIRST(β) contains ε, add FOLLOW(lhs)
+                    if (first_remaining.Contains(EPSILON_BIT_)) {
+                        changed |= follow.UnionWith(lhs_follow);
+                    }
+                }
+            }
+        } while (changed);
+    }
+
+    /**
+     * @brief Returns the FIRST set of a non-terminal.
+     */
+    const Set& FirstOf(const CompactGrammar& grammar, SymbolId nt) const {
+        return first_[grammar.st_.kind_index_[nt]];
+    }
+
+    /**
+     * @brief Returns the FOLLOW set of a non-terminal.
+     */
+    const Set& FollowOf(const CompactGrammar& grammar, SymbolId nt) const {
+        return follow_[grammar.st_.kind_index_[nt]];
+    }
+
+    /**
+     * @brief Converts a set of terminal positions to symbol ids.
+     */
+    static std::unordered_set<SymbolId> ToSymbols(const CompactGrammar& grammar,
+                                                  const Set&            set) {
+        std::unordered_set<SymbolId> symbols;
+        set.ForEach([&](std::uint32_t t) {
+            symbols.insert(grammar.st_.terminal_ids_[t]);
+        });
+        return symbols;
+    }
+
+    /// @brief Index of a production suffix in `suffix_first_`.
+    static std::size_t SuffixIndex(const CompactGrammar& grammar,
+                                   std::uint32_t         production,
+                                   std::size_t           position) {
+        return grammar.rhs_offsets_[production] + production + position;
+    }
+
+    /// @brief Number of terminals of the grammar.
+    std::size_t terminals_{0};
+
+    /// @brief FIRST set of every non-terminal, by non-terminal position.
+    std::vector<Set> first_;
+
+    /// @brief FOLLOW set of every non-terminal, by non-terminal position.
+    std::vector<Set> follow_;
+
+    /**
+     * @brief FIRST of every production suffix, see SuffixFirst.
+     *
+     * Laid out like `CompactGrammar::symbols_` with one more entry per
+     * production for its empty suffix: the suffix of production p at
+     * position i is at `rhs_offsets_[p] + p + i`.
+     */
+    std::vector<Set> suffix_first_;
+
+    /// @brief Nullability of every non-terminal, by non-terminal position.
+    /// Filled by ComputeFirstSets.
+    std::vector<bool> nullable_;
+
+    /// @brief Work done by the last FIRST computation.
+    first_stats first_stats_;
+};
+
+/**
+ * @brief FIRST/FOLLOW sets with the terminal set chosen for the grammar size.
+ */
+using terminal_sets = std::variant<FirstFollow<SmallTerminalSet>,
+                                   FirstFollow<DynamicTerminalSet>>;
+
+/**
+ * @brief Creates empty FIRST/FOLLOW sets for a grammar.
+ *
+ * Grammars with up to 64 terminals (EOL and EPSILON included) use the
+ * single-word SmallTerminalSet; bigger ones fall back to DynamicTerminalSet.
+ *
+ * @param grammar The grammar to analyse.
+ */
+inline terminal_sets MakeTerminalSets(const CompactGrammar& grammar) {
+    if (grammar.st_.terminal_ids_.size() <= SmallTerminalSet::CAPACITY_) {
+        return FirstFollow<SmallTerminalSet>(grammar);
+    }
+    return FirstFollow<DynamicTerminalSet>(grammar);
+}
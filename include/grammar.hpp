@@ -16,6 +16,14 @@
  */
 using production = std::vector<std::string>;
 
+/**
+ * @brief A production expressed with interned symbol ids.
+ *
+ * See SymbolTable for the id space and CompactGrammar for the flat form
+ * used by the analyses.
+ */
+using id_production = std::vector<SymbolId>;
+
 struct Grammar {
 
     Grammar() = default;
@@ -100,10 +108,20 @@ struct Grammar {
      * production.
      * @param consequent The sequence of symbols on the right-hand side of the
      * production.
+     *
+     * Symbols that are not in the symbol table yet are interned as
+     * non-terminals. Every symbol that appears in `g_` must be interned in
+     * `st_`; code that edits `g_` directly must declare new symbols with
+     * SymbolTable::PutSymbol.
      */
     void AddProduction(const std::string&              antecedent,
                        const std::vector<std::string>& consequent);
 
+    /**
+     * @brief Returns the SymbolId of the axiom.
+     */
+    SymbolId AxiomId() const { return st_.Id(axiom_); }
+
     /**
      * @brief Stores the grammar rules with each antecedent mapped to a list of
      * productions.
@@ -0,0 +1,90 @@
+#pragma once
+#include "compact_grammar.hpp"
+#include "first_follow.hpp"
+#include "grammar.hpp"
+#include "symbol_table.hpp"
+#include <unordered_set>
+#include <vector>
+
+/**
+ * @brief Facts about one grammar that several analyses need: its compact
+ * form, nullable non-terminals, and FIRST and FOLLOW sets.
+ *
+ * Every fact is computed the first time it is requested and cached, so a
+ * grammar that is checked by the factory, LL1Parser and SLR1Parser only
+ * computes each of them once. The object is meant to be shared read-only
+ * (e.g. through `std::shared_ptr<const GrammarAnalysis>`): the accessors are
+ * const and fill the cache on demand. It is not safe to request facts that
+ * are not cached yet from several threads at the same time.
+ *
+ * The analysis keeps its own CompactGrammar, so it stays valid when the source
+ * grammar is edited, but it then describes the grammar as it was.
+ */
+class GrammarAnalysis {
+  public:
+    /**
+     * @brief Facts the analysis can cache, as bit flags.
+     */
+    enum analysis_fact : unsigned {
+        NULLABLE = 1U << 0,
+        FIRST    = 1U << 1,
+        FOLLOW   = 1U << 2
+    };
+
+    GrammarAnalysis() = default;
+
+    /**
+     * @brief Builds the compact form of a grammar. No fact is computed yet.
+     *
+     * @param grammar The grammar to analyse.
+     */
+    explicit GrammarAnalysis(const Grammar& grammar);
+
+    /**
+     * @brief Returns the nullability of every non-terminal, by non-terminal
+     * position (`SymbolTable::kind_index_`).
+     */
+    const std::vector<bool>& Nullable() const;
+
+    /**
+     * @brief Returns the ids of the nullable non-terminals.
+     */
+    std::unordered_set<SymbolId> NullableSymbols() const;
+
+    /**
+     * @brief Returns the terminal sets with FIRST computed. FOLLOW may not be
+     * computed yet.
+     */
+    const terminal_sets& FirstSets() const;
+
+    /**
+     * @brief Returns the terminal sets with FIRST and FOLLOW computed.
+     */
+    const terminal_sets& Sets() const;
+
+    /**
+     * @brief Checks if a fact has already been computed.
+     *
+     * @param fact The fact to check.
+     */
+    bool IsCached(analysis_fact fact) const { return (cached_ & fact) != 0; }
+
+    /**
+     * @brief Returns the facts already computed, as a mask of analysis_fact
+     * flags.
+     */
+    unsigned CachedFacts() const { return cached_; }
+
+    /// @brief Compact form of the analysed grammar.
+    CompactGrammar cg_;
+
+  private:
+    /// @brief Nullability of every non-terminal, valid if NULLABLE is cached.
+    mutable std::vector<bool> nullable_;
+
+    /// @brief FIRST and FOLLOW sets, valid as flagged in `cached_`.
+    mutable terminal_sets sets_;
+
+    /// @brief Mask of the analysis_fact flags already computed.
+    mutable unsigned cached_{0};
+};
@@ -0,0 +1,317 @@
+#pragma once
+#include "grammar.hpp"
+#include "grammar_factory.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <random>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief Filter of the grammars of a corpus, see GrammarCorpus::Sample.
+ */
+enum corpus_class : std::uint32_t {
+    CORPUS_ANY,  ///< Every grammar of the level.
+    CORPUS_LL1,  ///< Grammars GenLL1Grammar accepts, possibly after a fix.
+    CORPUS_SLR1, ///< Grammars GenSLR1Grammar accepts.
+    CORPUS_CLASS_COUNT
+};
+
+/**
+ * @brief Arrays of a corpus file, in file order.
+ */
+enum corpus_section : std::uint32_t {
+    SECTION_NAMES,        ///< char: symbol names, back to back.
+    SECTION_NAME_OFFSETS, ///< u32: start of every name, plus a sentinel.
+    SECTION_RECORDS,      ///< corpus_record: every grammar, plus a sentinel.
+    SECTION_SYMBOLS,      ///< u32: symbol table of every grammar, as names.
+    SECTION_SYMBOL_FLAGS, ///< u8: kind of every entry of SECTION_SYMBOLS.
+    SECTION_LHS,          ///< u32: antecedent of every production.
+    SECTION_RHS_OFFSETS,  ///< u32: start of every production, plus a sentinel.
+    SECTION_RHS,          ///< u32: right-hand sides, back to back.
+    SECTION_BUCKETS,      ///< corpus_bucket: sorted by (level, class).
+    SECTION_MEMBERS,      ///< u32: grammars of every bucket.
+    SECTION_COUNT
+};
+
+/**
+ * @brief Position and length (in elements) of one array of a corpus file.
+ */
+struct corpus_extent {
+    std::uint64_t offset_;
+    std::uint64_t count_;
+};
+
+/**
+ * @brief First bytes of a corpus file.
+ *
+ * The header is followed by the arrays of `corpus_section`, each one aligned
+ * to 8 bytes, in native byte order. Symbols are interned once for the whole
+ * corpus: productions store name ids, i.e. positions in SECTION_NAME_OFFSETS.
+ */
+struct corpus_header {
+    char          magic_[8];
+    std::uint32_t version_;
+    std::uint32_t byte_order_;
+    corpus_extent sections_[SECTION_COUNT];
+};
+
+/**
+ * @brief One grammar of a corpus file.
+ *
+ * The grammar owns the symbols and productions from its record up to the
+ * next one; the last record is a sentinel.
+ */
+struct corpus_record {
+    /// @brief First entry of the grammar in SECTION_SYMBOLS.
+    std::uint32_t first_symbol_;
+
+    /// @brief First production of the grammar.
+    std::uint32_t first_production_;
+
+    /// @brief Name id of the axiom.
+    std::uint32_t axiom_;
+
+    /// @brief Level the grammar was generated at.
+    std::uint16_t level_;
+
+    /// @brief GrammarFactory::ll1_fix of the grammar.
+    std::uint8_t ll1_;
+
+    /// @brief Whether GenSLR1Grammar accepts the grammar.
+    std::uint8_t slr1_;
+};
+
+/**
+ * @brief Grammars of one (level, class) pair: SECTION_MEMBERS from `first_`
+ * to `first_ + count_`.
+ */
+struct corpus_bucket {
+    std::uint32_t level_;
+    std::uint32_t class_;
+    std::uint32_t first_;
+    std::uint32_t count_;
+};
+
+/**
+ * @brief Builds a corpus of classified grammars and writes it to a file that
+ * GrammarCorpus can map.
+ */
+class GrammarCorpusWriter {
+  public:
+    /**
+     * @brief Adds a grammar to the corpus.
+     *
+     * The symbol table is stored in id order, with the kind of every symbol
+     * and whether it was declared, so GrammarView::ToGrammar restores it.
+     *
+     * @param gr Grammar to add.
+     * @param level Level the grammar was generated at.
+     * @param ll1 What GenLL1Grammar does with the grammar.
+     * @param slr1 Whether GenSLR1Grammar accepts the grammar.
+     */
+    void Add(const Grammar& gr, int level, GrammarFactory::ll1_fix ll1,
+             bool slr1);
+
+    /**
+     * @brief Adds the grammars of a level that GenLL1Grammar or
+     * GenSLR1Grammar accept.
+     *
+     * Indexed levels (up to MAX_INDEXED_LEVEL_) add every grammar of the
+     * index, building it if needed. Deeper levels classify the grammars
+     * #0 to #`draws - 1` of PickOne(level, index), so the corpus keeps the
+     * distribution of the factory.
+     *
+     * @param factory Initialized factory.
+     * @param level Level to add.
+     * @param draws Grammars to draw at levels that are not indexed.
+     */
+    void AddLevel(GrammarFactory& factory, int level, std::size_t draws);
+
+    /// @brief Number of grammars added so far.
+    std::size_t Size() const { return records_.size(); }
+
+    /**
+     * @brief Writes the corpus.
+     *
+     * @param path File to write.
+     * @throws std::runtime_error if the file cannot be written.
+     */
+    void Write(const std::string& path) const;
+
+  private:
+    /// @brief Returns the name id of a symbol, adding it if needed.
+    std::uint32_t NameId(const std::string& name);
+
+    std::unordered_map<std::string, std::uint32_t> name_ids_;
+    std::vector<std::string>                        names_;
+    std::vector<corpus_record>                      records_;
+    std::vector<std::uint32_t>                      symbols_;
+    std::vector<std::uint8_t>                       symbol_flags_;
+    std::vector<std::uint32_t>                      lhs_;
+    std::vector<std::uint32_t>                      rhs_offsets_{0};
+    std::vector<std::uint32_t>                      rhs_;
+};
+
+class GrammarCorpus;
+
+/**
+ * @brief Read-only view of one grammar of a mapped corpus.
+ *
+ * Symbols are name ids of the corpus; the view copies nothing and is valid
+ * as long as its corpus.
+ */
+class GrammarView {
+  public:
+    GrammarView(const GrammarCorpus& corpus, std::uint32_t index)
+        : corpus_(&corpus), index_(index) {}
+
+    /// @brief Position of the grammar in the corpus.
+    std::uint32_t Index() const { return index_; }
+
+    /// @brief Level the grammar was generated at.
+    int Level() const;
+
+    /// @brief What GenLL1Grammar does with the grammar.
+    GrammarFactory::ll1_fix LL1Fix() const;
+
+    /// @brief Whether GenSLR1Grammar accepts the grammar.
+    bool IsSLR1() const;
+
+    /// @brief Name id of the axiom.
+    std::uint32_t Axiom() const;
+
+    /// @brief Number of productions.
+    std::uint32_t ProductionCount() const;
+
+    /**
+     * @brief Returns the antecedent of a production.
+     * @param p Index of the production, local to the grammar.
+     */
+    std::uint32_t Lhs(std::uint32_t p) const;
+
+    /**
+     * @brief Returns the right-hand side of a production.
+     * @param p Index of the production, local to the grammar.
+     */
+    std::span<const std::uint32_t> Rhs(std::uint32_t p) const;
+
+    /**
+     * @brief Builds the grammar: same rules, axiom and symbol table as the
+     * grammar given to GrammarCorpusWriter::Add.
+     */
+    Grammar ToGrammar() const;
+
+  private:
+    const GrammarCorpus* corpus_;
+    std::uint32_t        index_;
+};
+
+/**
+ * @brief A corpus file mapped in memory.
+ *
+ * Opening checks the header, and that every offset, name id and member
+ * stays inside its array, in one pass over the arrays; grammars are only
+ * converted when they are used.
+ */
+class GrammarCorpus {
+  public:
+    /// @brief Format version this build reads and writes.
+    static constexpr std::uint32_t VERSION_ = 1;
+
+    /// @brief First bytes of every corpus file.
+    static constexpr char MAGIC_[8] = {'G', 'R', 'A', 'M', 'C', 'R', 'P', 'S'};
+
+    /// @brief Written as is; reads back swapped on a machine of the other
+    /// byte order.
+    static constexpr std::uint32_t BYTE_ORDER_ = 0x01020304;
+
+    /// @brief SECTION_SYMBOL_FLAGS bit: the symbol is a terminal.
+    static constexpr std::uint8_t TERMINAL_FLAG_ = 1;
+
+    /// @brief SECTION_SYMBOL_FLAGS bit: the symbol was declared with
+    /// SymbolTable::PutSymbol, not only interned.
+    static constexpr std::uint8_t DECLARED_FLAG_ = 2;
+
+    /**
+     * @brief Maps a corpus file.
+     *
+     * @param path File written by GrammarCorpusWriter::Write.
+     * @throws std::runtime_error if the file cannot be mapped, is not a
+     * corpus of this version, or has an offset, name id or member out of
+     * range.
+     */
+    explicit GrammarCorpus(const std::string& path);
+
+    ~GrammarCorpus();
+
+    GrammarCorpus(const GrammarCorpus&)            = delete;
+    GrammarCorpus& operator=(const GrammarCorpus&) = delete;
+
+    /// @brief Number of grammars.
+    std::size_t Size() const { return records_.size() - 1; }
+
+    /// @brief Returns the grammar at a position.
+    GrammarView At(std::uint32_t index) const { return {*this, index}; }
+
+    /// @brief Returns the name of a name id.
+    std::string_view Name(std::uint32_t id) const {
+        return {names_.data() + name_offsets_[id],
+                name_offsets_[id + 1] - name_offsets_[id]};
+    }
+
+    /**
+     * @brief Returns the positions of the grammars of a level and class.
+     * @return An empty span if the corpus has none.
+     */
+    std::span<const std::uint32_t> Members(int level, corpus_class cls) const;
+
+    /**
+     * @brief Draws a grammar of a level and class uniformly.
+     *
+     * @param level Level of the grammar.
+     * @param cls Class of the grammar.
+     * @param rng Uniform random bit generator.
+     * @return The grammar, or nothing if the corpus has none.
+     */
+    template <typename Engine>
+    std::optional<GrammarView> Sample(int level, corpus_class cls,
+                                      Engine& rng) const {
+        std::span<const std::uint32_t> members = Members(level, cls);
+        if (members.empty()) {
+            return std::nullopt;
+        }
+        std::uniform_int_distribution<std::size_t> dist(0, members.size() - 1);
+        return At(members[dist(rng)]);
+    }
+
+  private:
+    friend class GrammarView;
+
+    /**
+     * @brief Returns an array of the file.
+     * @throws std::runtime_error if it is out of the file or misaligned.
+     */
+    template <typename T> std::span<const T> Section(corpus_section s) const;
+
+    /// @brief Mapped file.
+    const char* data_{nullptr};
+
+    /// @brief Size of the mapped file in bytes.
+    std::size_t size_{0};
+
+    std::span<const char>          names_;
+    std::span<const std::uint32_t> name_offsets_;
+    std::span<const corpus_record> records_;
+    std::span<const std::uint32_t> symbols_;
+    std::span<const std::uint8_t>  symbol_flags_;
+    std::span<const std::uint32_t> lhs_;
+    std::span<const std::uint32_t> rhs_offsets_;
+    std::span<const std::uint32_t> rhs_;
+    std::span<const corpus_bucket> buckets_;
+    std::span<const std::uint32_t> members_;
+};
@@ -1,9 +1,27 @@
 #pragma once
 
+#include "alias_table.hpp"
+#include "check_order.hpp"
+#include "compact_grammar.hpp"
+#include "first_follow.hpp"
 #include "grammar.hpp"
+#include "grammar_analysis.hpp"
+#include "philox_engine.hpp"
 #include "symbol_table.hpp"
+#include "verdict_cache.hpp"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <random>
+#include <stop_token>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 /**
@@ -53,34 +71,604 @@ struct GrammarFactory {
         void Debug() const;
     };
 
+    /**
+     * @brief Rules of a grammar being composed level by level, see Compose.
+     *
+     * Symbols are ids of `catalog::symbols_`, which every composition
+     * starts from, so steps compare and copy integers; names are only
+     * resolved by ToGrammar. The non-terminal of level `l` is the `l`-th
+     * non-terminal after the axiom, so the productions a step adds go at the
+     * end of `rules_` and keep them grouped by non-terminal.
+     */
+    struct composition {
+        /// @brief Rules of the grammar, the axiom production S -> A $
+        /// included. Non-terminals of levels beyond the alphabet are added
+        /// to its symbol table by the step that introduces them.
+        CompactGrammar rules_;
+
+        /// @brief Terminals that appear in `rules_`, EPSILON included,
+        /// sorted. Kept up to date by every step.
+        std::vector<SymbolId> terminals_;
+
+        /// @brief `items_[l - 1]` is the position in `items` of the item the
+        /// non-terminal of level `l` comes from. Steps keep the productions
+        /// of the item in order, so a position in the rules is the same
+        /// position in the item. Emptied by Canonicalize, which sorts the
+        /// productions.
+        std::vector<std::size_t> items_;
+
+        /// @brief Returns the rules as a grammar, with their names.
+        Grammar ToGrammar() const { return Grammar(rules_.ToRules()); }
+    };
+
+    /**
+     * @brief Random choices of one ComposeStep, see ApplyComposeStep.
+     */
+    struct step_choice {
+        /// @brief Terminal that replaces a terminal of the base.
+        SymbolId new_terminal_;
+
+        /// @brief Position of the terminal it replaces.
+        std::size_t to_terminal_;
+
+        /// @brief Position of the terminal that becomes the new
+        /// non-terminal, after the first replacement.
+        std::size_t to_nt_;
+    };
+
+    /**
+     * @brief What one ApplyComposeStep changed, for UndoComposeStep.
+     */
+    struct step_undo {
+        /// @brief Positions in `rules_.symbols_` the step replaced, with the
+        /// symbol they had.
+        std::vector<std::pair<std::uint32_t, SymbolId>> symbols_;
+
+        /// @brief Number of productions before the step.
+        std::uint32_t productions_{0};
+
+        /// @brief `terminals_` before the step.
+        std::vector<SymbolId> terminals_;
+    };
+
+    /**
+     * @brief A composition with its FIRST, FOLLOW and FIRST-of-suffix sets,
+     * kept up to date step by step by GenLL1GrammarByConstruction.
+     * Compositions only have the terminals of the catalog, so the sets fit in
+     * a SmallTerminalSet.
+     */
+    struct ll1_construction {
+        /// @brief The grammar so far, LL(1) as is.
+        composition rules_;
+
+        /// @brief The sets of `rules_`.
+        FirstFollow<SmallTerminalSet> sets_;
+
+        /// @brief `occurrences_[a]` holds the production and the position in
+        /// it of every occurrence of the non-terminal at position `a`. Steps
+        /// only add productions, so occurrences never move.
+        std::vector<std::vector<std::pair<std::uint32_t, std::uint32_t>>>
+            occurrences_;
+    };
+
+    /**
+     * @brief What one ApplyLL1Step changed, for UndoLL1Step.
+     */
+    struct ll1_undo {
+        /// @brief What the step changed in the composition.
+        step_undo step_;
+
+        /// @brief Position of the non-terminal of the step.
+        std::uint32_t non_terminal_{0};
+
+        /// @brief Size of `sets_.suffix_first_` before the step.
+        std::size_t suffix_size_{0};
+
+        /// @brief FIRST sets the step changed, with the value they had, in
+        /// the order they changed.
+        std::vector<std::pair<std::uint32_t, SmallTerminalSet>> first_;
+
+        /// @brief FOLLOW sets the step changed, see `first_`.
+        std::vector<std::pair<std::uint32_t, SmallTerminalSet>> follow_;
+
+        /// @brief FIRST-of-suffix sets the step changed, see `first_`.
+        std::vector<std::pair<std::size_t, SmallTerminalSet>> suffix_first_;
+    };
+
+    /**
+     * @brief How GenLL1Grammar turns a grammar into an LL(1) one.
+     */
+    enum ll1_fix : std::uint8_t {
+        AS_IS,                 ///< LL(1) as is, and passes the sanity checks.
+        REMOVE_LEFT_RECURSION, ///< LL(1) after RemoveLeftRecursion.
+        LEFT_FACTORIZE,        ///< LL(1) after RemoveLeftRecursion and
+                               ///< LeftFactorize.
+        NOT_LL1                ///< Rejected.
+    };
+
+    /**
+     * @brief Kind of grammars GenerateBatch generates.
+     */
+    enum grammar_class : std::uint8_t {
+        LL1_GRAMMAR, ///< Grammars of GenLL1Grammar.
+        SLR1_GRAMMAR ///< Grammars of GenSLR1Grammar.
+    };
+
+    /**
+     * @brief Receives the grammars of GenerateBatch: the index of the
+     * grammar in the batch and the grammar. Returns false to stop the batch.
+     */
+    using batch_sink = std::function<bool(std::uint64_t, const Grammar&)>;
+
+    /**
+     * @brief When TryGenLL1Grammar and TryGenSLR1Grammar give up. An attempt
+     * that has started is always finished, so they can overrun the deadline
+     * by one attempt.
+     */
+    struct generation_limits {
+        /// @brief No attempt starts at or after this time.
+        std::chrono::steady_clock::time_point deadline_{
+            std::chrono::steady_clock::time_point::max()};
+
+        /// @brief Maximum number of attempts, or 0 for no limit.
+        std::uint64_t max_attempts_{0};
+
+        /// @brief No attempt starts once a stop is requested.
+        std::stop_token stop_{};
+    };
+
+    /**
+     * @brief Why a drawn grammar was rejected, from the first check it
+     * failed to the last. A grammar that fails several checks gets the
+     * first of them, whatever order they ran in.
+     */
+    enum rejection_reason : std::uint8_t {
+        REJECTED_INFINITE,    ///< IsInfinite.
+        REJECTED_UNREACHABLE, ///< HasUnreachableSymbols.
+        REJECTED_CONFLICT,    ///< Not LL(1) even after the fixes of MakeLL1,
+                              ///< or not SLR(1).
+        REJECTION_REASONS     ///< Number of reasons.
+    };
+
+    /**
+     * @brief How TryGenLL1Grammar or TryGenSLR1Grammar ended.
+     */
+    enum generation_status : std::uint8_t {
+        GENERATED,       ///< A grammar was accepted.
+        TIMED_OUT,       ///< The deadline passed.
+        OUT_OF_ATTEMPTS, ///< `max_attempts_` attempts were rejected.
+        CANCELLED        ///< A stop was requested.
+    };
+
+    /**
+     * @brief Result of TryGenLL1Grammar or TryGenSLR1Grammar.
+     */
+    struct generation_result {
+        generation_status status_{GENERATED};
+
+        /// @brief The accepted grammar if `status_` is GENERATED. Otherwise,
+        /// the rejected grammar that passed the most checks, the first one
+        /// on a tie, or an empty grammar if no attempt was made.
+        Grammar grammar_;
+
+        /// @brief Grammars drawn, including the accepted one.
+        std::uint64_t attempts_{0};
+
+        /// @brief Number of rejected grammars per rejection_reason.
+        std::array<std::uint64_t, REJECTION_REASONS> rejections_{};
+    };
+
+    /**
+     * @brief Steps of the retry loops of GenLL1Grammar and GenSLR1Grammar
+     * that `stats_` times.
+     */
+    enum check_stage : std::uint8_t {
+        DRAW_STAGE,                  ///< PickOne or ComposeSLR1.
+        ANALYSIS_STAGE,              ///< GrammarAnalysis of the grammar.
+        INFINITE_STAGE,              ///< IsInfinite.
+        UNREACHABLE_STAGE,           ///< HasUnreachableSymbols.
+        LEFT_RECURSION_STAGE,        ///< HasDirectLeftRecursion.
+        LL1_TABLE_STAGE,             ///< LL(1) table of the grammar as is.
+        REMOVE_LEFT_RECURSION_STAGE, ///< RemoveLeftRecursion and its table.
+        LEFT_FACTORIZE_STAGE,        ///< LeftFactorize and its table.
+        SLR1_AUTOMATON_STAGE,        ///< SLR(1) automaton and table.
+        CHECK_STAGES                 ///< Number of stages.
+    };
+
+    /// @brief Buckets of a stage_stats histogram.
+    static constexpr std::size_t TIMING_BUCKETS_ = 40;
+
+    /**
+     * @brief Runs, failures and timing histogram of one check_stage.
+     */
+    struct stage_stats {
+        /// @brief Times the stage ran.
+        std::uint64_t runs_{0};
+
+        /// @brief Runs that rejected the grammar: the check found the flaw,
+        /// or the table had a conflict. Always 0 for the draw and analysis.
+        std::uint64_t failures_{0};
+
+        /// @brief Time of all runs, in nanoseconds.
+        std::uint64_t total_ns_{0};
+
+        /// @brief `buckets_[i]` counts the runs that took from 2^(i-1) to
+        /// 2^i - 1 nanoseconds; the last bucket also counts longer runs.
+        std::array<std::uint64_t, TIMING_BUCKETS_> buckets_{};
+
+        /// @brief Counts one run.
+        void Record(std::uint64_t ns, bool failed) {
+            ++runs_;
+            failures_ += failed ? 1 : 0;
+            total_ns_ += ns;
+            ++buckets_[std::min<std::size_t>(std::bit_width(ns),
+                                             TIMING_BUCKETS_ - 1)];
+        }
+
+        /**
+         * @brief Returns an upper bound of the `q` quantile of the run
+         * times, in nanoseconds: the end of its histogram bucket.
+         * @param q Quantile, from 0 to 1.
+         */
+        std::uint64_t Quantile(double q) const {
+            const auto rank = static_cast<std::uint64_t>(
+                q * static_cast<double>(runs_ > 0 ? runs_ - 1 : 0));
+            std::uint64_t seen = 0;
+            for (std::size_t i = 0; i < TIMING_BUCKETS_; ++i) {
+                seen += buckets_[i];
+                if (seen > rank) {
+                    return (std::uint64_t{1} << i) - 1;
+                }
+            }
+            return 0;
+        }
+    };
+
+    /**
+     * @brief Counters of the retry loops of GenLL1Grammar, GenSLR1Grammar
+     * and their TryGen versions, see `stats_`.
+     */
+    struct generation_stats {
+        /// @brief Grammars drawn.
+        std::uint64_t attempts_{0};
+
+        /// @brief Grammars accepted.
+        std::uint64_t generated_{0};
+
+        /// @brief Grammars rejected, per rejection_reason.
+        std::array<std::uint64_t, REJECTION_REASONS> rejections_{};
+
+        /// @brief LL(1) checks per outcome: the stage that made the grammar
+        /// LL(1), or NOT_LL1.
+        std::array<std::uint64_t, NOT_LL1 + 1> ll1_fixes_{};
+
+        /// @brief Runs and times per check_stage.
+        std::array<stage_stats, CHECK_STAGES> stages_{};
+    };
+
+    /**
+     * @brief A grammar with the verdicts of the checks GenLL1Grammar and
+     * GenSLR1Grammar run on it.
+     */
+    struct catalog_entry {
+        /// @brief Rules of the grammar.
+        composition rules_;
+
+        /// @brief What GenLL1Grammar does with the grammar.
+        ll1_fix ll1_{NOT_LL1};
+
+        /// @brief Whether GenSLR1Grammar accepts the grammar.
+        bool slr1_{false};
+    };
+
+    /**
+     * @brief Every grammar a level can compose, up to a renaming of
+     * terminals, classified, see BuildIndex.
+     */
+    struct grammar_index {
+        /// @brief One grammar per class of compositions that are equal up to
+        /// a renaming of terminals, with canonical terminal names.
+        std::vector<catalog_entry> grammars_;
+
+        /// @brief Positions in `grammars_` of the grammars GenLL1Grammar
+        /// accepts, possibly after a transformation.
+        std::vector<std::uint32_t> ll1_;
+
+        /// @brief Positions in `grammars_` of the grammars GenSLR1Grammar
+        /// accepts.
+        std::vector<std::uint32_t> slr1_;
+    };
+
+    /// @brief Highest level that BuildIndex can enumerate.
+    static constexpr int MAX_INDEXED_LEVEL_ = 3;
+
+    /// @brief Draws of one step GenLL1GrammarByConstruction and ComposeSLR1
+    /// try before starting over.
+    static constexpr int MAX_STEP_ATTEMPTS_ = 128;
+
+    /// @brief Times GenLL1GrammarByConstruction and ComposeSLR1 start over
+    /// before they give up.
+    static constexpr int MAX_CONSTRUCTION_RESTARTS_ = 64;
+
+    /**
+     * @brief Everything Init builds once and generation only reads: the
+     * Level 1 items, the alphabets, the Level 2 catalog, the SLR(1)
+     * compatibility matrix and the indexes.
+     *
+     * Factories hold the catalog through `catalog_`, as a shared pointer to
+     * const, so any number of them, one per thread, can share one catalog
+     * without locks. Everything a factory changes while generating (`rng_`)
+     * is its own.
+     */
+    struct catalog {
+        /**
+         * @brief A vector of FactoryItem objects representing different
+         * level 1 grammar items created by the Init method.
+         */
+        std::vector<FactoryItem> items;
+
+        /**
+         * @brief Every possible Level 2 grammar, see BuildLv2Catalog.
+         */
+        std::vector<catalog_entry> lv2_catalog_;
+
+        /**
+         * @brief Sampler of `lv2_catalog_`, with the probability of every
+         * entry.
+         */
+        AliasTable lv2_any_;
+
+        /**
+         * @brief Sampler of the entries of `lv2_catalog_` that are LL(1) as
+         * is, with the probability of `lv2_any_`. Empty if there are none.
+         */
+        AliasTable lv2_ll1_as_is_;
+
+        /**
+         * @brief Sampler of the entries of `lv2_catalog_` that are SLR(1),
+         * with the probability of `lv2_any_`. Empty if there are none.
+         */
+        AliasTable lv2_slr1_;
+
+        /**
+         * @brief Whether every item is LL(1) as is on its own. A step that
+         * adds an item that is not never is, whatever the grammar.
+         */
+        std::vector<bool> ll1_items_;
+
+        /**
+         * @brief SLR(1) compatibility matrix: `slr1_compatible_[i].at(t)[j]`
+         * is true if some Level 2 composition that replaces terminal `t` of
+         * item `i` with item `j` is SLR(1), see BuildSLR1Compatibility.
+         */
+        std::vector<std::unordered_map<SymbolId, std::vector<bool>>>
+            slr1_compatible_;
+
+        /**
+         * @brief Index of every level up to MAX_INDEXED_LEVEL_, if built. An
+         * index never changes once built, so copies of the catalog share it.
+         */
+        std::array<std::shared_ptr<const grammar_index>, MAX_INDEXED_LEVEL_>
+            indices_;
+
+        /**
+         * @brief A vector of terminal symbols (alphabet) used in the grammar.
+         */
+        std::vector<std::string> terminal_alphabet_{
+            "a", "b", "c", "d", "e", "f", "g", "h", "i", "j", "k", "l"};
+
+        /**
+         * @brief A vector of non-terminal symbols (alphabet) used in the
+         * grammar.
+         */
+        std::vector<std::string> non_terminal_alphabet_{"A", "B", "C", "D",
+                                                        "E", "F", "G"};
+
+        /**
+         * @brief Symbols of every composition: EOL and EPSILON, the terminal
+         * alphabet, the axiom, then the non-terminal alphabet, in level
+         * order.
+         */
+        SymbolTable symbols_;
+
+        /// @brief Ids of `terminal_alphabet_` in `symbols_`, in order.
+        std::vector<SymbolId> terminal_ids_;
+
+        /// @brief Every item of `items` as a composition, see
+        /// ItemComposition.
+        std::vector<composition> item_rules_;
+    };
+
+    /**
+     * @brief Creates a factory without a catalog: checks and transformations
+     * work, generation needs Init.
+     */
+    GrammarFactory() = default;
+
+    /**
+     * @brief Creates a factory that generates from a catalog built by the
+     * Init of another one. Copying is as cheap as that, so this is how every
+     * thread gets its own factory.
+     * @param shared The catalog, usually `catalog_` of another factory.
+     */
+    explicit GrammarFactory(std::shared_ptr<const catalog> shared);
+
     /**
      * @brief Initializes the GrammarFactory and populates the items vector with
-     * initial grammar items.
+     * initial grammar items, then builds the Level 2 catalog, the SLR(1)
+     * compatibility matrix and the indexes of levels 1 and 2.
      */
     void Init();
 
     /**
-     * @brief Picks a random grammar based on the specified difficulty level (1,
-     * 2, or 3).
-     * @param level The difficulty level (1, 2, or 3).
+     * @brief Picks a random grammar based on the specified difficulty level.
+     * Levels from 2 up are built by Compose, so there is no upper limit.
+     * @param level The difficulty level, 1 or more.
      * @return A randomly picked grammar.
      */
     Grammar PickOne(int level);
 
     /**
      * @brief Generates a LL(1) random grammar based on the specified difficulty
-     * level.
+     * level. Levels with an index (see BuildIndex) are drawn uniformly from
+     * the grammars of the index that GenLL1Grammar accepts, without retries.
      * @param level The difficulty level (1, 2, or 3)
      * @return A random LL(1) grammar.
      */
     Grammar GenLL1Grammar(int level);
     /**
      * @brief Generates a SLR(1) random grammar based on the specified
-     * difficulty lefel.
+     * difficulty lefel. Levels with an index are drawn uniformly from its
+     * SLR(1) grammars, like GenLL1Grammar. Other levels are composed by
+     * ComposeSLR1, which skips the steps the compatibility matrix rejects.
      * @param level The difficulty level (1, 2, or 3)
      * @return A random SLR(1) grammar.
      */
     Grammar GenSLR1Grammar(int level);
+
+    /**
+     * @brief Picks grammar number `index` of the batch defined by `seed_`.
+     *
+     * The grammar only depends on the seed, the level and the index: it draws
+     * from random stream `index` of the seed, so any index range can be
+     * generated independently, in any order or on any thread. Later calls
+     * without an index keep reading that stream.
+     * @param level The difficulty level.
+     * @param index Index of the grammar in the batch.
+     * @return The picked grammar.
+     */
+    Grammar PickOne(int level, std::uint64_t index);
+
+    /**
+     * @brief Generates LL(1) grammar number `index` of the batch defined by
+     * `seed_`. Every retry draws from stream `index`, see PickOne.
+     * @param level The difficulty level.
+     * @param index Index of the grammar in the batch.
+     * @return A random LL(1) grammar.
+     */
+    Grammar GenLL1Grammar(int level, std::uint64_t index);
+
+    /**
+     * @brief Generates SLR(1) grammar number `index` of the batch defined by
+     * `seed_`. Every retry draws from stream `index`, see PickOne.
+     * @param level The difficulty level.
+     * @param index Index of the grammar in the batch.
+     * @return A random SLR(1) grammar.
+     */
+    Grammar GenSLR1Grammar(int level, std::uint64_t index);
+
+    /**
+     * @brief Generates a LL(1) random grammar like GenLL1Grammar, but gives
+     * up once one of `limits` is reached instead of retrying forever.
+     * @param level The difficulty level.
+     * @param limits When to give up.
+     * @return The grammar, or the reason there is none and the best
+     * candidate.
+     */
+    generation_result TryGenLL1Grammar(int                      level,
+                                       const generation_limits& limits);
+
+    /**
+     * @brief Generates a SLR(1) random grammar like GenSLR1Grammar, but
+     * gives up once one of `limits` is reached. Every attempt is one
+     * start of ComposeSLR1 and its checks.
+     * @param level The difficulty level.
+     * @param limits When to give up.
+     * @return The grammar, or the reason there is none and the best
+     * candidate.
+     */
+    generation_result TryGenSLR1Grammar(int                      level,
+                                        const generation_limits& limits);
+
+    /**
+     * @brief TryGenLL1Grammar for LL(1) grammar number `index` of the batch,
+     * see GenLL1Grammar(level, index).
+     */
+    generation_result TryGenLL1Grammar(int level, std::uint64_t index,
+                                       const generation_limits& limits);
+
+    /**
+     * @brief TryGenSLR1Grammar for SLR(1) grammar number `index` of the
+     * batch, see GenSLR1Grammar(level, index).
+     */
+    generation_result TryGenSLR1Grammar(int level, std::uint64_t index,
+                                        const generation_limits& limits);
+
+    /**
+     * @brief Generates grammars #0 to #`count - 1` of the batch defined by
+     * `seed_`, as GenLL1Grammar(level, index) or GenSLR1Grammar(level,
+     * index) would, on `threads` threads.
+     *
+     * Every thread works on a copy of the factory, which shares its
+     * catalog, starting with an equal share of the indices; a thread that
+     * runs out steals the second half of the largest share left. Grammars
+     * reach `sink` one at a time, in the order they are done, and are not
+     * kept, so memory does not grow with `count`. Grammar #i is the same for
+     * any number of threads.
+     *
+     * @param type Kind of grammars to generate.
+     * @param level The difficulty level.
+     * @param count Number of grammars.
+     * @param threads Number of threads, at least 1.
+     * @param sink Called with every grammar, never concurrently. Once it
+     * returns false, every thread stops after its current grammar, and
+     * `sink` is not called again.
+     */
+    void GenerateBatch(grammar_class type, int level, std::size_t count,
+                       std::size_t threads, const batch_sink& sink) const;
+
+    /**
+     * @brief Generates a LL(1) random grammar step by step: every step of
+     * Compose is checked as soon as it is drawn, and drawn again while the
+     * grammar so far is not LL(1) as is, so the result needs no fix.
+     *
+     * The check of a step is incremental, see ApplyLL1Step: only the sets of
+     * the non-terminals the step touches are recomputed, and only their
+     * productions are checked for conflicts. A conflict only undoes the last
+     * step. If MAX_STEP_ATTEMPTS_ draws of a step all conflict, the grammar
+     * starts over from a Level 2 grammar that is LL(1) as is, at most
+     * MAX_CONSTRUCTION_RESTARTS_ times. Unlike GenLL1Grammar,
+     * RemoveLeftRecursion and LeftFactorize are never applied, so only
+     * grammars that are LL(1) as is are generated.
+     * @param level The difficulty level, 1 or more.
+     * @return A random grammar that is LL(1) as is.
+     * @throws std::runtime_error if no grammar was found within the
+     * restarts, or the catalog has no LL(1) grammar to start from.
+     */
+    Grammar GenLL1GrammarByConstruction(int level);
+
+    /**
+     * @brief Generates a LL(1) random grammar like
+     * GenLL1GrammarByConstruction, but starts over until one of `limits` is
+     * reached instead of MAX_CONSTRUCTION_RESTARTS_ times. Every attempt is
+     * one construction from Level 1 or 2; one that runs out of draws for a
+     * step is a REJECTED_CONFLICT, and its grammar is the levels it built.
+     * @param level The difficulty level, 1 or more.
+     * @param limits When to give up.
+     * @return The grammar, or the reason there is none and the best
+     * candidate. OUT_OF_ATTEMPTS without any attempt if the catalog has no
+     * LL(1) grammar to start from.
+     */
+    generation_result
+    TryGenLL1GrammarByConstruction(int                      level,
+                                   const generation_limits& limits);
+
+    /**
+     * @brief TryGenLL1GrammarByConstruction for LL(1) grammar number `index`
+     * of the batch: every attempt draws from stream `index`, see PickOne.
+     */
+    generation_result
+    TryGenLL1GrammarByConstruction(int level, std::uint64_t index,
+                                   const generation_limits& limits);
+
+    /**
+     * @brief Restarts the random engine all levels draw from at stream 0 of
+     * `seed`. After the same seed, the same sequence of calls generates the
+     * same grammars.
+     * @param seed Seed of the engine.
+     */
+    void Seed(std::uint64_t seed);
+
     /**
      * @brief Performs sanity checks on a grammar and print the results to
      * stdout.
@@ -95,75 +683,452 @@ struct GrammarFactory {
     Grammar Lv1();
 
     /**
-     * @brief Generates a Level 2 grammar by combining Level 1 items.
-     * @return A Level 2 grammar.
+     * @brief Generates a grammar of any level from 2 up by composing Level 1
+     * items, see Compose.
+     * @param level The difficulty level.
+     * @return A grammar of that level.
      */
-    Grammar Lv2();
+    Grammar LvN(int level);
 
     /**
-     * @brief Generates a Level 3 grammar by combining a Level 2 item and a
-     * Level 1 item.
-     * @return A Level 3 grammar.
+     * @brief Builds the rules of a grammar of the given level.
+     *
+     * Level 2 combines two different Level 1 items; every level above adds one
+     * more random Level 1 item to the level below with ComposeStep, so a level
+     * N grammar is a fold of N Level 1 items. Level 2 is drawn from the
+     * catalog built by BuildLv2Catalog. The rules are edited in place from
+     * one level to the next, without copying or rescanning them.
+     *
+     * @param level The difficulty level, at least 1.
+     * @return The rules of the grammar.
      */
-    Grammar Lv3();
+    composition Compose(int level);
 
     /**
-     * @brief Generates a Level 4 grammar by combining Level 3 and Level 1
-     * items.
+     * @brief Adds one Level 1 item to a grammar being composed.
      *
-     * This function creates a more complex grammar by combining elements from
-     * Level 3 and Level 1 grammars. It is used to generate grammars with
-     * increased complexity for testing or parsing purposes.
+     * Draws a new terminal that is not in `cmb`, replaces a random terminal of
+     * `base` with it, then replaces another random terminal of `base` with
+     * the non-terminal of `level`. Both replacements are done in a single
+     * pass over the rules of `base`. Finally, the rules of `cmb` are added
+     * with its non-terminal renamed to the new one.
      *
-     * @return A Level 4 grammar.
+     * @param base Grammar being composed.
+     * @param cmb Position in `items` of the Level 1 item to add.
+     * @param level Level of the step, whose non-terminal `cmb` becomes.
      */
-    Grammar Lv4();
+    void ComposeStep(composition& base, std::size_t cmb, int level);
 
     /**
-     * @brief Generates a Level 5 grammar by combining Level 4 and Level 1
-     * items.
+     * @brief Draws the choices of one ComposeStep, without applying them.
+     */
+    step_choice DrawStepChoice(const composition& base, std::size_t cmb);
+
+    /**
+     * @brief Returns the terminal of `base` that a step with these choices
+     * replaces with the new non-terminal.
+     */
+    SymbolId StepNonTerminal(const composition& base,
+                             const step_choice& choice) const;
+
+    /**
+     * @brief Applies the choices of one ComposeStep, in place.
      *
-     * This function creates a more advanced grammar by combining elements from
-     * Level 4 and Level 1 grammars. It is used to generate grammars with
-     * higher complexity for testing or parsing purposes.
+     * @param base Grammar being composed.
+     * @param cmb Position in `items` of the Level 1 item to add.
+     * @param level Level of the step, whose non-terminal `cmb` becomes.
+     * @param choice The choices. `new_terminal_` must not be a terminal of
+     * `cmb`; `to_terminal_` is a position in `base.terminals_`, and `to_nt_`
+     * a position in it after the first replacement.
+     * @param undo Receives what the step changed, if not null.
+     */
+    void ApplyComposeStep(composition& base, std::size_t cmb, int level,
+                          const step_choice& choice,
+                          step_undo*         undo = nullptr) const;
+
+    /**
+     * @brief Restores a composition as it was before the ApplyComposeStep
+     * that filled `undo`, which must be the last step applied to it. Costs
+     * as much as that step, whatever the size of the composition.
+     */
+    void UndoComposeStep(composition& base, const step_undo& undo) const;
+
+    /**
+     * @brief Draws an entry of the Level 2 catalog, with the probability
+     * Compose gives its grammar.
+     */
+    const catalog_entry& DrawLv2();
+
+    /**
+     * @brief Builds the rules of a grammar like Compose, but only with
+     * choices the SLR(1) compatibility matrix allows.
      *
-     * @return A Level 5 grammar.
+     * Starts from a Level 2 catalog entry drawn from `lv2_slr1_`, then draws
+     * every step again while IsSLR1Compatible rejects it. If
+     * MAX_STEP_ATTEMPTS_ draws of a step are all rejected, the grammar starts
+     * over, at most `restarts` times. The result still has to be checked:
+     * the matrix only rules out conflicts that already show with two items.
+     *
+     * @param level The difficulty level, at least 1.
+     * @param rules Receives the rules of the grammar, or those of the last
+     * start on false.
+     * @param restarts Number of starts.
+     * @return false if every start ran out of draws, or the catalog has no
+     * SLR(1) Level 2 entry.
+     */
+    bool ComposeSLR1(int level, composition& rules,
+                     int restarts = MAX_CONSTRUCTION_RESTARTS_);
+
+    /**
+     * @brief Draws the step of `level` on `base` until IsSLR1Compatible
+     * accepts it, see ComposeSLR1.
+     * @return false, leaving `base` as it was, if MAX_STEP_ATTEMPTS_ draws
+     * are all rejected.
      */
-    Grammar Lv5();
+    bool ComposeSLR1Step(composition& base, int level);
 
     /**
-     * @brief Generates a Level 6 grammar by combining Level 5 and Level 1
-     * items.
+     * @brief Checks a step against the SLR(1) compatibility matrix.
      *
-     * This function creates a highly complex grammar by combining elements from
-     * Level 5 and Level 1 grammars. It is used to generate grammars with
-     * advanced structures for testing or parsing purposes.
+     * Every occurrence of the terminal that becomes the new non-terminal is
+     * traced back to the item of its rules and the terminal of the item at
+     * that position; the step is compatible if substituting `cmb` for each
+     * of them gave a SLR(1) grammar for some Level 2 choice.
+     */
+    bool IsSLR1Compatible(const composition& base, std::size_t cmb,
+                          const step_choice& choice) const;
+
+    /**
+     * @brief Fills `slr1_compatible_` from every Level 2 composition,
+     * including the ones of an item with itself, which the catalog leaves
+     * out. Verdicts of the catalog are reused.
+     */
+    void BuildSLR1Compatibility(catalog& cat);
+
+    /**
+     * @brief Returns a Level 1 item as the start of a composition.
+     * @param item Position of the item in `items`.
+     */
+    composition ItemComposition(std::size_t item) const;
+
+    /**
+     * @brief Builds a composition from rules by name, interning their
+     * symbols in a copy of `symbols_`. Non-terminals keep the level of their
+     * name; symbols that are lowercase or EPSILON are terminals.
+     * @param rules Rules without the axiom production, with the
+     * non-terminal of level 1.
+     */
+    composition Composition(
+        const std::unordered_map<std::string, std::vector<production>>& rules)
+        const;
+
+    /**
+     * @brief Enumerates every outcome of the Level 2 composition into
+     * `lv2_catalog_`, with its LL(1) and SLR(1) verdicts.
      *
-     * @return A Level 6 grammar.
+     * Every entry is weighted by the probability of the draws that produce
+     * it, so sampling the catalog takes constant time and gives the same
+     * distribution as composing Level 2 grammars.
      */
-    Grammar Lv6();
+    void BuildLv2Catalog(catalog& cat);
 
     /**
-     * @brief Generates a Level 7 grammar by combining Level 6 and Level 1
-     * items.
+     * @brief Enumerates every grammar of a level into `indices_`.
      *
-     * This function creates a very complex grammar by combining elements from
-     * Level 6 and Level 1 grammars. It is used to generate grammars with
-     * highly advanced structures for testing or parsing purposes.
+     * Walks every choice of the composition: the Level 1 items for level 1,
+     * the Level 2 catalog for level 2, and every ComposeStep of every catalog
+     * entry for level 3. Grammars that only differ by the names of their
+     * terminals are merged (see Canonicalize), and every remaining grammar is
+     * classified by the checks of GenLL1Grammar and GenSLR1Grammar; Level 2
+     * reuses the verdicts of the catalog. Levels 1 and 2 are indexed by Init.
+     * Level 3 takes a few seconds, so it is only indexed on request, see
+     * EnsureIndex.
      *
-     * @return A Level 7 grammar.
+     * The factory gets a copy of its catalog with the index; factories that
+     * share the old catalog keep it.
+     *
+     * @param level Level to index, from 1 to MAX_INDEXED_LEVEL_.
+     */
+    void BuildIndex(int level);
+
+    /**
+     * @brief Builds the index of a level, see BuildIndex, unless it is
+     * already built or the level is above MAX_INDEXED_LEVEL_. The gen and
+     * gen batch commands and GrammarPool call it before they generate.
+     * @param level The difficulty level.
+     */
+    void EnsureIndex(int level);
+
+    /**
+     * @brief Enumerates and classifies every grammar of a level, see
+     * BuildIndex, without storing the result.
+     * @param level Level to index, from 1 to MAX_INDEXED_LEVEL_.
      */
-    Grammar Lv7();
+    std::shared_ptr<const grammar_index> MakeIndex(int level);
 
     /**
-     * @brief Creates a Level 2 grammar item for use in grammar generation.
+     * @brief Renames the terminals of a grammar to a canonical form, so that
+     * two grammars that only differ by the names of their terminals become
+     * equal.
      *
-     * This function generates a Level 2 grammar item, which can be used as a
-     * building block for creating more complex grammars.
+     * The order of the terminals is the one of CanonicalLabeling, in its
+     * terminals only mode, and they take the first names of
+     * `terminal_alphabet_` in that order. EPSILON and non-terminals keep
+     * their names. Productions are sorted.
      *
-     * @return A FactoryItem representing a Level 2 grammar.
+     * @param rules Grammar to rename.
+     * @return A text form of the renamed rules, equal for equal grammars.
+     */
+    std::string Canonicalize(composition& rules) const;
+
+    /**
+     * @brief Calls `visit` with every choice ComposeStep can draw for `base`
+     * and `cmb`, and the number of equally likely choices of the step.
+     * `visit` may apply the choice to `base` if it undoes it before
+     * returning.
+     */
+    void ForEachStepChoice(
+        const composition& base, std::size_t cmb,
+        const std::function<void(const step_choice&, std::uint64_t)>& visit)
+        const;
+
+    /**
+     * @brief Returns the index of a level, or nullptr if it is not built.
+     * @param level The difficulty level.
+     */
+    const grammar_index* IndexOf(int level) const;
+
+    /**
+     * @brief Checks if a grammar is LL(1) without any transformation and
+     * passes the sanity checks: the AS_IS verdict of MakeLL1.
      */
-    FactoryItem CreateLv2Item();
+    bool IsLL1AsIs(Grammar& gr);
+
+    /**
+     * @brief Builds a grammar of `level` that is LL(1) as is: one attempt of
+     * TryGenLL1GrammarByConstruction.
+     * @param state Receives the grammar, complete or not.
+     * @return false if a step ran out of draws, or the drawn item is not
+     * LL(1).
+     */
+    bool ConstructLL1(int level, ll1_construction& state);
+
+    /**
+     * @brief Draws the step of `level` on the grammar of `state` until the
+     * result is LL(1) as is, see GenLL1GrammarByConstruction.
+     * @param state Grammar so far, LL(1) as is, with its sets. Steps are
+     * applied in place, and undone if they conflict.
+     * @return false, leaving `state` as it was, if MAX_STEP_ATTEMPTS_ draws
+     * all conflict.
+     */
+    bool ComposeLL1Step(ll1_construction& state, int level);
+
+    /**
+     * @brief Computes the sets of a composition from scratch, and checks
+     * that it is LL(1).
+     * @param rules The composition, moved into `state`.
+     * @return false if two productions of a non-terminal conflict.
+     */
+    bool InitLL1Sets(composition rules, ll1_construction& state) const;
+
+    /**
+     * @brief Applies one ComposeStep to the grammar of `state`, updates its
+     * sets, and checks the productions whose prediction sets may have
+     * changed.
+     *
+     * The step renames terminal `x` to `t`, which maps `x` to `t` in every
+     * set, then turns terminal `y` into the new non-terminal `N`. Only `N`
+     * and the non-terminals with `y` in FIRST get new NULLABLE and FIRST,
+     * iterated over their production ranges. FIRST of the suffixes is swept
+     * again in the productions `y` left and in those with one of these
+     * non-terminals; FOLLOW is recomputed for `N`, for the non-terminals
+     * before a suffix whose FIRST changed, and for those at a nullable end
+     * of the productions of a recomputed FOLLOW. The sets of the others are
+     * kept. Steps that rename or replace EPSILON recompute everything.
+     *
+     * Base and added items are productive and reachable, so a step keeps
+     * the sanity checks, and no conflict is an LL(1) grammar as is.
+     * @param undo Receives what the step changed, to undo it whatever the
+     * result.
+     * @return false if two productions of a non-terminal conflict.
+     */
+    bool ApplyLL1Step(ll1_construction& state, std::size_t cmb, int level,
+                      const step_choice& choice, ll1_undo& undo) const;
+
+    /**
+     * @brief Restores `state` as it was before the ApplyLL1Step that filled
+     * `undo`, which must be the last step applied to it.
+     */
+    void UndoLL1Step(ll1_construction& state, const ll1_undo& undo) const;
+
+    /**
+     * @brief Checks that the prediction sets of the productions of the
+     * non-terminal at position `a` are disjoint.
+     */
+    bool IsLL1NonTerminal(const ll1_construction& state,
+                          std::uint32_t           a) const;
+
+    /**
+     * @brief Runs one attempt of GenLL1Grammar on a grammar: the sanity
+     * checks and the LL(1) table, then the same after RemoveLeftRecursion,
+     * then after LeftFactorize.
+     * @param gr Grammar to check. It is left transformed as returned.
+     * @return The transformation that made the grammar LL(1), or NOT_LL1.
+     */
+    ll1_fix MakeLL1(Grammar& gr);
+
+    /**
+     * @brief Runs MakeLL1 on a grammar, and tells which check would reject
+     * it: the first sanity check it fails, or REJECTED_CONFLICT.
+     * @param gr Grammar to check. It is left transformed as returned.
+     * @param reason Receives the reason, meaningful if NOT_LL1 is returned.
+     */
+    ll1_fix MakeLL1(Grammar& gr, rejection_reason& reason);
+
+    /**
+     * @brief Runs the part of MakeLL1 that follows IsLL1AsIs: the LL(1)
+     * table after RemoveLeftRecursion, then after LeftFactorize.
+     * @param gr Grammar that is not LL(1) as is. It is left transformed as
+     * returned.
+     * @return REMOVE_LEFT_RECURSION, LEFT_FACTORIZE or NOT_LL1.
+     */
+    ll1_fix FixLL1(Grammar& gr);
+
+    /**
+     * @brief Applies the transformations MakeLL1 found for a grammar.
+     * @param gr Grammar to transform.
+     * @param fix The result of MakeLL1 on `gr`.
+     */
+    void ApplyLL1Fix(Grammar& gr, ll1_fix fix);
+
+    /**
+     * @brief Runs one attempt of GenSLR1Grammar on a grammar.
+     * @param gr Grammar to check.
+     * @return true if the grammar passes the sanity checks and is SLR(1).
+     */
+    bool IsAcceptedSLR1(const Grammar& gr);
+
+    /**
+     * @brief Runs IsAcceptedSLR1 on a grammar, and tells which check rejects
+     * it, like MakeLL1.
+     * @param gr Grammar to check.
+     * @param reason Receives the reason, meaningful if false is returned.
+     */
+    bool IsAcceptedSLR1(const Grammar& gr, rejection_reason& reason);
+
+    /**
+     * @brief Returns the verdicts GenLL1Grammar (`ll1`) or GenSLR1Grammar
+     * (`slr1`) need on a grammar. They come from `verdict_cache_` when it
+     * knows them; the missing ones are computed, like MakeLL1 and
+     * IsAcceptedSLR1 would, and stored.
+     * @param gr Grammar to check. It is not transformed.
+     * @param ll1 Whether `ll1_` of the result is needed.
+     * @param slr1 Whether `slr1_` of the result is needed.
+     * @pre `verdict_cache_` is set.
+     */
+    grammar_verdicts Verdicts(const Grammar& gr, bool ll1, bool slr1);
+
+    /**
+     * @brief Draws a grammar of an index uniformly among the ones
+     * GenLL1Grammar or GenSLR1Grammar accept, with its terminals renamed by
+     * a random bijection onto `terminal_alphabet_`, fixed like GenLL1Grammar
+     * returns it.
+     * @pre The index has a grammar of class `type`.
+     */
+    Grammar DrawIndexed(const grammar_index& index, grammar_class type);
+
+    /**
+     * @brief Draws grammars until one is accepted or one of `limits` is
+     * reached.
+     * @param attempt Draws one grammar into its argument and checks it.
+     * Returns nothing if the grammar is accepted, or why it is rejected.
+     */
+    generation_result
+    Generate(const generation_limits& limits,
+             const std::function<std::optional<rejection_reason>(Grammar&)>&
+                 attempt);
+
+    /// @brief Builds the analysis of a grammar, timed as ANALYSIS_STAGE.
+    std::shared_ptr<const GrammarAnalysis> Analyse(const Grammar& gr);
+
+    /**
+     * @brief Runs one check_stage and counts it in `stats_`.
+     * @param check Runs the stage; returns true if it rejects the grammar.
+     * @return What `check` returned.
+     */
+    template <typename Check> bool Timed(check_stage stage, Check&& check) {
+        return Timed(stage, nullptr, check);
+    }
+
+    /**
+     * @brief Runs one check_stage and counts it in `stats_`, and in `order`
+     * if it is not null.
+     */
+    template <typename Check>
+    bool Timed(check_stage stage, CheckOrder* order, Check&& check) {
+        const auto start  = std::chrono::steady_clock::now();
+        const bool failed = check();
+        const auto ns     = static_cast<std::uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start)
+                .count());
+        stats_.stages_[stage].Record(ns, failed);
+        if (order != nullptr) {
+            order->Record(stage, ns, failed);
+        }
+        return failed;
+    }
+
+    /// @brief Which checks of a grammar ran, and which of them rejected it,
+    /// as masks of `1 << check_stage`.
+    struct check_results {
+        std::uint32_t ran_{0};
+        std::uint32_t rejected_{0};
+    };
+
+    /**
+     * @brief Runs checks in the order of `order`, up to the first one that
+     * rejects the grammar, and measures them for the next orders.
+     *
+     * The analysis is only built once a check needs it, so a grammar that
+     * HasDirectLeftRecursion rejects first is never analysed.
+     * @param order Checks to run: LEFT_RECURSION_STAGE, INFINITE_STAGE,
+     * UNREACHABLE_STAGE, LL1_TABLE_STAGE or SLR1_AUTOMATON_STAGE.
+     * @param gr Grammar to check.
+     * @param analysis Analysis of `gr`, or null; built if a check needs it.
+     * @param results Receives the checks that ran, see Rejection.
+     * @return true if every check passed.
+     */
+    bool RunChecks(CheckOrder& order, const Grammar& gr,
+                   std::shared_ptr<const GrammarAnalysis>& analysis,
+                   check_results&                          results);
+
+    /**
+     * @brief Runs one check of RunChecks, timed, and adds it to `results`.
+     * @param order Order that measures the check, or null.
+     * @return true if the check rejects the grammar.
+     */
+    bool RunCheck(check_stage stage, CheckOrder* order, const Grammar& gr,
+                  std::shared_ptr<const GrammarAnalysis>& analysis,
+                  check_results&                          results);
+
+    /**
+     * @brief Returns the reason of a grammar that RunChecks rejected, so that
+     * it does not depend on the order the checks ran in: the sanity checks
+     * that did not run yet are run, and the first one that fails in the
+     * order of rejection_reason gives the reason, else REJECTED_CONFLICT.
+     */
+    rejection_reason Rejection(const Grammar&                          gr,
+                               std::shared_ptr<const GrammarAnalysis>& analysis,
+                               check_results&                          results);
+
+    /**
+     * @brief Returns the name of the non-terminal introduced at `level`:
+     * the letters of `non_terminal_alphabet_`, then generated names `N8`,
+     * `N9`, ... for levels beyond the alphabet.
+     * @param level The difficulty level, at least 2.
+     */
+    std::string NonTerminalName(int level) const;
 
     // -------- SANITY CHECKS --------
 
@@ -175,6 +1140,14 @@ struct GrammarFactory {
      */
     bool HasUnreachableSymbols(Grammar& grammar) const;
 
+    /**
+     * @brief Checks for unreachable symbols reusing an existing analysis of
+     * the grammar.
+     * @param analysis Analysis of the grammar to check.
+     * @return true if there are unreachable symbols, false otherwise.
+     */
+    bool HasUnreachableSymbols(const GrammarAnalysis& analysis) const;
+
     /**
      * @brief Checks if a grammar is infinite, meaning there are non-terminal
      * symbols that can never derive a terminal string. This happens when a
@@ -188,6 +1161,14 @@ struct GrammarFactory {
      */
     bool IsInfinite(Grammar& grammar) const;
 
+    /**
+     * @brief Checks if a grammar is infinite reusing an existing analysis of
+     * the grammar.
+     * @param analysis Analysis of the grammar to check.
+     * @return true if the grammar has infinite derivations, false otherwise.
+     */
+    bool IsInfinite(const GrammarAnalysis& analysis) const;
+
     /**
      * @brief Checks if a grammar contains direct left recursion (a non-terminal
      * can produce itself on the left side of a production in one step).
@@ -203,13 +1184,21 @@ struct GrammarFactory {
      */
     bool HasIndirectLeftRecursion(Grammar& grammar);
 
+    /**
+     * @brief Checks for indirect left recursion reusing an existing analysis
+     * of the grammar, including its nullable symbols.
+     * @param analysis Analysis of the grammar to check.
+     * @return true if there is left recursion, false otherwise.
+     */
+    bool HasIndirectLeftRecursion(const GrammarAnalysis& analysis);
+
     /**
      * @brief Checks if directed graph has a cycle using topological sort.
      * @param graph The directed graph.
      * @return true if grammar has cycle.
      */
     bool HasCycle(
-        const std::unordered_map<std::string, std::unordered_set<std::string>>&
+        const std::unordered_map<SymbolId, std::unordered_set<SymbolId>>&
             graph) const;
 
     /**
@@ -300,21 +1289,52 @@ struct GrammarFactory {
      */
     std::string GenerateNewNonTerminal(const Grammar&     grammar,
                                        const std::string& base) const;
+    /// @brief Catalog of factories that were not initialized: no items.
+    static const std::shared_ptr<const catalog>& EmptyCatalog();
+
     /**
-     * @brief A vector of FactoryItem objects representing different level 1
-     * grammar items created by the Init method.
+     * @brief Catalog the factory generates from. Init and BuildIndex replace
+     * it; nothing changes it once it is shared.
      */
-    std::vector<FactoryItem> items;
+    std::shared_ptr<const catalog> catalog_{EmptyCatalog()};
+
+    /**
+     * @brief Cache of the verdicts of generated grammars, which GenLL1Grammar
+     * and GenSLR1Grammar look up before any analysis, if set. Levels with an
+     * index never analyse grammars, so only deeper levels use it.
+     */
+    std::shared_ptr<VerdictCache> verdict_cache_;
+
+    /**
+     * @brief What the retry loops of GenLL1Grammar and GenSLR1Grammar, and
+     * every MakeLL1, IsAcceptedSLR1 and Verdicts, did: attempts, rejections,
+     * LL(1) fixes and time per check_stage. Copy it to take a snapshot,
+     * assign it `{}` to reset it. The checks of Init and BuildIndex are not
+     * counted, nor those of the copies GenerateBatch works on.
+     */
+    generation_stats stats_;
+
+    /**
+     * @brief Order of the checks MakeLL1 runs before its fixes: whatever
+     * fails one of them is not LL(1) as is. Starts with the check that
+     * needs no analysis.
+     */
+    CheckOrder ll1_checks_{{LEFT_RECURSION_STAGE, INFINITE_STAGE,
+                            UNREACHABLE_STAGE, LL1_TABLE_STAGE}};
+
+    /// @brief Order of the checks of IsAcceptedSLR1.
+    CheckOrder slr1_checks_{
+        {INFINITE_STAGE, UNREACHABLE_STAGE, SLR1_AUTOMATON_STAGE}};
 
     /**
-     * @brief A vector of terminal symbols (alphabet) used in the grammar.
+     * @brief Seed of `rng_`, kept so that a run can be reproduced. Drawn from
+     * `std::random_device` unless set with Seed.
      */
-    std::vector<std::string> terminal_alphabet_{"a", "b", "c", "d", "e", "f",
-                                                "g", "h", "i", "j", "k", "l"};
+    std::uint64_t seed_{std::random_device{}()};
 
     /**
-     * @brief A vector of non-terminal symbols (alphabet) used in the grammar.
+     * @brief Random engine all levels draw from, reading one stream of
+     * `seed_`.
      */
-    std::vector<std::string> non_terminal_alphabet_{"A", "B", "C", "D",
-                                                    "E", "F", "G"};
+    PhiloxEngine rng_{seed_};
 };
@@ -0,0 +1,213 @@
+#pragma once
+#include "bounded_ring.hpp"
+#include "grammar.hpp"
+#include "grammar_factory.hpp"
+#include "ll1_parser.hpp"
+#include "slr1_parser.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stop_token>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief A grammar of a GrammarPool, ready to be served with its parsing
+ * tables built.
+ */
+struct pooled_grammar {
+    /// @brief Index of the grammar in the batch of its pool, see GrammarPool.
+    std::uint64_t index_{0};
+
+    /// @brief The grammar as GenLL1Grammar returns it, or as GenSLR1Grammar
+    /// returns it, augmented.
+    Grammar grammar_;
+
+    /// @brief Parser of an LL(1) grammar, after CreateLL1Table.
+    std::optional<LL1Parser> ll1_;
+
+    /// @brief Parser of an SLR(1) grammar, after MakeParser.
+    std::optional<SLR1Parser> slr1_;
+};
+
+/**
+ * @brief Watermarks and threads of a GrammarPool.
+ */
+struct pool_config {
+    /// @brief A pool is refilled once it holds fewer grammars than this.
+    std::size_t low_watermark_{4};
+
+    /// @brief A pool is refilled up to this many grammars.
+    std::size_t high_watermark_{16};
+
+    /// @brief Number of background threads that refill the pools.
+    std::size_t threads_{1};
+};
+
+/**
+ * @brief Counters of one pool, see GrammarPool::Stats.
+ */
+struct pool_stats {
+    /// @brief TryTake calls that returned a grammar.
+    std::uint64_t hits_{0};
+
+    /// @brief TryTake calls that found the pool empty.
+    std::uint64_t misses_{0};
+
+    /// @brief Grammars the background threads added.
+    std::uint64_t generated_{0};
+
+    /// @brief Times the pool went below the low watermark, then back up to
+    /// the high one. Filling the pool at start counts as one.
+    std::uint64_t refills_{0};
+
+    /// @brief Time the refills took in total, in nanoseconds.
+    std::uint64_t total_lag_ns_{0};
+
+    /// @brief Time the longest refill took, in nanoseconds.
+    std::uint64_t max_lag_ns_{0};
+
+    /// @brief Grammars ready now.
+    std::size_t size_{0};
+};
+
+/**
+ * @brief Pools of pre-generated grammars, one per (grammar class, level),
+ * refilled by background threads, so a grammar can be served without
+ * waiting for the retries of GenLL1Grammar or GenSLR1Grammar.
+ *
+ * Every pool is a BoundedRing: TryTake never locks nor waits. A pool that
+ * falls below `low_watermark_` wakes the background threads, which refill
+ * the emptiest pools up to `high_watermark_`. Every thread generates from
+ * its own GrammarFactory over the shared catalog; grammar #i of a pool is
+ * GenLL1Grammar(level, i) or GenSLR1Grammar(level, i) for `seed`, so a pool
+ * serves the same grammars for the same seed, in the order they are done.
+ */
+class GrammarPool {
+  public:
+    /// @brief The class and level of the grammars of one pool.
+    using pool_key = std::pair<GrammarFactory::grammar_class, int>;
+
+    /**
+     * @brief Creates the pools and starts filling them. Levels that the
+     * catalog can index but has no index for are indexed first, see
+     * GrammarFactory::EnsureIndex.
+     *
+     * @param catalog Catalog of an initialized factory.
+     * @param seed Seed of the grammars, see GrammarFactory::Seed.
+     * @param keys Pools to keep; repeated keys are ignored.
+     * @param config Watermarks and threads.
+     * @throws std::invalid_argument if a level is below 1, or the high
+     * watermark is 0 or below the low one.
+     */
+    GrammarPool(std::shared_ptr<const GrammarFactory::catalog> catalog,
+                std::uint64_t seed, const std::vector<pool_key>& keys,
+                pool_config config);
+
+    /**
+     * @brief Stops the background threads. A thread in the middle of a
+     * grammar gives it up at its next attempt.
+     */
+    ~GrammarPool();
+
+    GrammarPool(const GrammarPool&)            = delete;
+    GrammarPool& operator=(const GrammarPool&) = delete;
+
+    /**
+     * @brief Takes a ready grammar, without waiting.
+     * @return The grammar, or nullptr if its pool is empty or does not
+     * exist.
+     */
+    std::unique_ptr<pooled_grammar> TryTake(GrammarFactory::grammar_class type,
+                                            int level);
+
+    /**
+     * @brief Returns the counters of a pool.
+     * @throws std::out_of_range if the pool does not exist.
+     */
+    pool_stats Stats(GrammarFactory::grammar_class type, int level) const;
+
+    /**
+     * @brief Waits until every pool holds `high_watermark_` grammars.
+     * @return false if the timeout expired first.
+     */
+    bool WaitFull(std::chrono::milliseconds timeout) const;
+
+  private:
+    /// @brief One ring of grammars, with its refill state and counters.
+    struct pool {
+        pool(pool_key key, std::size_t capacity)
+            : key_(key), ring_(capacity) {}
+
+        pool_key                                     key_;
+        BoundedRing<std::unique_ptr<pooled_grammar>> ring_;
+
+        /// @brief Grammars being generated for the pool.
+        std::atomic<std::size_t> pending_{0};
+
+        /// @brief Whether the pool is between the watermarks on its way up.
+        std::atomic<bool> refilling_{true};
+
+        /// @brief Steady clock time the refill started, in nanoseconds.
+        std::atomic<std::int64_t> refill_start_ns_{0};
+
+        /// @brief Index of the next grammar to generate.
+        std::atomic<std::uint64_t> next_index_{0};
+
+        std::atomic<std::uint64_t> hits_{0};
+        std::atomic<std::uint64_t> misses_{0};
+        std::atomic<std::uint64_t> generated_{0};
+        std::atomic<std::uint64_t> refills_{0};
+        std::atomic<std::uint64_t> total_lag_ns_{0};
+        std::atomic<std::uint64_t> max_lag_ns_{0};
+    };
+
+    /// @brief Returns the pool of a key, or nullptr.
+    pool* Find(GrammarFactory::grammar_class type, int level) const;
+
+    /**
+     * @brief Picks the refilling pool that misses the most grammars, and
+     * counts one more pending grammar for it.
+     * @return The pool, or nullptr if no pool needs a grammar.
+     */
+    pool* Reserve();
+
+    /**
+     * @brief Generates one grammar of a pool, with its tables.
+     * @return The grammar, or nullptr if the pool is being destroyed.
+     */
+    std::unique_ptr<pooled_grammar> Generate(GrammarFactory& factory,
+                                             pool&           p) const;
+
+    /// @brief Body of every background thread.
+    void Refill();
+
+    /// @brief Steady clock time, in nanoseconds.
+    static std::int64_t Now();
+
+    std::shared_ptr<const GrammarFactory::catalog> catalog_;
+    std::uint64_t                                  seed_;
+    pool_config                                    config_;
+    std::vector<std::unique_ptr<pool>>             pools_;
+
+    /// @brief Requested by the destructor: stops the background threads,
+    /// and the grammars they are generating.
+    std::stop_source stop_;
+
+    /// @brief Wakes the background threads when a pool needs a refill.
+    std::mutex              wake_mutex_;
+    std::condition_variable wake_;
+
+    /// @brief Refills requested so far, under `wake_mutex_`. A thread that
+    /// found nothing to do waits until it changes, so a request made while
+    /// it was looking is not missed.
+    std::uint64_t refill_requests_{0};
+
+    std::vector<std::thread> threads_;
+};
@@ -1,5 +1,10 @@
 #pragma once
+#include "compact_grammar.hpp"
+#include "first_follow.hpp"
 #include "grammar.hpp"
+#include "grammar_analysis.hpp"
+#include <cstdint>
+#include <memory>
 #include <span>
 #include <stack>
 #include <string>
@@ -18,23 +23,33 @@ class LL1Parser {
      * the current non-terminal and the next input symbol.
      *
      * The table is structured as:
-     * - Outer map: Keys are non-terminal symbols (std::string).
-     * - Inner map: Keys are input symbols (std::string), and values are vectors
-     *   of productions (std::vector<production>) that can be applied.
+     * - Outer map: Keys are non-terminal symbols (SymbolId).
+     * - Inner map: Keys are input symbols (SymbolId), and values are vectors
+     *   of productions (std::vector<id_production>) that can be applied.
      *
-     * @see production
+     * @see id_production
      */
     using ll1_table = std::unordered_map<
-        std::string, std::unordered_map<std::string, std::vector<production>>>;
+        SymbolId, std::unordered_map<SymbolId, std::vector<id_production>>>;
 
   public:
     LL1Parser() = default;
     /**
      * @brief Constructs an LL1Parser with a grammar object and an input file.
      *
-     * @param gr Grammar object to parse with
+     * @param gr Grammar object to parse with. It is not copied: the parser
+     * only keeps its analysis.
      */
-    LL1Parser(Grammar gr);
+    LL1Parser(const Grammar& gr);
+
+    /**
+     * @brief Constructs an LL1Parser that reuses an existing analysis of the
+     * grammar, e.g. one already used by SLR1Parser or the factory checks.
+     * FIRST and FOLLOW are computed when first needed, not here.
+     *
+     * @param analysis Analysis of the grammar to parse with.
+     */
+    explicit LL1Parser(std::shared_ptr<const GrammarAnalysis> analysis);
 
     /**
      * @brief Creates the LL(1) parsing table for the grammar.
@@ -59,6 +74,20 @@ class LL1Parser {
      */
     bool CreateLL1Table();
 
+    /**
+     * @brief Checks whether the grammar is LL(1), like CreateLL1Table, but
+     * without building the table.
+     *
+     * The prediction sets of the productions of every non-terminal are
+     * compared as bit sets, and the check stops at the first conflict. FOLLOW
+     * is only computed if some production can derive EPSILON, so a grammar
+     * with a FIRST/FIRST conflict, or without nullable productions, only
+     * needs FIRST.
+     *
+     * @return The result CreateLL1Table would return.
+     */
+    bool IsLL1() const;
+
     void PrintTable();
 
     /**
@@ -79,14 +108,26 @@ class LL1Parser {
      * - If the entire rule could derive epsilon (i.e., each symbol in the rule
      * can derive epsilon), then epsilon is added to the FIRST set.
      *
-     * @param rule A span of strings representing the production rule for which
-     * to compute the FIRST set. Each string in the span is a symbol (either
+     * @param rule A span of symbol ids representing the production rule for
+     * which to compute the FIRST set. Each id in the span is a symbol (either
      * terminal or non-terminal).
-     * @param result A reference to an unordered set of strings where the
+     * @param result A reference to an unordered set of ids where the
      * computed FIRST set will be stored. The set will contain all terminal
      * symbols that can start derivations of the rule, and possibly epsilon if
      * the rule can derive an empty string.
      */
+    void First(std::span<const SymbolId>     rule,
+               std::unordered_set<SymbolId>& result);
+
+    /**
+     * @brief Calculates the FIRST set of a sequence of symbol names.
+     *
+     * Name-based counterpart of First for callers that work with symbol
+     * names. Every name must be interned in the grammar's symbol table.
+     *
+     * @param rule Sequence of symbol names.
+     * @param result Set where the names of the FIRST symbols are stored.
+     */
     void First(std::span<const std::string>     rule,
                std::unordered_set<std::string>& result);
 
@@ -95,10 +136,9 @@ class LL1Parser {
      * grammar.
      *
      * This function calculates the FIRST set for each non-terminal symbol in
-     * the grammar by iteratively applying a least fixed-point algorithm. This
-     * approach ensures that the FIRST sets are fully populated by repeatedly
-     * expanding and updating the sets until no further changes occur (i.e., a
-     * fixed-point is reached).
+     * the grammar, solving the dependencies between non-terminals component
+     * by component (FirstFollow::ComputeFirstSets). The sets are cached in
+     * the shared analysis, so they are only computed once per grammar.
      */
     void ComputeFirstSets();
 
@@ -117,40 +157,17 @@ class LL1Parser {
      * 2. For each production rule of the form A → αBβ:
      *    - Add FIRST(β) (excluding ε) to FOLLOW(B).
      *    - If ε ∈ FIRST(β), add FOLLOW(A) to FOLLOW(B).
-     * 3. Repeat step 2 until no changes occur in any FOLLOW set.
+     * 3. Propagate FOLLOW(A) to FOLLOW(B) along the relations of step 2
+     *    once, component by component (FirstFollow::ComputeFollowSets).
      *
-     * The computed FOLLOW sets are cached in the `follow_sets_` member variable
-     * for later use by the parser.
-     *
-     * @note This function assumes that the FIRST sets for all symbols have
-     * already been computed and are available in the `first_sets_` member
-     * variable.
+     * The computed FOLLOW sets are cached in the shared analysis for later
+     * use by the parser. FIRST sets are computed first if needed.
      *
      * @see First
-     * @see follow_sets_
+     * @see analysis_
      */
     void ComputeFollowSets();
 
-    /**
-     * @brief Updates the FOLLOW set for a non-terminal based on a production.
-     *
-     * This method updates the FOLLOW set of a given non-terminal symbol based
-     * on its position within a production. It considers:
-     * - The FIRST set of the remaining symbols after the current non-terminal.
-     * - The FOLLOW set of the left-hand side non-terminal, if the remaining
-     * symbols can derive ε.
-     *
-     * @param symbol The non-terminal symbol whose FOLLOW set is being updated.
-     * @param lhs The left-hand side non-terminal of the current production.
-     * @param rhs The production (right-hand side) containing the symbol.
-     * @param i The position of the symbol within the production.
-     *
-     * @return true if the FOLLOW set was modified (new elements were added),
-     * false otherwise.
-     */
-    bool UpdateFollow(const std::string& symbol, const std::string& lhs,
-                      const production& rhs, size_t i);
-
     /**
      * @brief Computes the FOLLOW set for a given non-terminal symbol in the
      * grammar.
@@ -162,9 +179,17 @@ class LL1Parser {
      * determine possible continuations after a non-terminal.
      *
      * @param arg Non-terminal symbol for which to compute the FOLLOW set.
-     * @return An unordered set of strings containing symbols that form the
+     * @return An unordered set of ids containing symbols that form the
      * FOLLOW set for `arg`.
      */
+    std::unordered_set<SymbolId> Follow(SymbolId arg);
+
+    /**
+     * @brief Returns the FOLLOW set of a non-terminal given by name.
+     *
+     * @param arg Name of the non-terminal.
+     * @return The names of the symbols in the FOLLOW set of `arg`.
+     */
     std::unordered_set<std::string> Follow(const std::string& arg);
 
     /**
@@ -186,25 +211,31 @@ class LL1Parser {
      * @param antecedent The left-hand side non-terminal symbol of the rule.
      * @param consequent A vector of symbols on the right-hand side of the rule
      * (production body).
-     * @return An unordered set of strings containing the prediction symbols for
+     * @return An unordered set of ids containing the prediction symbols for
      * the specified rule.
      */
-    std::unordered_set<std::string>
-    PredictionSymbols(const std::string&              antecedent,
-                      const std::vector<std::string>& consequent);
+    std::unordered_set<SymbolId>
+    PredictionSymbols(SymbolId                  antecedent,
+                      std::span<const SymbolId> consequent);
+
+    /**
+     * @brief Computes the prediction symbols of a production of the grammar.
+     *
+     * Same result as PredictionSymbols(antecedent, consequent), but FIRST of
+     * the consequent is looked up in the FIRST-of-suffix table instead of
+     * being recomputed.
+     *
+     * @param production Index of the production in the compact grammar.
+     * @return An unordered set of ids containing the prediction symbols for
+     * the production.
+     */
+    std::unordered_set<SymbolId> PredictionSymbols(std::uint32_t production);
 
     /// @brief The LL(1) parsing table, mapping non-terminals and terminals to
     /// productions.
     ll1_table ll1_t_;
 
-    /// @brief Grammar object associated with this parser.
-    Grammar gr_;
-
-    /// @brief FIRST sets for each non-terminal in the grammar.
-    std::unordered_map<std::string, std::unordered_set<std::string>>
-        first_sets_;
-
-    /// @brief FOLLOW sets for each non-terminal in the grammar.
-    std::unordered_map<std::string, std::unordered_set<std::string>>
-        follow_sets_;
+    /// @brief Compact form, symbol table, nullable symbols, FIRST and FOLLOW
+    /// sets of the grammar, possibly shared with other parsers.
+    std::shared_ptr<const GrammarAnalysis> analysis_;
 };
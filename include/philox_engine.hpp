@@ -0,0 +1,141 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+/**
+ * @brief Counter-based random engine (Philox4x32-10, Salmon et al., "Parallel
+ * random numbers: as easy as 1, 2, 3", SC'11).
+ *
+ * The engine has no state besides a key and a counter: the n-th block of
+ * output is a bijective scramble of the counter n under the key. The key is
+ * the seed, and the counter is split into a 64-bit stream index and a 64-bit
+ * block position inside the stream. Every (seed, stream) pair is therefore an
+ * independent sequence of 2^66 numbers that can be opened directly, without
+ * replaying the streams before it. GrammarFactory gives grammar #k of a batch
+ * stream k, so the grammar does not depend on how a batch is split between
+ * threads.
+ *
+ * Meets the UniformRandomBitGenerator requirements, so it can feed the
+ * standard distributions.
+ */
+class PhiloxEngine {
+  public:
+    using result_type = std::uint32_t;
+
+    PhiloxEngine() = default;
+
+    /**
+     * @brief Opens stream `stream` of seed `seed`, at its first number.
+     *
+     * @param seed Key of the engine.
+     * @param stream Index of the stream.
+     */
+    explicit PhiloxEngine(std::uint64_t seed, std::uint64_t stream = 0) {
+        Seed(seed, stream);
+    }
+
+    /**
+     * @brief Opens stream `stream` of seed `seed`, at its first number.
+     *
+     * @param seed Key of the engine.
+     * @param stream Index of the stream.
+     */
+    void Seed(std::uint64_t seed, std::uint64_t stream = 0) {
+        key_    = {static_cast<std::uint32_t>(seed),
+                   static_cast<std::uint32_t>(seed >> 32)};
+        stream_ = stream;
+        block_  = 0;
+        next_   = BLOCK_SIZE_;
+    }
+
+    /// @brief Index of the stream being read.
+    std::uint64_t Stream() const { return stream_; }
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() {
+        return std::numeric_limits<result_type>::max();
+    }
+
+    /**
+     * @brief Returns the next number of the stream.
+     */
+    result_type operator()() {
+        if (next_ == BLOCK_SIZE_) {
+            output_ = Block(key_, {static_cast<std::uint32_t>(block_),
+                                   static_cast<std::uint32_t>(block_ >> 32),
+                                   static_cast<std::uint32_t>(stream_),
+                                   static_cast<std::uint32_t>(stream_ >> 32)});
+            ++block_;
+            next_ = 0;
+        }
+        return output_[next_++];
+    }
+
+    /**
+     * @brief Skips the next `n` numbers of the stream.
+     */
+    void Discard(std::uint64_t n) {
+        const std::uint64_t buffered = BLOCK_SIZE_ - next_;
+        if (n <= buffered) {
+            next_ += static_cast<std::size_t>(n);
+            return;
+        }
+        n -= buffered;
+        block_ += n / BLOCK_SIZE_;
+        next_ = BLOCK_SIZE_;
+        for (std::uint64_t i = 0; i < n % BLOCK_SIZE_; ++i) {
+            (*this)();
+        }
+    }
+
+    /// @brief Numbers produced per evaluation of the block function.
+    static constexpr std::size_t BLOCK_SIZE_ = 4;
+
+    using counter = std::array<std::uint32_t, BLOCK_SIZE_>;
+    using key     = std::array<std::uint32_t, 2>;
+
+    /**
+     * @brief Philox4x32 block function with 10 rounds.
+     *
+     * @param k Key.
+     * @param ctr Counter.
+     * @return Four random words for this (key, counter) pair.
+     */
+    static counter Block(key k, counter ctr) {
+        for (int round = 0; round < 10; ++round) {
+            const std::uint64_t p0 = std::uint64_t{M0_} * ctr[0];
+            const std::uint64_t p1 = std::uint64_t{M1_} * ctr[2];
+            ctr                    = {
+                static_cast<std::uint32_t>(p1 >> 32) ^ ctr[1] ^ k[0],
+                static_cast<std::uint32_t>(p1),
+                static_cast<std::uint32_t>(p0 >> 32) ^ ctr[3] ^ k[1],
+                static_cast<std::uint32_t>(p0)};
+            k[0] += W0_;
+            k[1] += W1_;
+        }
+        return ctr;
+    }
+
+  private:
+    static constexpr std::uint32_t M0_ = 0xD2511F53;
+    static constexpr std::uint32_t M1_ = 0xCD9E8D57;
+    static constexpr std::uint32_t W0_ = 0x9E3779B9;
+    static constexpr std::uint32_t W1_ = 0xBB67AE85;
+
+    /// @brief Key, i.e. the seed.
+    key key_{};
+
+    /// @brief Index of the stream: high half of the counter.
+    std::uint64_t stream_{0};
+
+    /// @brief Next block of the stream: low half of the counter.
+    std::uint64_t block_{0};
+
+    /// @brief Last block produced.
+    counter output_{};
+
+    /// @brief Position of the next number in `output_`.
+    std::size_t next_{BLOCK_SIZE_};
+};
@@ -1,7 +1,11 @@
 #pragma once
 
+#include <compare>
+#include <cstdint>
 #include <string>
-#include <vector>
+
+#include "compact_grammar.hpp"
+#include "symbol_table.hpp"
 
 /**
  * @brief Represents an LR(0) item in the grammar.
@@ -10,89 +14,98 @@
  * current position in the rule. It is used during the construction of the
  * LR(0) state machine for parsing.
  *
- * @var antecedent_ The non-terminal symbol on the left-hand side of the
- * production.
- * @var consequent_ The sequence of symbols on the right-hand side of the
- * production.
- * @var epsilon_ The epsilon symbol (empty string) used in the grammar.
- * @var eol_ The end-of-input marker used in the grammar.
+ * The item only stores the index of its production in a CompactGrammar and
+ * the dot position, so it is 8 bytes, trivially copyable, and compared and
+ * hashed with a few integer operations. Everything else (antecedent, symbols
+ * of the production, names) is resolved through the grammar.
+ *
+ * @var production_ Index of the production in the CompactGrammar.
  * @var dot_ The position of the dot in the production (default is 0).
  */
 struct Lr0Item {
-    std::string antecedent_; ///< The non-terminal symbol on the left-hand side.
-    std::vector<std::string>
-        consequent_;       ///< The sequence of symbols on the right-hand side.
-    std::string  epsilon_; ///< The epsilon symbol (empty string).
-    std::string  eol_;     ///< The end-of-input marker.
-    unsigned int dot_ = 0; ///< The position of the dot in the production.
+    std::uint32_t production_; ///< Index of the production.
+    std::uint32_t dot_ = 0;    ///< The position of the dot in the production.
 
     /**
-     * @brief Constructs an LR(0) item with the dot at the beginning.
+     * @brief Constructs an LR(0) item with the dot at a specific position.
+     *
+     * Items of epsilon productions (`A -> EPSILON`) are always complete, so
+     * their dot is placed at the end.
      *
-     * @param antecedent The non-terminal symbol on the left-hand side.
-     * @param consequent The sequence of symbols on the right-hand side.
-     * @param epsilon The epsilon symbol (empty string).
-     * @param eol The end-of-input marker.
+     * @param grammar The grammar the production belongs to.
+     * @param production Index of the production in `grammar`.
+     * @param dot The position of the dot in the production.
      */
-    Lr0Item(std::string antecedent, std::vector<std::string> consequent,
-            std::string epsilon, std::string eol);
+    Lr0Item(const CompactGrammar& grammar, std::uint32_t production,
+            std::uint32_t dot = 0);
 
     /**
-     * @brief Constructs an LR(0) item with the dot at a specific position.
+     * @brief Returns the antecedent of the item's production.
      *
-     * @param antecedent The non-terminal symbol on the left-hand side.
-     * @param consequent The sequence of symbols on the right-hand side.
-     * @param dot The position of the dot in the production.
-     * @param epsilon The epsilon symbol (empty string).
-     * @param eol The end-of-input marker.
+     * @param grammar The grammar the production belongs to.
      */
-    Lr0Item(std::string antecedent, std::vector<std::string> consequent,
-            unsigned int dot, std::string epsilon, std::string eol);
+    SymbolId Antecedent(const CompactGrammar& grammar) const {
+        return grammar.Lhs(production_);
+    }
 
     /**
      * @brief Returns the symbol immediately after the dot.
      *
-     * @return The symbol after the dot, or an empty string if the dot is at the
+     * @param grammar The grammar the production belongs to.
+     * @return The symbol after the dot, or epsilon if the dot is at the
      * end.
      */
-    std::string NextToDot() const;
+    SymbolId NextToDot(const CompactGrammar& grammar) const;
 
     /**
      * @brief Prints the LR(0) item to the standard output.
+     *
+     * @param grammar Grammar used to resolve the production and its names.
      */
-    void PrintItem() const;
+    void PrintItem(const CompactGrammar& grammar) const;
 
     /**
      * @brief Converts the LR(0) item to a string representation.
      *
+     * @param grammar Grammar used to resolve the production and its names.
      * @return A string representation of the LR(0) item.
      */
-    std::string ToString() const;
+    std::string ToString(const CompactGrammar& grammar) const;
 
     /**
      * @brief Advances the dot position by one.
+     *
+     * @param grammar The grammar the production belongs to.
      */
-    void AdvanceDot();
+    void AdvanceDot(const CompactGrammar& grammar);
 
     /**
      * @brief Checks if the LR(0) item is complete (i.e., the dot is at the
      * end).
      *
+     * @param grammar The grammar the production belongs to.
      * @return `true` if the dot is at the end of the production, `false`
      * otherwise.
      */
-    bool IsComplete() const;
+    bool IsComplete(const CompactGrammar& grammar) const;
 
     /**
      * @brief Compares two LR(0) items for equality.
      *
-     * Two LR(0) items are considered equal if they have the same antecedent,
-     * consequent, and dot position.
+     * Two LR(0) items are considered equal if they have the same production
+     * and dot position.
      *
      * @param other The LR(0) item to compare with.
      * @return `true` if the items are equal, `false` otherwise.
      */
-    bool operator==(const Lr0Item& other) const;
+    bool operator==(const Lr0Item& other) const = default;
+
+    /**
+     * @brief Orders LR(0) items by production and then by dot position.
+     *
+     * Used to sort state kernels into a canonical form.
+     */
+    auto operator<=>(const Lr0Item& other) const = default;
 };
 
 /**
@@ -100,19 +113,24 @@ struct Lr0Item {
  *
  * This specialization allows `Lr0Item` objects to be used as keys in unordered
  * containers (e.g., `std::unordered_set` or `std::unordered_map`). The hash
- * value is computed based on the antecedent, consequent, and dot position.
+ * value is computed based on the production index and dot position.
  */
 namespace std {
 template <> struct hash<Lr0Item> {
     /**
      * @brief Computes the hash value for an `Lr0Item` object.
      *
-     * The hash value is computed by combining the hash values of the
-     * antecedent, consequent, and dot position.
+     * Packs the production index and the dot position in a 64-bit word and
+     * mixes it with a multiplicative hash.
      *
      * @param item The LR(0) item for which to compute the hash value.
      * @return The computed hash value.
      */
-    size_t operator()(const Lr0Item& item) const;
+    size_t operator()(const Lr0Item& item) const {
+        std::uint64_t key =
+            (static_cast<std::uint64_t>(item.production_) << 32) | item.dot_;
+        key *= 0x9e3779b97f4a7c15ULL;
+        return static_cast<size_t>(key ^ (key >> 32));
+    }
 };
 } // namespace std
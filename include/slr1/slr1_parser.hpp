@@ -1,11 +1,18 @@
 #pragma once
 
 #include <map>
+#include <memory>
 #include <span>
 #include <string>
+#include <unordered_map>
 #include <unordered_set>
+#include <utility>
+#include <vector>
 
+#include "compact_grammar.hpp"
+#include "first_follow.hpp"
 #include "grammar.hpp"
+#include "grammar_analysis.hpp"
 #include "lr0_item.hpp"
 #include "state.hpp"
 
@@ -49,11 +56,11 @@ class SLR1Parser {
      *
      * The table is structured as:
      * - Outer map: Keys are state IDs (unsigned int).
-     * - Inner map: Keys are input symbols (std::string), and values are
+     * - Inner map: Keys are input symbols (SymbolId), and values are
      * `s_action` structs representing the action to take.
      */
     using action_table =
-        std::map<unsigned int, std::map<std::string, SLR1Parser::s_action>>;
+        std::map<unsigned int, std::map<SymbolId, SLR1Parser::s_action>>;
 
     /**
      * @brief Represents the transition table for the SLR(1) parser.
@@ -64,12 +71,20 @@ class SLR1Parser {
      *
      * The table is structured as:
      * - Outer map: Keys are state IDs (unsigned int).
-     * - Inner map: Keys are symbols (std::string), and values are the next
+     * - Inner map: Keys are symbols (SymbolId), and values are the next
      * state IDs (unsigned int).
      */
     using transition_table =
-        std::map<unsigned int, std::map<std::string, unsigned int>>;
-    SLR1Parser(Grammar gr);
+        std::map<unsigned int, std::map<SymbolId, unsigned int>>;
+    SLR1Parser(const Grammar& gr);
+
+    /**
+     * @brief Constructs an SLR1Parser that reuses an existing analysis of the
+     * grammar, e.g. one already used by LL1Parser or the factory checks.
+     *
+     * @param analysis Analysis of the grammar to parse with.
+     */
+    explicit SLR1Parser(std::shared_ptr<const GrammarAnalysis> analysis);
 
     /**
      * @brief Retrieves all LR(0) items in the grammar.
@@ -127,12 +142,30 @@ class SLR1Parser {
      * @param visited A set of non-terminals that have already been processed.
      */
     void ClosureUtil(std::unordered_set<Lr0Item>& items, size_t size,
-                     std::unordered_set<std::string>& visited);
+                     std::unordered_set<SymbolId>& visited);
 
+    /**
+     * @brief Computes the GOTO (delta) of a set of LR(0) items.
+     *
+     * Advances the dot over `str` in every item that has it next to the dot
+     * and returns the closure of the result.
+     *
+     * @param items The set of LR(0) items.
+     * @param str The symbol to move over.
+     * @return The closure of the advanced items, empty if no item can move.
+     */
+    std::unordered_set<Lr0Item> Delta(const std::unordered_set<Lr0Item>& items,
+                                      SymbolId                           str);
 
-                     std::unordered_set<Lr0Item>
-                     Delta(const std::unordered_set<Lr0Item>& items,
-                                       const std::string&                 str);
+    /**
+     * @brief Name-based counterpart of Delta.
+     *
+     * @param items The set of LR(0) items.
+     * @param str Name of the symbol to move over.
+     * @return The closure of the advanced items, empty if `str` is unknown.
+     */
+    std::unordered_set<Lr0Item> Delta(const std::unordered_set<Lr0Item>& items,
+                                      const std::string&                 str);
 
     /**
      * @brief Resolves LR conflicts in a given state.
@@ -166,25 +199,24 @@ class SLR1Parser {
      * - If the entire rule could derive epsilon (i.e., each symbol in the rule
      * can derive epsilon), then epsilon is added to the FIRST set.
      *
-     * @param rule A span of strings representing the production rule for which
-     * to compute the FIRST set. Each string in the span is a symbol (either
+     * @param rule A span of symbol ids representing the production rule for
+     * which to compute the FIRST set. Each id in the span is a symbol (either
      * terminal or non-terminal).
-     * @param result A reference to an unordered set of strings where the
+     * @param result A reference to an unordered set of ids where the
      * computed FIRST set will be stored. The set will contain all terminal
      * symbols that can start derivations of the rule, and possibly epsilon if
      * the rule can derive an empty string.
      */
-    void First(std::span<const std::string>     rule,
-               std::unordered_set<std::string>& result);
+    void First(std::span<const SymbolId>     rule,
+               std::unordered_set<SymbolId>& result);
     /**
      * @brief Computes the FIRST sets for all non-terminal symbols in the
      * grammar.
      *
      * This function calculates the FIRST set for each non-terminal symbol in
-     * the grammar by iteratively applying a least fixed-point algorithm. This
-     * approach ensures that the FIRST sets are fully populated by repeatedly
-     * expanding and updating the sets until no further changes occur (i.e., a
-     * fixed-point is reached).
+     * the grammar, solving the dependencies between non-terminals component
+     * by component (FirstFollow::ComputeFirstSets). The sets are cached in
+     * the shared analysis, so they are only computed once per grammar.
      */
     void ComputeFirstSets();
 
@@ -203,40 +235,17 @@ class SLR1Parser {
      * 2. For each production rule of the form A → αBβ:
      *    - Add FIRST(β) (excluding ε) to FOLLOW(B).
      *    - If ε ∈ FIRST(β), add FOLLOW(A) to FOLLOW(B).
-     * 3. Repeat step 2 until no changes occur in any FOLLOW set.
-     *
-     * The computed FOLLOW sets are cached in the `follow_sets_` member variable
-     * for later use by the parser.
+     * 3. Propagate FOLLOW(A) to FOLLOW(B) along the relations of step 2
+     *    once, component by component (FirstFollow::ComputeFollowSets).
      *
-     * @note This function assumes that the FIRST sets for all symbols have
-     * already been computed and are available in the `first_sets_` member
-     * variable.
+     * The computed FOLLOW sets are cached in the shared analysis for later
+     * use by the parser. FIRST sets are computed first if needed.
      *
      * @see First
-     * @see follow_sets_
+     * @see analysis_
      */
     void ComputeFollowSets();
 
-    /**
-     * @brief Updates the FOLLOW set for a non-terminal based on a production.
-     *
-     * This method updates the FOLLOW set of a given non-terminal symbol based
-     * on its position within a production. It considers:
-     * - The FIRST set of the remaining symbols after the current non-terminal.
-     * - The FOLLOW set of the left-hand side non-terminal, if the remaining
-     * symbols can derive ε.
-     *
-     * @param symbol The non-terminal symbol whose FOLLOW set is being updated.
-     * @param lhs The left-hand side non-terminal of the current production.
-     * @param rhs The production (right-hand side) containing the symbol.
-     * @param i The position of the symbol within the production.
-     *
-     * @return true if the FOLLOW set was modified (new elements were added),
-     * false otherwise.
-     */
-    bool UpdateFollow(const std::string& symbol, const std::string& lhs,
-                      const production& rhs, size_t i);
-
     /**
      * @brief Computes the FOLLOW set for a given non-terminal symbol in the
      * grammar.
@@ -248,17 +257,17 @@ class SLR1Parser {
      * determine possible continuations after a non-terminal.
      *
      * @param arg Non-terminal symbol for which to compute the FOLLOW set.
-     * @return An unordered set of strings containing symbols that form the
+     * @return An unordered set of ids containing symbols that form the
      * FOLLOW set for `arg`.
      */
-    std::unordered_set<std::string> Follow(const std::string& arg);
+    std::unordered_set<SymbolId> Follow(SymbolId arg);
 
     /**
      * @brief Creates the initial state of the parser's state machine.
      *
      * This function initializes the starting state of the parser by computing
      * the closure of the initial set of LR(0) items derived from the grammar's
-     * start symbol. The initial state is added to the `states_` set, and its
+     * start symbol. The initial state is interned as state 0, and its
      * transitions are prepared for further processing in the parser
      * construction.
      *
@@ -267,6 +276,18 @@ class SLR1Parser {
      */
     void MakeInitialState();
 
+    /**
+     * @brief Returns the id of the state with the given kernel, creating the
+     * state if it does not exist yet.
+     *
+     * The closure of the kernel is only computed for new states; existing
+     * states are found through `state_ids_` without touching their items.
+     *
+     * @param k Kernel of the state. It does not need to be sorted.
+     * @return The id of the state and whether it was created by this call.
+     */
+    std::pair<unsigned int, bool> InternState(kernel k);
+
     /**
      * @brief Constructs the SLR(1) parsing tables (action and transition
      * tables).
@@ -286,16 +307,9 @@ class SLR1Parser {
      */
     bool MakeParser();
 
-    /// @brief The grammar being processed by the parser.
-    Grammar gr_;
-
-    /// @brief Cached FIRST sets for all symbols in the grammar.
-    std::unordered_map<std::string, std::unordered_set<std::string>>
-        first_sets_;
-
-    /// @brief Cached FOLLOW sets for all non-terminal symbols in the grammar.
-    std::unordered_map<std::string, std::unordered_set<std::string>>
-        follow_sets_;
+    /// @brief Compact form, symbol table, nullable symbols, FIRST and FOLLOW
+    /// sets of the grammar, possibly shared with other parsers.
+    std::shared_ptr<const GrammarAnalysis> analysis_;
 
     /// @brief The action table used by the parser to determine shift/reduce
     /// actions.
@@ -305,6 +319,9 @@ class SLR1Parser {
     /// transitions.
     transition_table transitions_;
 
-    /// @brief The set of states in the parser's state machine.
-    std::unordered_set<state> states_;
+    /// @brief The states of the parser's state machine, indexed by id.
+    std::vector<state> states_;
+
+    /// @brief Maps the sorted kernel of every state to its id.
+    std::unordered_map<kernel, unsigned int, kernel_hash> state_ids_;
 };
@@ -1,10 +1,53 @@
 #pragma once
 #include "lr0_item.hpp"
-#include <algorithm>
 #include <cstddef>
+#include <cstdint>
 #include <functional>
-#include <numeric>
 #include <unordered_set>
+#include <vector>
+
+/**
+ * @brief Order-independent hash of a collection of LR(0) items.
+ *
+ * Every item hash goes through a 64-bit finalizer before being combined with
+ * a sum and an xor, so the result does not depend on the iteration order but,
+ * unlike a plain xor, sets that share most of their items still spread well.
+ *
+ * @param items Range of `Lr0Item`.
+ * @return The combined hash value.
+ */
+template <typename Items> std::size_t HashItems(const Items& items) {
+    std::uint64_t sum = 0;
+    std::uint64_t x   = 0;
+    for (const Lr0Item& item : items) {
+        std::uint64_t h = std::hash<Lr0Item>()(item);
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ULL;
+        h ^= h >> 33;
+        sum += h;
+        x ^= h;
+    }
+    return static_cast<std::size_t>(sum ^ (x * 0x9e3779b97f4a7c15ULL) ^
+                                    items.size());
+}
+
+/**
+ * @brief Kernel of an LR(0) state: the items it is built from before the
+ * closure, sorted.
+ *
+ * Two states are equal if and only if their kernels are equal, so kernels are
+ * used to intern states without computing their closure.
+ */
+using kernel = std::vector<Lr0Item>;
+
+/**
+ * @brief Hash functor for kernels, used by the state registry.
+ */
+struct kernel_hash {
+    std::size_t operator()(const kernel& k) const { return HashItems(k); }
+};
 
 /**
  * @brief Represents a state in the LR(0) state machine.
@@ -43,20 +86,11 @@ namespace std {
 /**
  * @brief Computes the hash value for a `state` object.
  *
- * The hash value is computed by accumulating the hash values of all LR(0)
- * items in the state using the XOR operation.
- *
  * @param st The state for which to compute the hash value.
  * @return The computed hash value.
+ * @see HashItems
  */
 template <> struct hash<state> {
-    size_t operator()(const state& st) const {
-        size_t seed =
-            std::accumulate(st.items_.begin(), st.items_.end(), 0,
-                            [](size_t acc, const Lr0Item& item) {
-                                return acc ^ (std::hash<Lr0Item>()(item));
-                            });
-        return seed;
-    }
+    size_t operator()(const state& st) const { return HashItems(st.items_); }
 };
 } // namespace std
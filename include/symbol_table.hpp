@@ -1,4 +1,5 @@
 #pragma once
+#include <cstdint>
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
@@ -20,6 +21,14 @@
  */
 enum symbol_type { NO_TERMINAL, TERMINAL };
 
+/**
+ * @brief Dense identifier of an interned grammar symbol.
+ *
+ * Every symbol known to a SymbolTable gets a SymbolId in insertion order, so
+ * ids can index plain vectors. Names are only needed at the I/O edges.
+ */
+using SymbolId = std::uint32_t;
+
 struct SymbolTable {
     /// @brief End-of-line symbol used in parsing, initialized as "$".
     std::string EOL_{"$"};
@@ -28,10 +37,38 @@ struct SymbolTable {
     /// "EPSILON".
     std::string EPSILON_{"EPSILON"};
 
-    /// @brief Main symbol table, mapping identifiers to a pair of symbol type
-    /// and its regex.
-    std::unordered_map<std::string, symbol_type> st_{{EOL_, TERMINAL},
-                                                     {EPSILON_, TERMINAL}};
+    /// @brief SymbolId of EOL_, always the first interned symbol.
+    static constexpr SymbolId EOL_ID_ = 0;
+
+    /// @brief SymbolId of EPSILON_, always the second interned symbol.
+    static constexpr SymbolId EPSILON_ID_ = 1;
+
+    /// @brief Maps every interned name to its SymbolId.
+    std::unordered_map<std::string, SymbolId> ids_{{EOL_, EOL_ID_},
+                                                   {EPSILON_, EPSILON_ID_}};
+
+    /// @brief Interned names, indexed by SymbolId.
+    std::vector<std::string> names_{EOL_, EPSILON_};
+
+    /// @brief Kind of every interned symbol, indexed by SymbolId.
+    std::vector<symbol_type> kinds_{TERMINAL, TERMINAL};
+
+    /**
+     * @brief Position of every symbol inside the range of its kind.
+     *
+     * Terminals are numbered 0..T-1 and non-terminals 0..N-1, so per-kind
+     * tables (FIRST sets, bitsets over terminals...) can be indexed directly.
+     * The kind of a symbol is fixed when it is interned, and the ranges are
+     * only appended to, so a position never changes.
+     */
+    std::vector<std::uint32_t> kind_index_{0, 1};
+
+    /// @brief Contiguous range of terminal ids, indexed by terminal position.
+    std::vector<SymbolId> terminal_ids_{EOL_ID_, EPSILON_ID_};
+
+    /// @brief Contiguous range of non-terminal ids, indexed by non-terminal
+    /// position.
+    std::vector<SymbolId> non_terminal_ids_;
 
     /**
      * @brief The set of terminal symbols in the grammar, including the
@@ -63,12 +100,54 @@ struct SymbolTable {
     std::unordered_set<std::string> non_terminals_;
 
     /**
-     * @brief Adds a non-terminal symbol to the symbol table.
+     * @brief Adds a symbol to the symbol table.
      *
      * @param identifier Name of the  symbol.
      * @param isTerminal True if the identifier is a terminal symbol
+     * @return The SymbolId of the symbol.
+     * @throws std::invalid_argument if the symbol is already interned with
+     * the other kind.
+     */
+    SymbolId PutSymbol(const std::string& identifier, bool isTerminal);
+
+    /**
+     * @brief Interns a symbol without declaring it.
+     *
+     * Unknown names are registered as non-terminals, which is how the rest of
+     * the table treats undeclared symbols. The name sets (`terminals_`,
+     * `non_terminals_`...) are left untouched.
+     *
+     * @param identifier Name of the symbol.
+     * @return The SymbolId of the symbol.
+     */
+    SymbolId Intern(const std::string& identifier);
+
+    /**
+     * @brief Interns a symbol of a given kind without declaring it.
+     *
+     * @param identifier Name of the symbol.
+     * @param kind Kind of the symbol if it is new; an interned symbol keeps
+     * its kind.
+     * @return The SymbolId of the symbol.
      */
-    void PutSymbol(const std::string& identifier, bool isTerminal);
+    SymbolId Intern(const std::string& identifier, symbol_type kind);
+
+    /**
+     * @brief Looks up the SymbolId of an interned symbol.
+     *
+     * @param s Symbol identifier to search.
+     * @return The SymbolId of the symbol.
+     * @throws std::out_of_range if the symbol is not interned.
+     */
+    SymbolId Id(const std::string& s) const;
+
+    /**
+     * @brief Returns the name of an interned symbol.
+     *
+     * @param id SymbolId of the symbol.
+     * @return The name of the symbol.
+     */
+    const std::string& Name(SymbolId id) const { return names_[id]; }
 
     /**
      * @brief Checks if a symbol exists in the symbol table.
@@ -76,7 +155,7 @@ struct SymbolTable {
      * @param s Symbol identifier to search.
      * @return true if the symbol is present, otherwise false.
      */
-    bool In(const std::string& s);
+    bool In(const std::string& s) const;
 
     /**
      * @brief Checks if a symbol is a terminal.
@@ -84,7 +163,15 @@ struct SymbolTable {
      * @param s Symbol identifier to check.
      * @return true if the symbol is terminal, otherwise false.
      */
-    bool IsTerminal(const std::string& s);
+    bool IsTerminal(const std::string& s) const;
+
+    /**
+     * @brief Checks if an interned symbol is a terminal.
+     *
+     * @param id SymbolId to check.
+     * @return true if the symbol is terminal, otherwise false.
+     */
+    bool IsTerminal(SymbolId id) const { return kinds_[id] == TERMINAL; }
 
     /**
      * @brief Checks if a symbol is a terminal excluding EOL.
@@ -92,5 +179,20 @@ struct SymbolTable {
      * @param s Symbol identifier to check.
      * @return true if the symbol is terminal, otherwise false.
      */
-    bool IsTerminalWthoEol(const std::string& s);
+    bool IsTerminalWthoEol(const std::string& s) const;
+
+    /**
+     * @brief Checks if an interned symbol is a terminal excluding EOL.
+     *
+     * @param id SymbolId to check.
+     * @return true if the symbol is terminal, otherwise false.
+     */
+    bool IsTerminalWthoEol(SymbolId id) const {
+        return id != EPSILON_ID_ && IsTerminal(id);
+    }
+
+    /**
+     * @brief Number of interned symbols.
+     */
+    std::size_t Size() const { return names_.size(); }
 };
@@ -0,0 +1,219 @@
+#pragma once
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Set of terminals of a grammar stored as a single 64-bit word.
+ *
+ * Terminals are identified by their position in the terminal range of the
+ * symbol table (`SymbolTable::kind_index_`), so EOL is always bit 0 and
+ * EPSILON bit 1. Union, difference and change detection are one word-wide
+ * operation each. Only valid for grammars with at most 64 terminals; see
+ * DynamicTerminalSet for bigger alphabets.
+ */
+class SmallTerminalSet {
+  public:
+    /// @brief Maximum number of terminals the set can hold.
+    static constexpr std::size_t CAPACITY_ = 64;
+
+    SmallTerminalSet() = default;
+
+    /**
+     * @brief Creates an empty set for a grammar with `terminals` terminals.
+     *
+     * The size is only needed by DynamicTerminalSet; it is accepted here so
+     * both sets can be built the same way.
+     */
+    explicit SmallTerminalSet(std::size_t /*terminals*/) {}
+
+    /**
+     * @brief Adds a terminal to the set.
+     *
+     * @param t Position of the terminal.
+     * @return true if the terminal was not in the set.
+     */
+    bool Insert(std::uint32_t t) {
+        const std::uint64_t old = bits_;
+        bits_ |= std::uint64_t{1} << t;
+        return old != bits_;
+    }
+
+    /**
+     * @brief Removes a terminal from the set.
+     *
+     * @param t Position of the terminal.
+     */
+    void Erase(std::uint32_t t) { bits_ &= ~(std::uint64_t{1} << t); }
+
+    /**
+     * @brief Checks if a terminal is in the set.
+     *
+     * @param t Position of the terminal.
+     */
+    bool Contains(std::uint32_t t) const { return (bits_ >> t) & 1U; }
+
+    /**
+     * @brief Adds every terminal of `other`, except `skip`, to the set.
+     *
+     * @param other Set to merge.
+     * @param skip Position of a terminal that must not be merged, typically
+     * EPSILON when computing FIRST(β) \ {ε}.
+     * @return true if the set changed.
+     */
+    bool UnionWith(const SmallTerminalSet& other, std::uint32_t skip) {
+        const std::uint64_t old = bits_;
+        bits_ |= other.bits_ & ~(std::uint64_t{1} << skip);
+        return old != bits_;
+    }
+
+    /**
+     * @brief Adds every terminal of `other` to the set.
+     *
+     * @return true if the set changed.
+     */
+    bool UnionWith(const SmallTerminalSet& other) {
+        const std::uint64_t old = bits_;
+        bits_ |= other.bits_;
+        return old != bits_;
+    }
+
+    /**
+     * @brief Checks if the set shares at least one terminal with `other`.
+     */
+    bool Intersects(const SmallTerminalSet& other) const {
+        return (bits_ & other.bits_) != 0;
+    }
+
+    /// @brief Removes every terminal from the set.
+    void Clear() { bits_ = 0; }
+
+    /// @brief Checks if the set is empty.
+    bool Empty() const { return bits_ == 0; }
+
+    /// @brief Number of terminals in the set.
+    std::size_t Count() const { return std::popcount(bits_); }
+
+    /**
+     * @brief Calls `f` with the position of every terminal in the set, in
+     * increasing order.
+     */
+    template <typename F> void ForEach(F&& f) const {
+        for (std::uint64_t w = bits_; w != 0; w &= w - 1) {
+            f(static_cast<std::uint32_t>(std::countr_zero(w)));
+        }
+    }
+
+    bool operator==(const SmallTerminalSet& other) const = default;
+
+  private:
+    std::uint64_t bits_ = 0;
+};
+
+/**
+ * @brief Set of terminals of a grammar stored as a dynamic bitset.
+ *
+ * Same interface and bit layout as SmallTerminalSet, for grammars with more
+ * than 64 terminals. All the sets combined together must have been created
+ * for the same number of terminals.
+ */
+class DynamicTerminalSet {
+  public:
+    DynamicTerminalSet() = default;
+
+    /**
+     * @brief Creates an empty set for a grammar with `terminals` terminals.
+     */
+    explicit DynamicTerminalSet(std::size_t terminals)
+        : words_((terminals + 63) / 64, 0) {}
+
+    /// @copydoc SmallTerminalSet::Insert
+    bool Insert(std::uint32_t t) {
+        std::uint64_t&      word = words_[t / 64];
+        const std::uint64_t old  = word;
+        word |= std::uint64_t{1} << (t % 64);
+        return old != word;
+    }
+
+    /// @copydoc SmallTerminalSet::Erase
+    void Erase(std::uint32_t t) {
+        words_[t / 64] &= ~(std::uint64_t{1} << (t % 64));
+    }
+
+    /// @copydoc SmallTerminalSet::Contains
+    bool Contains(std::uint32_t t) const {
+        return (words_[t / 64] >> (t % 64)) & 1U;
+    }
+
+    /// @copydoc SmallTerminalSet::UnionWith(const SmallTerminalSet&,
+    /// std::uint32_t)
+    bool UnionWith(const DynamicTerminalSet& other, std::uint32_t skip) {
+        std::uint64_t changed = 0;
+        for (std::size_t i = 0; i < words_.size(); ++i) {
+            std::uint64_t add = other.words_[i];
+            if (i == skip / 64) {
+                add &= ~(std::uint64_t{1} << (skip % 64));
+            }
+            changed |= add & ~words_[i];
+            words_[i] |= add;
+        }
+        return changed != 0;
+    }
+
+    /// @copydoc SmallTerminalSet::UnionWith(const SmallTerminalSet&)
+    bool UnionWith(const DynamicTerminalSet& other) {
+        std::uint64_t changed = 0;
+        for (std::size_t i = 0; i < words_.size(); ++i) {
+            changed |= other.words_[i] & ~words_[i];
+            words_[i] |= other.words_[i];
+        }
+        return changed != 0;
+    }
+
+    /// @copydoc SmallTerminalSet::Intersects
+    bool Intersects(const DynamicTerminalSet& other) const {
+        for (std::size_t i = 0; i < words_.size(); ++i) {
+            if ((words_[i] & other.words_[i]) != 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /// @copydoc SmallTerminalSet::Clear
+    void Clear() { words_.assign(words_.size(), 0); }
+
+    /// @copydoc SmallTerminalSet::Empty
+    bool Empty() const {
+        for (std::uint64_t w : words_) {
+            if (w != 0) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /// @copydoc SmallTerminalSet::Count
+    std::size_t Count() const {
+        std::size_t count = 0;
+        for (std::uint64_t w : words_) {
+            count += std::popcount(w);
+        }
+        return count;
+    }
+
+    /// @copydoc SmallTerminalSet::ForEach
+    template <typename F> void ForEach(F&& f) const {
+        for (std::size_t i = 0; i < words_.size(); ++i) {
+            for (std::uint64_t w = words_[i]; w != 0; w &= w - 1) {
+                f(static_cast<std::uint32_t>(i * 64 + std::countr_zero(w)));
+            }
+        }
+    }
+
+    bool operator==(const DynamicTerminalSet& other) const = default;
+
+  private:
+    std::vector<std::uint64_t> words_;
+};
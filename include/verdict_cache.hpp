@@ -0,0 +1,220 @@
+#pragma once
+#include "grammar.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief 128-bit fingerprint of the canonical form of a grammar, see
+ * Fingerprint.
+ */
+struct grammar_fingerprint {
+    std::uint64_t hi_{0};
+    std::uint64_t lo_{0};
+
+    bool operator==(const grammar_fingerprint&) const = default;
+};
+
+/**
+ * @brief Hash of a fingerprint for unordered containers: the fingerprint is
+ * already uniform, so its low half is enough.
+ */
+struct grammar_fingerprint_hash {
+    std::size_t operator()(const grammar_fingerprint& fp) const {
+        return static_cast<std::size_t>(fp.lo_);
+    }
+};
+
+/**
+ * @brief Verdicts of the checks GenLL1Grammar and GenSLR1Grammar run on a
+ * grammar. The sanity checks are always known; the LL(1) and SLR(1)
+ * verdicts are only computed when a request needs them.
+ */
+struct grammar_verdicts {
+    /// @brief Value of `ll1_` and `slr1_` that are not computed yet.
+    static constexpr std::uint8_t UNKNOWN_ = 0xFF;
+
+    /// @brief GrammarFactory::IsInfinite.
+    bool infinite_{false};
+
+    /// @brief GrammarFactory::HasUnreachableSymbols.
+    bool unreachable_{false};
+
+    /// @brief GrammarFactory::HasDirectLeftRecursion.
+    bool left_recursive_{false};
+
+    /// @brief GrammarFactory::ll1_fix of GrammarFactory::MakeLL1, or
+    /// UNKNOWN_.
+    std::uint8_t ll1_{UNKNOWN_};
+
+    /// @brief 1 if GrammarFactory::IsAcceptedSLR1, 0 if not, or UNKNOWN_.
+    std::uint8_t slr1_{UNKNOWN_};
+};
+
+/**
+ * @brief A grammar over dense symbol numbers, as CanonicalLabeling sees it.
+ */
+struct canonical_input {
+    /// @brief Antecedent of every production.
+    std::vector<std::uint32_t> lhs_;
+
+    /// @brief Right-hand side of every production.
+    std::vector<std::vector<std::uint32_t>> rhs_;
+
+    /// @brief canonical_role of every symbol: its first color.
+    std::vector<std::uint32_t> kinds_;
+};
+
+/// @brief First colors of a canonical_input: the roles that a renaming
+/// keeps.
+enum canonical_role : std::uint32_t {
+    EOL_ROLE,
+    EPSILON_ROLE,
+    AXIOM_ROLE,
+    TERMINAL_ROLE,
+    NON_TERMINAL_ROLE
+};
+
+/**
+ * @brief Canonical form of a grammar, and the renaming that gives it.
+ */
+struct canonical_labeling {
+    /// @brief Text of the renamed grammar, see CanonicalLabeling.
+    std::string form_;
+
+    /// @brief Color of every symbol in `form_`: all different, and in the
+    /// order of the first colors.
+    std::vector<std::uint32_t> colors_;
+};
+
+/**
+ * @brief Renames the symbols of a grammar to a canonical form: a text that
+ * is the same for two grammars if and only if they are equal up to a
+ * renaming of their terminals and non-terminals. Symbols keep their roles.
+ *
+ * Symbols are colored by their role, then the colors are refined with the
+ * places every symbol occurs in until they are stable (color refinement).
+ * Symbols left with the same color are told apart by trying each of them
+ * first, and the smallest text wins. At most MAX_CANONICAL_LEAVES orders
+ * are tried: past that, equal grammars may get different forms, but
+ * different grammars never share one.
+ *
+ * @param in The grammar.
+ * @param terminals_only Only rename terminals: every other symbol is told
+ * apart by its number from the start, so the form is the same for two
+ * grammars that number them alike and only differ by their terminals.
+ */
+canonical_labeling CanonicalLabeling(const canonical_input& in,
+                                     bool                   terminals_only);
+
+/**
+ * @brief Returns the canonical form of a grammar, see CanonicalLabeling.
+ * The axiom, EOL and EPSILON keep their roles.
+ *
+ * @param gr Grammar, with every symbol of `g_` interned in `st_`.
+ */
+std::string CanonicalForm(const Grammar& gr);
+
+/// @brief Orders of tied symbols CanonicalLabeling tries at most.
+inline constexpr std::size_t MAX_CANONICAL_LEAVES = 64;
+
+/**
+ * @brief Returns the 128-bit FNV-1a hash of the canonical form of a
+ * grammar.
+ */
+grammar_fingerprint Fingerprint(const Grammar& gr);
+
+/**
+ * @brief Bounded cache of grammar verdicts, keyed by fingerprint, safe to
+ * share between threads.
+ *
+ * Entries are spread over SHARDS_ shards, each one behind its own mutex and
+ * evicting its least recently used entry when full. The cache can be saved
+ * to a file and loaded back, so verdicts survive between runs.
+ */
+class VerdictCache {
+  public:
+    /// @brief Number of independently locked parts of the cache.
+    static constexpr std::size_t SHARDS_ = 16;
+
+    /// @brief Capacity of the cache `gen --cache` uses.
+    static constexpr std::size_t DEFAULT_CAPACITY_ = std::size_t{1} << 16;
+
+    /// @brief Format version of Save and Load.
+    static constexpr std::uint32_t VERSION_ = 1;
+
+    /**
+     * @brief Creates an empty cache.
+     * @param capacity Maximum number of entries, at least SHARDS_.
+     */
+    explicit VerdictCache(std::size_t capacity);
+
+    /**
+     * @brief Looks up the verdicts of a grammar, and marks them as recently
+     * used.
+     * @return The verdicts, or nothing if the grammar is not cached.
+     */
+    std::optional<grammar_verdicts> Find(const grammar_fingerprint& fp);
+
+    /**
+     * @brief Adds or replaces the verdicts of a grammar, evicting the least
+     * recently used entry of its shard if it is full.
+     */
+    void Store(const grammar_fingerprint& fp, const grammar_verdicts& v);
+
+    /// @brief Number of cached grammars.
+    std::size_t Size() const;
+
+    /// @brief Maximum number of cached grammars.
+    std::size_t Capacity() const { return shard_capacity_ * SHARDS_; }
+
+    /// @brief Lookups that found the grammar.
+    std::uint64_t Hits() const { return hits_; }
+
+    /// @brief Lookups that did not find the grammar.
+    std::uint64_t Misses() const { return misses_; }
+
+    /**
+     * @brief Writes every entry to a file.
+     * @throws std::runtime_error if the file cannot be written.
+     */
+    void Save(const std::string& path) const;
+
+    /**
+     * @brief Adds the entries of a file written by Save.
+     * @return false if the file does not exist.
+     * @throws std::runtime_error if the file is not a cache of this version.
+     */
+    bool Load(const std::string& path);
+
+  private:
+    /**
+     * @brief One part of the cache: the entries in a recency list, most
+     * recent first, and an index into the list.
+     */
+    struct shard {
+        using entry = std::pair<grammar_fingerprint, grammar_verdicts>;
+
+        std::mutex       mutex_;
+        std::list<entry> recency_;
+        std::unordered_map<grammar_fingerprint, std::list<entry>::iterator,
+                           grammar_fingerprint_hash>
+            index_;
+    };
+
+    shard& ShardOf(const grammar_fingerprint& fp) {
+        return shards_[fp.hi_ % SHARDS_];
+    }
+
+    std::size_t                shard_capacity_;
+    std::unique_ptr<shard[]>   shards_;
+    std::atomic<std::uint64_t> hits_{0};
+    std::atomic<std::uint64_t> misses_{0};
+};
@@ -0,0 +1,499 @@
+#include "compact_grammar.hpp"
+#include "first_follow.hpp"
+#include "grammar.hpp"
+#include "grammar_analysis.hpp"
+#include "grammar_corpus.hpp"
+#include "grammar_factory.hpp"
+#include "grammar_pool.hpp"
+#include "ll1_parser.hpp"
+#include "philox_engine.hpp"
+#include "slr1_parser.hpp"
+#include "verdict_cache.hpp"
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <string>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+
+namespace {
+
+using bench_clock = std::chrono::steady_clock;
+
+/// @brief Number of calls to the global `operator new` so far.
+std::size_t allocations = 0;
+
+} // namespace
+
+// The replacements below pair malloc with free; GCC warns about the inlined
+// delete expressions that reach them.
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+
+void* operator new(std::size_t size) {
+    ++allocations;
+    if (void* ptr = std::malloc(size == 0 ? 1 : size)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+
+void operator delete(void* ptr, std::size_t) noexcept { std::free(ptr); }
+
+namespace {
+
+/**
+ * @brief Builds a synthetic grammar whose LR(0) automaton grows linearly with
+ * `n`.
+ *
+ * A -> t_i X_i A | EPSILON;  X_i -> u_i X_i | v_i   (0 <= i < n)
+ */
+Grammar Synthetic(std::size_t n) {
+    std::unordered_map<std::string, std::vector<production>> rules;
+    for (std::size_t i = 0; i < n; ++i) {
+        const std::string idx = std::to_string(i);
+        const std::string x   = "X" + idx;
+        rules["A"].push_back({"t" + idx, x, "A"});
+        rules[x] = {{"u" + idx, x}, {"v" + idx}};
+    }
+    rules["A"].push_back({"EPSILON"});
+    return Grammar(rules);
+}
+
+/**
+ * @brief Builds a chain grammar whose FIRST sets need `n` passes of the global
+ * fixpoint: non-terminals are visited top-down, but information flows
+ * bottom-up.
+ *
+ * S -> A_0 $;  A_i -> A_{i+1} | t_i  (0 <= i < n - 1);  A_{n-1} -> x
+ */
+Grammar Chain(std::size_t n) {
+    Grammar gr;
+    gr.axiom_ = "S";
+    gr.st_.PutSymbol("S", false);
+    for (std::size_t i = 0; i < n; ++i) {
+        gr.st_.PutSymbol("A" + std::to_string(i), false);
+        gr.st_.PutSymbol("t" + std::to_string(i), true);
+    }
+    gr.st_.PutSymbol("x", true);
+    gr.AddProduction("S", {"A0", gr.st_.EOL_});
+    for (std::size_t i = 0; i + 1 < n; ++i) {
+        const std::string a = "A" + std::to_string(i);
+        gr.AddProduction(a, {"A" + std::to_string(i + 1)});
+        gr.AddProduction(a, {"t" + std::to_string(i)});
+    }
+    gr.AddProduction("A" + std::to_string(n - 1), {"x"});
+    return gr;
+}
+
+/**
+ * @brief Builds a chain grammar whose FOLLOW sets need `n` passes of the
+ * global fixpoint: productions are visited from A_0 up, but FOLLOW flows from
+ * A_{n-1} down.
+ *
+ * S -> A_{n-1} $;  A_i -> t_i A_{i-1} | t_i  (0 < i < n);  A_0 -> x
+ */
+Grammar ReverseChain(std::size_t n) {
+    Grammar gr;
+    gr.axiom_ = "S";
+    gr.st_.PutSymbol("S", false);
+    for (std::size_t i = 0; i < n; ++i) {
+        gr.st_.PutSymbol("A" + std::to_string(i), false);
+        gr.st_.PutSymbol("t" + std::to_string(i), true);
+    }
+    gr.st_.PutSymbol("x", true);
+    gr.AddProduction("S", {"A" + std::to_string(n - 1), gr.st_.EOL_});
+    gr.AddProduction("A0", {"x"});
+    for (std::size_t i = 1; i < n; ++i) {
+        const std::string a = "A" + std::to_string(i);
+        const std::string t = "t" + std::to_string(i);
+        gr.AddProduction(a, {t, "A" + std::to_string(i - 1)});
+        gr.AddProduction(a, {t});
+    }
+    return gr;
+}
+
+/**
+ * @brief Runs `body` `count` times and prints the mean time, the mean number
+ * of allocations and the mean of the counter returned by `body`.
+ */
+void Report(const std::string& name, std::size_t count,
+            const std::function<std::size_t(std::size_t)>& body,
+            const std::string&                             unit) {
+    std::size_t total       = 0;
+    const auto  allocs_from = allocations;
+    const auto  start       = bench_clock::now();
+    for (std::size_t i = 0; i < count; ++i) {
+        total += body(i);
+    }
+    const auto elapsed = std::chrono::duration<double, std::micro>(
+                             bench_clock::now() - start)
+                             .count();
+    const auto allocs = allocations - allocs_from;
+    std::cout << std::left << std::setw(28) << name << std::right
+              << std::setw(8) << count << " grammars" << std::setw(12)
+              << std::fixed << std::setprecision(1)
+              << elapsed / static_cast<double>(count) << " us/gr"
+              << std::setw(10) << allocs / count << " allocs/gr"
+              << std::setw(10) << total / count << " " << unit << "/gr\n";
+}
+
+/**
+ * @brief Runs `body` on every grammar, see the overload above.
+ */
+void Report(const std::string& name, std::vector<Grammar>& grammars,
+            const std::function<std::size_t(Grammar&)>& body,
+            const std::string&                          unit) {
+    Report(
+        name, grammars.size(),
+        [&](std::size_t i) { return body(grammars[i]); }, unit);
+}
+
+std::size_t BuildFirstFollow(Grammar& gr) {
+    LL1Parser ll1(gr);
+    return ll1.analysis_->cg_.ProductionCount();
+}
+
+/**
+ * @brief Factory checks plus both parsers, each building its own analysis.
+ */
+std::size_t CheckBothSeparately(Grammar& gr) {
+    GrammarFactory factory;
+    LL1Parser      ll1(gr);
+    SLR1Parser     slr1(gr);
+    factory.IsInfinite(gr);
+    factory.HasUnreachableSymbols(gr);
+    ll1.CreateLL1Table();
+    slr1.MakeParser();
+    return slr1.states_.size();
+}
+
+/**
+ * @brief Factory checks plus both parsers over one shared analysis.
+ */
+std::size_t CheckBothShared(Grammar& gr) {
+    GrammarFactory factory;
+    auto           analysis = std::make_shared<const GrammarAnalysis>(gr);
+    LL1Parser      ll1(analysis);
+    SLR1Parser     slr1(analysis);
+    factory.IsInfinite(*analysis);
+    factory.HasUnreachableSymbols(*analysis);
+    ll1.CreateLL1Table();
+    slr1.MakeParser();
+    return slr1.states_.size();
+}
+
+std::size_t FirstByComponents(Grammar& gr) {
+    const CompactGrammar cg(gr);
+    terminal_sets        sets = MakeTerminalSets(cg);
+    return std::visit(
+        [&](auto& ff) {
+            ff.ComputeFirstSets(cg);
+            return ff.first_stats_.evaluations_;
+        },
+        sets);
+}
+
+std::size_t FirstByFixpoint(Grammar& gr) {
+    const CompactGrammar cg(gr);
+    terminal_sets        sets = MakeTerminalSets(cg);
+    return std::visit(
+        [&](auto& ff) {
+            ff.ComputeFirstSetsFixpoint(cg);
+            return ff.first_stats_.evaluations_;
+        },
+        sets);
+}
+
+std::size_t BuildLL1Table(Grammar& gr) {
+    LL1Parser ll1(gr);
+    ll1.CreateLL1Table();
+    return ll1.ll1_t_.size();
+}
+
+std::size_t FollowByDigraph(Grammar& gr) {
+    const CompactGrammar cg(gr);
+    terminal_sets        sets = MakeTerminalSets(cg);
+    std::visit(
+        [&](auto& ff) {
+            ff.ComputeFirstSets(cg);
+            ff.ComputeFollowSets(cg);
+        },
+        sets);
+    return cg.ProductionCount();
+}
+
+std::size_t FollowByFixpoint(Grammar& gr) {
+    const CompactGrammar cg(gr);
+    terminal_sets        sets = MakeTerminalSets(cg);
+    std::visit(
+        [&](auto& ff) {
+            ff.ComputeFirstSets(cg);
+            ff.ComputeFollowSetsFixpoint(cg);
+        },
+        sets);
+    return cg.ProductionCount();
+}
+
+std::size_t BuildSLR1(Grammar& gr) {
+    SLR1Parser slr1(gr);
+    slr1.MakeParser();
+    return slr1.states_.size();
+}
+
+} // namespace
+
+int main() {
+    GrammarFactory factory;
+    factory.Init();
+    factory.Seed(42);
+
+    std::vector<Grammar> lv7;
+    for (int i = 0; i < 200; ++i) {
+        Grammar gr = factory.PickOne(7);
+        gr.TransformToAugmentedGrammar();
+        lv7.push_back(std::move(gr));
+    }
+    Report("FIRST/FOLLOW, Lv7", lv7, BuildFirstFollow, "prods");
+    Report("LL(1) table, Lv7", lv7, BuildLL1Table, "rows");
+    Report("SLR(1) automaton, Lv7", lv7, BuildSLR1, "states");
+    Report("All checks, separate, Lv7", lv7, CheckBothSeparately, "states");
+    Report("All checks, shared, Lv7", lv7, CheckBothShared, "states");
+
+    Report(
+        "Init", 5,
+        [](std::size_t) {
+            GrammarFactory fresh;
+            fresh.Init();
+            return fresh.catalog_->items.size();
+        },
+        "items");
+    Report(
+        "GenLL1Grammar, Lv2", 1000,
+        [&](std::size_t) { return factory.GenLL1Grammar(2).g_.size(); },
+        "rules");
+    Report(
+        "GenSLR1Grammar, Lv2", 1000,
+        [&](std::size_t) { return factory.GenSLR1Grammar(2).g_.size(); },
+        "rules");
+    Report(
+        "GenLL1Grammar, Lv3", 200,
+        [&](std::size_t) { return factory.GenLL1Grammar(3).g_.size(); },
+        "rules");
+    Report(
+        "GenSLR1Grammar, Lv3", 200,
+        [&](std::size_t) { return factory.GenSLR1Grammar(3).g_.size(); },
+        "rules");
+    Report(
+        "BuildIndex(3)", 1,
+        [&](std::size_t) {
+            factory.BuildIndex(3);
+            return factory.IndexOf(3)->grammars_.size();
+        },
+        "classes");
+    Report(
+        "GenLL1Grammar, Lv3, indexed", 200,
+        [&](std::size_t) { return factory.GenLL1Grammar(3).g_.size(); },
+        "rules");
+    Report(
+        "GenSLR1Grammar, Lv3, indexed", 200,
+        [&](std::size_t) { return factory.GenSLR1Grammar(3).g_.size(); },
+        "rules");
+    Report(
+        "PickOne, Lv7", 1000,
+        [&](std::size_t) { return factory.PickOne(7).g_.size(); }, "rules");
+    for (int level : {5, 7}) {
+        Report(
+            "SLR(1) rejects, Lv" + std::to_string(level), 20,
+            [&](std::size_t) {
+                std::size_t rejects = 0;
+                while (!factory.IsAcceptedSLR1(factory.PickOne(level))) {
+                    ++rejects;
+                }
+                return rejects;
+            },
+            "rejects");
+        Report(
+            "SLR(1) rejects, Lv" + std::to_string(level) + ", matrix", 20,
+            [&](std::size_t) {
+                std::size_t                 rejects = 0;
+                GrammarFactory::composition rules;
+                while (!factory.ComposeSLR1(level, rules) ||
+                       !factory.IsAcceptedSLR1(rules.ToGrammar())) {
+                    ++rejects;
+                }
+                return rejects;
+            },
+            "rejects");
+    }
+    Report(
+        "GenLL1Grammar, Lv7", 10,
+        [&](std::size_t) { return factory.GenLL1Grammar(7).g_.size(); },
+        "rules");
+    Report(
+        "GenLL1 by construction, Lv7", 100,
+        [&](std::size_t) {
+            return factory.GenLL1GrammarByConstruction(7).g_.size();
+        },
+        "rules");
+    Report(
+        "GenSLR1Grammar, Lv7", 10,
+        [&](std::size_t) { return factory.GenSLR1Grammar(7).g_.size(); },
+        "rules");
+    Report(
+        "Fingerprint, Lv7", 1000,
+        [&](std::size_t) { return Fingerprint(factory.PickOne(7)).lo_ & 1; },
+        "odd");
+    for (std::size_t threads : {1, 2, 4, 8, 16}) {
+        // The whole batch runs in the first call, timed over every grammar
+        Report(
+            "Batch SLR1 Lv5, " + std::to_string(threads) + " threads", 64,
+            [&](std::size_t i) {
+                std::size_t rules = 0;
+                if (i == 0) {
+                    factory.GenerateBatch(
+                        GrammarFactory::SLR1_GRAMMAR, 5, 64, threads,
+                        [&](std::uint64_t, const Grammar& gr) {
+                            rules += gr.g_.size();
+                            return true;
+                        });
+                }
+                return rules;
+            },
+            "rules");
+    }
+    // Without an index, Level 3 draws the same grammars again and again
+    GrammarFactory cached;
+    cached.Init();
+    cached.verdict_cache_ =
+        std::make_shared<VerdictCache>(VerdictCache::DEFAULT_CAPACITY_);
+    for (bool warm : {false, true}) {
+        for (int i = 0; warm && i < 5000; ++i) {
+            cached.GenLL1Grammar(3);
+        }
+        const std::uint64_t hits   = cached.verdict_cache_->Hits();
+        const std::uint64_t misses = cached.verdict_cache_->Misses();
+        Report(
+            std::string("GenLL1Grammar, Lv3, ") + (warm ? "warm" : "cold"),
+            200,
+            [&](std::size_t) { return cached.GenLL1Grammar(3).g_.size(); },
+            "rules");
+        std::cout << "  cache: " << cached.verdict_cache_->Hits() - hits
+                  << " hits, " << cached.verdict_cache_->Misses() - misses
+                  << " misses\n";
+    }
+
+    Report(
+        "GenLL1 + table, Lv6", 32,
+        [&](std::size_t) {
+            LL1Parser ll1(factory.GenLL1Grammar(6));
+            ll1.CreateLL1Table();
+            return ll1.ll1_t_.size();
+        },
+        "rows");
+    {
+        GrammarPool pool(factory.catalog_, 6,
+                         {{GrammarFactory::LL1_GRAMMAR, 6}},
+                         {.low_watermark_ = 8, .high_watermark_ = 32});
+        pool.WaitFull(std::chrono::seconds(60));
+        Report(
+            "Pool TryTake, LL1 Lv6", 32,
+            [&](std::size_t) {
+                const auto gr = pool.TryTake(GrammarFactory::LL1_GRAMMAR, 6);
+                return gr ? gr->ll1_->ll1_t_.size() : 0;
+            },
+            "rows");
+        const pool_stats stats = pool.Stats(GrammarFactory::LL1_GRAMMAR, 6);
+        std::cout << "  pool: " << stats.hits_ << " hits, " << stats.misses_
+                  << " misses, refill lag " << stats.max_lag_ns_ / 1000000
+                  << " ms max\n";
+    }
+
+    const std::string   corpus_path = "/tmp/grammar_bench_corpus.bin";
+    GrammarCorpusWriter writer;
+    writer.AddLevel(factory, 3, 0);
+    writer.AddLevel(factory, 5, 2000);
+    writer.Write(corpus_path);
+    Report(
+        "GrammarCorpus, open", 100,
+        [&](std::size_t) { return GrammarCorpus(corpus_path).Size(); },
+        "grammars");
+    const GrammarCorpus corpus(corpus_path);
+    PhiloxEngine        rng(42);
+    Report(
+        "Corpus SLR1 view, Lv3", 1000,
+        [&](std::size_t) {
+            return corpus.Sample(3, CORPUS_SLR1, rng)->ProductionCount();
+        },
+        "prods");
+    Report(
+        "Corpus SLR1 grammar, Lv3", 1000,
+        [&](std::size_t) {
+            return corpus.Sample(3, CORPUS_SLR1, rng)->ToGrammar().g_.size();
+        },
+        "rules");
+    Report(
+        "GenSLR1Grammar, Lv5", 100,
+        [&](std::size_t) { return factory.GenSLR1Grammar(5).g_.size(); },
+        "rules");
+    Report(
+        "Corpus SLR1 grammar, Lv5", 1000,
+        [&](std::size_t) {
+            return corpus.Sample(5, CORPUS_SLR1, rng)->ToGrammar().g_.size();
+        },
+        "rules");
+    std::remove(corpus_path.c_str());
+
+    Report("FIRST fixpoint, Lv7", lv7, FirstByFixpoint, "evals");
+    Report("FIRST components, Lv7", lv7, FirstByComponents, "evals");
+    Report("FOLLOW fixpoint, Lv7", lv7, FollowByFixpoint, "prods");
+    Report("FOLLOW digraph, Lv7", lv7, FollowByDigraph, "prods");
+
+    for (std::size_t n : {16, 64, 256}) {
+        std::vector<Grammar> chain;
+        for (int i = 0; i < 5; ++i) {
+            chain.push_back(Chain(n));
+        }
+        Report("FIRST fixpoint, chain=" + std::to_string(n), chain,
+               FirstByFixpoint, "evals");
+        Report("FIRST components, chain=" + std::to_string(n), chain,
+               FirstByComponents, "evals");
+
+        std::vector<Grammar> reverse_chain;
+        for (int i = 0; i < 5; ++i) {
+            reverse_chain.push_back(ReverseChain(n));
+        }
+        Report("FOLLOW fixpoint, rchain=" + std::to_string(n), reverse_chain,
+               FollowByFixpoint, "prods");
+        Report("FOLLOW digraph, rchain=" + std::to_string(n), reverse_chain,
+               FollowByDigraph, "prods");
+    }
+
+    for (std::size_t n : {16, 64, 256}) {
+        std::vector<Grammar> synthetic;
+        for (int i = 0; i < 5; ++i) {
+            Grammar gr = Synthetic(n);
+            gr.TransformToAugmentedGrammar();
+            synthetic.push_back(std::move(gr));
+        }
+        Report("FIRST/FOLLOW, n=" + std::to_string(n), synthetic,
+               BuildFirstFollow, "prods");
+        Report("LL(1) table, n=" + std::to_string(n), synthetic,
+               BuildLL1Table, "rows");
+        Report("FOLLOW fixpoint, n=" + std::to_string(n), synthetic,
+               FollowByFixpoint, "prods");
+        Report("FOLLOW digraph, n=" + std::to_string(n), synthetic,
+               FollowByDigraph, "prods");
+        Report("SLR(1) automaton, n=" + std::to_string(n), synthetic,
+               BuildSLR1, "states");
+    }
+    return 0;
+}
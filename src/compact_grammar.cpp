@@ -0,0 +1,68 @@
+#include "compact_grammar.hpp"
+#include "grammar.hpp"
+#include "symbol_table.hpp"
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+CompactGrammar::CompactGrammar(const Grammar& grammar) : st_(grammar.st_) {
+    axiom_ = st_.Intern(grammar.axiom_);
+
+    // Count productions and symbols per non-terminal, then lay them out in
+    // non-terminal order (counting sort, stable within each non-terminal).
+    const std::size_t          nts = st_.non_terminal_ids_.size();
+    std::vector<std::uint32_t> prod_count(nts, 0);
+    std::size_t                total_symbols = 0;
+    std::size_t                total_prods   = 0;
+    for (const auto& [lhs, productions] : grammar.g_) {
+        prod_count[st_.kind_index_[st_.Id(lhs)]] +=
+            static_cast<std::uint32_t>(productions.size());
+        total_prods += productions.size();
+        for (const production& prod : productions) {
+            total_symbols += prod.size();
+        }
+    }
+
+    nt_offsets_.assign(nts + 1, 0);
+    for (std::size_t k = 0; k < nts; ++k) {
+        nt_offsets_[k + 1] = nt_offsets_[k] + prod_count[k];
+    }
+
+    symbols_.reserve(total_symbols);
+    rhs_offsets_.reserve(total_prods + 1);
+    lhs_.reserve(total_prods);
+    for (SymbolId nt : st_.non_terminal_ids_) {
+        auto it = grammar.g_.find(st_.Name(nt));
+        if (it == grammar.g_.end()) {
+            continue;
+        }
+        for (const production& prod : it->second) {
+            for (const std::string& symbol : prod) {
+                symbols_.push_back(st_.Id(symbol));
+            }
+            rhs_offsets_.push_back(static_cast<std::uint32_t>(symbols_.size()));
+            lhs_.push_back(nt);
+        }
+    }
+}
+
+Grammar CompactGrammar::ToGrammar() const {
+    Grammar grammar;
+    grammar.st_    = st_;
+    grammar.axiom_ = st_.Name(axiom_);
+    grammar.g_     = ToRules();
+    return grammar;
+}
+
+std::unordered_map<std::string, std::vector<production>>
+CompactGrammar::ToRules() const {
+    std::unordered_map<std::string, std::vector<production>> rules;
+    for (std::uint32_t p = 0; p < ProductionCount(); ++p) {
+        production& prod = rules[st_.Name(lhs_[p])].emplace_back();
+        for (SymbolId symbol : Rhs(p)) {
+            prod.push_back(st_.Name(symbol));
+        }
+    }
+    return rules;
+}
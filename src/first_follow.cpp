@@ -0,0 +1,145 @@
+#include "first_follow.hpp"
+#include "compact_grammar.hpp"
+#include "symbol_table.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+index_lists index_lists::Transposed(std::size_t size) const {
+    // Counting sort of the items by value, stable in the list index
+    index_lists result;
+    result.offsets_.assign(size + 1, 0);
+    for (std::uint32_t item : items_) {
+        ++result.offsets_[item + 1];
+    }
+    for (std::size_t j = 0; j < size; ++j) {
+        result.offsets_[j + 1] += result.offsets_[j];
+    }
+    result.items_.resize(items_.size());
+    std::vector<std::uint32_t> next(result.offsets_.begin(),
+                                    result.offsets_.end() - 1);
+    for (std::uint32_t i = 0; i < Size(); ++i) {
+        for (std::uint32_t item : (*this)[i]) {
+            result.items_[next[item]++] = i;
+        }
+    }
+    return result;
+}
+
+index_lists StronglyConnectedComponents(const index_lists& graph) {
+    constexpr std::uint32_t UNVISITED =
+        std::numeric_limits<std::uint32_t>::max();
+
+    const std::size_t          n = graph.Size();
+    std::vector<std::uint32_t> index(n, UNVISITED);
+    std::vector<std::uint32_t> low(n, 0);
+    std::vector<bool>          on_stack(n, false);
+    std::vector<std::uint32_t> stack;
+    index_lists                components;
+    std::uint32_t              next_index = 0;
+
+    // Explicit DFS stack of (node, next edge to explore)
+    std::vector<std::pair<std::uint32_t, std::uint32_t>> dfs;
+    for (std::uint32_t root = 0; root < n; ++root) {
+        if (index[root] != UNVISITED) {
+            continue;
+        }
+        dfs.emplace_back(root, 0);
+        while (!dfs.empty()) {
+            auto& [v, edge] = dfs.back();
+            if (edge == 0) {
+                index[v] = low[v] = next_index++;
+                stack.push_back(v);
+                on_stack[v] = true;
+            }
+            if (edge < graph[v].size()) {
+                const std::uint32_t w = graph[v][edge++];
+                if (index[w] == UNVISITED) {
+                    dfs.emplace_back(w, 0);
+                } else if (on_stack[w]) {
+                    low[v] = std::min(low[v], index[w]);
+                }
+                continue;
+            }
+
+            const std::uint32_t done = v;
+            dfs.pop_back();
+            if (!dfs.empty()) {
+                const std::uint32_t parent = dfs.back().first;
+                low[parent]                = std::min(low[parent], low[done]);
+            }
+            if (low[done] == index[done]) {
+                std::uint32_t w;
+                do {
+                    w = stack.back();
+                    stack.pop_back();
+                    on_stack[w] = false;
+                    components.items_.push_back(w);
+                } while (w != done);
+                components.Close();
+            }
+        }
+    }
+    return components;
+}
+
+std::vector<bool> NullableNonTerminals(const CompactGrammar& grammar) {
+    const SymbolTable& st = grammar.st_;
+    const std::size_t  n  = st.non_terminal_ids_.size();
+    std::vector<bool>  nullable(n, false);
+
+    // uses[p]: non-terminals of p, if every other symbol before EOL is
+    // EPSILON; a production with a real terminal can never be nullable and
+    // gets an empty list. blockers[p] counts the ones not yet known to be
+    // nullable.
+    index_lists                uses;
+    std::vector<std::uint32_t> blockers(grammar.ProductionCount(), 0);
+    std::vector<std::uint32_t> worklist;
+    for (std::uint32_t p = 0; p < grammar.ProductionCount(); ++p) {
+        const std::size_t start     = uses.items_.size();
+        bool              candidate = true;
+        for (SymbolId symbol : grammar.Rhs(p)) {
+            if (symbol == SymbolTable::EOL_ID_) {
+                break;
+            }
+            if (symbol == SymbolTable::EPSILON_ID_) {
+                continue;
+            }
+            if (st.IsTerminal(symbol)) {
+                candidate = false;
+                break;
+            }
+            uses.items_.push_back(st.kind_index_[symbol]);
+        }
+        if (!candidate) {
+            uses.items_.resize(start);
+        }
+        uses.Close();
+        blockers[p] = static_cast<std::uint32_t>(uses.items_.size() - start);
+
+        const std::uint32_t lhs = st.kind_index_[grammar.Lhs(p)];
+        if (candidate && blockers[p] == 0 && !nullable[lhs]) {
+            nullable[lhs] = true;
+            worklist.push_back(lhs);
+        }
+    }
+
+    const index_lists used_by = uses.Transposed(n);
+    while (!worklist.empty()) {
+        const std::uint32_t b = worklist.back();
+        worklist.pop_back();
+        for (std::uint32_t p : used_by[b]) {
+            if (--blockers[p] != 0) {
+                continue;
+            }
+            const std::uint32_t lhs = st.kind_index_[grammar.Lhs(p)];
+            if (!nullable[lhs]) {
+                nullable[lhs] = true;
+                worklist.push_back(lhs);
+            }
+        }
+    }
+    return nullable;
+}
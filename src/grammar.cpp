@@ -20,6 +20,13 @@ Grammar::Grammar(
             }
         }
     }
+    for (const auto& [nt, prods] : grammar) {
+        for (const auto& prod : prods) {
+            for (const std::string& symbol : prod) {
+                st_.Intern(symbol);
+            }
+        }
+    }
     axiom_ = "S";
     g_     = grammar;
     g_["S"] = {{"A", st_.EOL_}};
@@ -105,5 +112,9 @@ bool Grammar::HasLeftRecursion(const std::string&              antecedent,
 
 void Grammar::AddProduction(const std::string&              antecedent,
                             const std::vector<std::string>& consequent) {
+    st_.Intern(antecedent);
+    for (const std::string& symbol : consequent) {
+        st_.Intern(symbol);
+    }
     g_[antecedent].push_back(consequent);
 }
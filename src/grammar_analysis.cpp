@@ -0,0 +1,49 @@
+#include "grammar_analysis.hpp"
+#include "compact_grammar.hpp"
+#include "first_follow.hpp"
+#include "grammar.hpp"
+#include "symbol_table.hpp"
+#include <unordered_set>
+#include <variant>
+#include <vector>
+
+GrammarAnalysis::GrammarAnalysis(const Grammar& grammar)
+    : cg_(grammar), sets_(MakeTerminalSets(cg_)) {}
+
+const std::vector<bool>& GrammarAnalysis::Nullable() const {
+    if (!IsCached(NULLABLE)) {
+        nullable_ = NullableNonTerminals(cg_);
+        cached_ |= NULLABLE;
+    }
+    return nullable_;
+}
+
+std::unordered_set<SymbolId> GrammarAnalysis::NullableSymbols() const {
+    const std::vector<bool>&     nullable = Nullable();
+    std::unordered_set<SymbolId> ids;
+    for (std::size_t a = 0; a < nullable.size(); ++a) {
+        if (nullable[a]) {
+            ids.insert(cg_.st_.non_terminal_ids_[a]);
+        }
+    }
+    return ids;
+}
+
+const terminal_sets& GrammarAnalysis::FirstSets() const {
+    if (!IsCached(FIRST)) {
+        const std::vector<bool>& nullable = Nullable();
+        std::visit([&](auto& sets) { sets.ComputeFirstSets(cg_, nullable); },
+                   sets_);
+        cached_ |= FIRST;
+    }
+    return sets_;
+}
+
+const terminal_sets& GrammarAnalysis::Sets() const {
+    if (!IsCached(FOLLOW)) {
+        FirstSets();
+        std::visit([&](auto& sets) { sets.ComputeFollowSets(cg_); }, sets_);
+        cached_ |= FOLLOW;
+    }
+    return sets_;
+}
@@ -0,0 +1,373 @@
+#include "grammar_corpus.hpp"
+#include "grammar.hpp"
+#include "grammar_factory.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+/// @brief Alignment of every array of a corpus file.
+constexpr std::uint64_t SECTION_ALIGN = 8;
+
+std::uint64_t AlignUp(std::uint64_t offset) {
+    return (offset + SECTION_ALIGN - 1) / SECTION_ALIGN * SECTION_ALIGN;
+}
+
+std::uint32_t CheckedU32(std::size_t value) {
+    if (value > UINT32_MAX) {
+        throw std::runtime_error("Corpus too large for 32-bit offsets");
+    }
+    return static_cast<std::uint32_t>(value);
+}
+
+/// @brief Whether every value is below `bound`.
+bool AllBelow(std::span<const std::uint32_t> values, std::uint64_t bound) {
+    return std::all_of(values.begin(), values.end(),
+                       [bound](std::uint32_t v) { return v < bound; });
+}
+
+/// @brief Whether the offsets never decrease and the last is `end`.
+bool ClosesAt(std::span<const std::uint32_t> offsets, std::uint64_t end) {
+    return !offsets.empty() && offsets.back() == end &&
+           std::is_sorted(offsets.begin(), offsets.end());
+}
+
+} // namespace
+
+std::uint32_t GrammarCorpusWriter::NameId(const std::string& name) {
+    auto [it, inserted] =
+        name_ids_.try_emplace(name, CheckedU32(names_.size()));
+    if (inserted) {
+        names_.push_back(name);
+    }
+    return it->second;
+}
+
+void GrammarCorpusWriter::Add(const Grammar& gr, int level,
+                              GrammarFactory::ll1_fix ll1, bool slr1) {
+    const SymbolTable& st = gr.st_;
+    records_.push_back({CheckedU32(symbols_.size()), CheckedU32(lhs_.size()),
+                        NameId(gr.axiom_), static_cast<std::uint16_t>(level),
+                        static_cast<std::uint8_t>(ll1),
+                        static_cast<std::uint8_t>(slr1)});
+
+    // Local ids map to name ids through the stored symbol table
+    std::vector<std::uint32_t> local(st.Size());
+    for (SymbolId id = 0; id < st.Size(); ++id) {
+        const std::string& name     = st.Name(id);
+        const bool         terminal = st.IsTerminal(id);
+        const bool declared = terminal ? st.terminals_wtho_eol_.contains(name)
+                                       : st.non_terminals_.contains(name);
+        local[id]           = NameId(name);
+        symbols_.push_back(local[id]);
+        symbol_flags_.push_back(
+            (terminal ? GrammarCorpus::TERMINAL_FLAG_ : 0) |
+            (declared ? GrammarCorpus::DECLARED_FLAG_ : 0));
+    }
+
+    // Productions are grouped by antecedent, in symbol table order
+    for (SymbolId nt : st.non_terminal_ids_) {
+        auto it = gr.g_.find(st.Name(nt));
+        if (it == gr.g_.end()) {
+            continue;
+        }
+        for (const production& prod : it->second) {
+            lhs_.push_back(local[nt]);
+            for (const std::string& symbol : prod) {
+                rhs_.push_back(local[st.Id(symbol)]);
+            }
+            rhs_offsets_.push_back(CheckedU32(rhs_.size()));
+        }
+    }
+}
+
+void GrammarCorpusWriter::AddLevel(GrammarFactory& factory, int level,
+                                   std::size_t draws) {
+    if (level <= GrammarFactory::MAX_INDEXED_LEVEL_) {
+        if (factory.IndexOf(level) == nullptr) {
+            factory.BuildIndex(level);
+        }
+        for (const GrammarFactory::catalog_entry& entry :
+             factory.IndexOf(level)->grammars_) {
+            if (entry.ll1_ != GrammarFactory::NOT_LL1 || entry.slr1_) {
+                Add(entry.rules_.ToGrammar(), level, entry.ll1_, entry.slr1_);
+            }
+        }
+        return;
+    }
+    for (std::size_t k = 0; k < draws; ++k) {
+        Grammar                       gr      = factory.PickOne(level, k);
+        Grammar                       fixable = gr;
+        const GrammarFactory::ll1_fix ll1     = factory.MakeLL1(fixable);
+        const bool                    slr1    = factory.IsAcceptedSLR1(gr);
+        if (ll1 != GrammarFactory::NOT_LL1 || slr1) {
+            Add(gr, level, ll1, slr1);
+        }
+    }
+}
+
+void GrammarCorpusWriter::Write(const std::string& path) const {
+    // Buckets: grammars by (level, class), in corpus order
+    std::vector<corpus_bucket> buckets;
+    std::vector<std::uint32_t> members;
+    std::vector<std::uint16_t> levels;
+    for (const corpus_record& record : records_) {
+        levels.push_back(record.level_);
+    }
+    std::sort(levels.begin(), levels.end());
+    levels.erase(std::unique(levels.begin(), levels.end()), levels.end());
+    for (std::uint16_t level : levels) {
+        for (std::uint32_t cls = 0; cls < CORPUS_CLASS_COUNT; ++cls) {
+            corpus_bucket bucket{level, cls, CheckedU32(members.size()), 0};
+            for (std::uint32_t i = 0; i < records_.size(); ++i) {
+                const corpus_record& record = records_[i];
+                const bool           member =
+                    record.level_ == level &&
+                    (cls == CORPUS_ANY ||
+                     (cls == CORPUS_LL1 &&
+                      record.ll1_ != GrammarFactory::NOT_LL1) ||
+                     (cls == CORPUS_SLR1 && record.slr1_));
+                if (member) {
+                    members.push_back(i);
+                }
+            }
+            bucket.count_ = CheckedU32(members.size()) - bucket.first_;
+            buckets.push_back(bucket);
+        }
+    }
+
+    std::vector<std::uint32_t> name_offsets{0};
+    std::string                name_bytes;
+    for (const std::string& name : names_) {
+        name_bytes += name;
+        name_offsets.push_back(CheckedU32(name_bytes.size()));
+    }
+    std::vector<corpus_record> records = records_;
+    records.push_back({CheckedU32(symbols_.size()), CheckedU32(lhs_.size()),
+                       0, 0, 0, 0});
+
+    struct section_data {
+        const void* data;
+        std::size_t count;
+        std::size_t size;
+    };
+    const section_data sections[SECTION_COUNT] = {
+        {name_bytes.data(), name_bytes.size(), 1},
+        {name_offsets.data(), name_offsets.size(), sizeof(std::uint32_t)},
+        {records.data(), records.size(), sizeof(corpus_record)},
+        {symbols_.data(), symbols_.size(), sizeof(std::uint32_t)},
+        {symbol_flags_.data(), symbol_flags_.size(), sizeof(std::uint8_t)},
+        {lhs_.data(), lhs_.size(), sizeof(std::uint32_t)},
+        {rhs_offsets_.data(), rhs_offsets_.size(), sizeof(std::uint32_t)},
+        {rhs_.data(), rhs_.size(), sizeof(std::uint32_t)},
+        {buckets.data(), buckets.size(), sizeof(corpus_bucket)},
+        {members.data(), members.size(), sizeof(std::uint32_t)}};
+
+    corpus_header header{};
+    std::memcpy(header.magic_, GrammarCorpus::MAGIC_, sizeof(header.magic_));
+    header.version_    = GrammarCorpus::VERSION_;
+    header.byte_order_ = GrammarCorpus::BYTE_ORDER_;
+    std::uint64_t offset = AlignUp(sizeof(corpus_header));
+    for (std::uint32_t s = 0; s < SECTION_COUNT; ++s) {
+        header.sections_[s] = {offset, sections[s].count};
+        offset = AlignUp(offset + sections[s].count * sections[s].size);
+    }
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        throw std::runtime_error("Cannot open corpus for writing: " + path);
+    }
+    const char padding[SECTION_ALIGN] = {};
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    std::uint64_t written = sizeof(header);
+    for (std::uint32_t s = 0; s < SECTION_COUNT; ++s) {
+        out.write(padding, header.sections_[s].offset_ - written);
+        out.write(static_cast<const char*>(sections[s].data),
+                  sections[s].count * sections[s].size);
+        written = header.sections_[s].offset_ +
+                  sections[s].count * sections[s].size;
+    }
+    out.write(padding, offset - written);
+    if (!out) {
+        throw std::runtime_error("Cannot write corpus: " + path);
+    }
+}
+
+GrammarCorpus::GrammarCorpus(const std::string& path) {
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot open corpus: " + path);
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 ||
+        static_cast<std::size_t>(info.st_size) < sizeof(corpus_header)) {
+        close(fd);
+        throw std::runtime_error("Not a grammar corpus: " + path);
+    }
+    const std::size_t size = static_cast<std::size_t>(info.st_size);
+    void*             data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        throw std::runtime_error("Cannot map corpus: " + path);
+    }
+    data_ = static_cast<const char*>(data);
+    size_ = size;
+
+    try {
+        const auto* header = reinterpret_cast<const corpus_header*>(data_);
+        if (std::memcmp(header->magic_, MAGIC_, sizeof(MAGIC_)) != 0 ||
+            header->byte_order_ != BYTE_ORDER_) {
+            throw std::runtime_error("Not a grammar corpus: " + path);
+        }
+        if (header->version_ != VERSION_) {
+            throw std::runtime_error("Unsupported corpus version " +
+                                     std::to_string(header->version_) + ": " +
+                                     path);
+        }
+        names_        = Section<char>(SECTION_NAMES);
+        name_offsets_ = Section<std::uint32_t>(SECTION_NAME_OFFSETS);
+        records_      = Section<corpus_record>(SECTION_RECORDS);
+        symbols_      = Section<std::uint32_t>(SECTION_SYMBOLS);
+        symbol_flags_ = Section<std::uint8_t>(SECTION_SYMBOL_FLAGS);
+        lhs_          = Section<std::uint32_t>(SECTION_LHS);
+        rhs_offsets_  = Section<std::uint32_t>(SECTION_RHS_OFFSETS);
+        rhs_          = Section<std::uint32_t>(SECTION_RHS);
+        buckets_      = Section<corpus_bucket>(SECTION_BUCKETS);
+        members_      = Section<std::uint32_t>(SECTION_MEMBERS);
+
+        // The sentinels must close every array, and every offset and id
+        // must stay inside its array, so that readers need no checks
+        const bool consistent =
+            ClosesAt(name_offsets_, names_.size()) && !records_.empty() &&
+            records_.back().first_symbol_ == symbols_.size() &&
+            records_.back().first_production_ == lhs_.size() &&
+            std::adjacent_find(
+                records_.begin(), records_.end(),
+                [](const corpus_record& a, const corpus_record& b) {
+                    return b.first_symbol_ < a.first_symbol_ ||
+                           b.first_production_ < a.first_production_;
+                }) == records_.end() &&
+            symbol_flags_.size() == symbols_.size() &&
+            rhs_offsets_.size() == lhs_.size() + 1 &&
+            ClosesAt(rhs_offsets_, rhs_.size());
+        const std::uint64_t name_count = name_offsets_.size() - 1;
+        if (!consistent || !AllBelow(symbols_, name_count) ||
+            !AllBelow(lhs_, name_count) || !AllBelow(rhs_, name_count) ||
+            !std::all_of(records_.begin(), records_.end() - 1,
+                         [&](const corpus_record& r) {
+                             return r.axiom_ < name_count;
+                         }) ||
+            !std::all_of(buckets_.begin(), buckets_.end(),
+                         [&](const corpus_bucket& b) {
+                             return std::uint64_t{b.first_} + b.count_ <=
+                                    members_.size();
+                         }) ||
+            !AllBelow(members_, Size())) {
+            throw std::runtime_error("Corrupted corpus: " + path);
+        }
+    } catch (...) {
+        munmap(const_cast<char*>(data_), size_);
+        throw;
+    }
+}
+
+GrammarCorpus::~GrammarCorpus() {
+    munmap(const_cast<char*>(data_), size_);
+}
+
+template <typename T>
+std::span<const T> GrammarCorpus::Section(corpus_section s) const {
+    const corpus_extent& extent =
+        reinterpret_cast<const corpus_header*>(data_)->sections_[s];
+    if (extent.offset_ % alignof(T) != 0 || extent.offset_ > size_ ||
+        extent.count_ > (size_ - extent.offset_) / sizeof(T)) {
+        throw std::runtime_error("Corrupted corpus section " +
+                                 std::to_string(s));
+    }
+    return {reinterpret_cast<const T*>(data_ + extent.offset_),
+            static_cast<std::size_t>(extent.count_)};
+}
+
+std::span<const std::uint32_t> GrammarCorpus::Members(int          level,
+                                                      corpus_class cls) const {
+    auto it = std::lower_bound(
+        buckets_.begin(), buckets_.end(), std::make_pair(level, cls),
+        [](const corpus_bucket& b, const std::pair<int, corpus_class>& key) {
+            return std::make_pair(static_cast<int>(b.level_), b.class_) <
+                   std::make_pair(key.first,
+                                  static_cast<std::uint32_t>(key.second));
+        });
+    if (it == buckets_.end() || static_cast<int>(it->level_) != level ||
+        it->class_ != cls) {
+        return {};
+    }
+    return members_.subspan(it->first_, it->count_);
+}
+
+int GrammarView::Level() const {
+    return corpus_->records_[index_].level_;
+}
+
+GrammarFactory::ll1_fix GrammarView::LL1Fix() const {
+    return static_cast<GrammarFactory::ll1_fix>(
+        corpus_->records_[index_].ll1_);
+}
+
+bool GrammarView::IsSLR1() const {
+    return corpus_->records_[index_].slr1_ != 0;
+}
+
+std::uint32_t GrammarView::Axiom() const {
+    return corpus_->records_[index_].axiom_;
+}
+
+std::uint32_t GrammarView::ProductionCount() const {
+    return corpus_->records_[index_ + 1].first_production_ -
+           corpus_->records_[index_].first_production_;
+}
+
+std::uint32_t GrammarView::Lhs(std::uint32_t p) const {
+    return corpus_->lhs_[corpus_->records_[index_].first_production_ + p];
+}
+
+std::span<const std::uint32_t> GrammarView::Rhs(std::uint32_t p) const {
+    const std::uint32_t q = corpus_->records_[index_].first_production_ + p;
+    return corpus_->rhs_.subspan(corpus_->rhs_offsets_[q],
+                                 corpus_->rhs_offsets_[q + 1] -
+                                     corpus_->rhs_offsets_[q]);
+}
+
+Grammar GrammarView::ToGrammar() const {
+    const corpus_record& record = corpus_->records_[index_];
+    const corpus_record& next   = corpus_->records_[index_ + 1];
+    Grammar              gr;
+    for (std::uint32_t i = record.first_symbol_; i < next.first_symbol_; ++i) {
+        const std::string  name(corpus_->Name(corpus_->symbols_[i]));
+        const std::uint8_t flags    = corpus_->symbol_flags_[i];
+        const bool         terminal = flags & GrammarCorpus::TERMINAL_FLAG_;
+        if (flags & GrammarCorpus::DECLARED_FLAG_) {
+            gr.st_.PutSymbol(name, terminal);
+        } else {
+            gr.st_.Intern(name, terminal ? TERMINAL : NO_TERMINAL);
+        }
+    }
+    gr.axiom_ = std::string(corpus_->Name(record.axiom_));
+    for (std::uint32_t p = 0; p < ProductionCount(); ++p) {
+        production& prod =
+            gr.g_[std::string(corpus_->Name(Lhs(p)))].emplace_back();
+        for (std::uint32_t symbol : Rhs(p)) {
+            prod.emplace_back(corpus_->Name(symbol));
+        }
+    }
+    return gr;
+}
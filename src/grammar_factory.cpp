@@ -1,742 +1,1707 @@
 #include "grammar_factory.hpp"
+#include "grammar_analysis.hpp"
 #include "ll1_parser.hpp"
 #include "slr1_parser.hpp"
 #include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <exception>
 #include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <numeric>
 #include <queue>
 #include <random>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_set>
+
+namespace {
+
+/**
+ * @brief Indices of a batch a thread of GenerateBatch still has to generate:
+ * from `begin_` to `end_`.
+ */
+struct batch_share {
+    std::mutex    mutex_;
+    std::uint64_t begin_{0};
+    std::uint64_t end_{0};
+};
+
+/// @brief Takes the first index of a share, if any is left.
+bool TakeFront(batch_share& share, std::uint64_t& index) {
+    std::lock_guard<std::mutex> lock(share.mutex_);
+    if (share.begin_ == share.end_) {
+        return false;
+    }
+    index = share.begin_++;
+    return true;
+}
+
+/**
+ * @brief Moves the second half of the largest share of another thread to
+ * share `w`, and takes its first index.
+ * @return false if every share is empty.
+ */
+bool Steal(std::vector<batch_share>& shares, std::size_t w,
+           std::uint64_t& index) {
+    while (true) {
+        std::size_t   victim = w;
+        std::uint64_t most   = 0;
+        for (std::size_t v = 0; v < shares.size(); ++v) {
+            std::lock_guard<std::mutex> lock(shares[v].mutex_);
+            if (v != w && shares[v].end_ - shares[v].begin_ > most) {
+                victim = v;
+                most   = shares[v].end_ - shares[v].begin_;
+            }
+        }
+        if (victim == w) {
+            return false;
+        }
+        std::uint64_t begin;
+        std::uint64_t end;
+        {
+            std::lock_guard<std::mutex> lock(shares[victim].mutex_);
+            batch_share&                from = shares[victim];
+            if (from.begin_ == from.end_) {
+                continue; // Emptied meanwhile: look again
+            }
+            begin     = from.begin_ + (from.end_ - from.begin_) / 2;
+            end       = from.end_;
+            from.end_ = begin;
+        }
+        std::lock_guard<std::mutex> lock(shares[w].mutex_);
+        index            = begin;
+        shares[w].begin_ = begin + 1;
+        shares[w].end_   = end;
+        return true;
+    }
+}
+
+/// @brief Returns the first check a grammar fails, see generation_result.
+GrammarFactory::rejection_reason RejectionOf(const grammar_verdicts& v) {
+    return v.infinite_      ? GrammarFactory::REJECTED_INFINITE
+           : v.unreachable_ ? GrammarFactory::REJECTED_UNREACHABLE
+                            : GrammarFactory::REJECTED_CONFLICT;
+}
+
+/**
+ * @brief Returns the non-terminal of a level of a composition: the tables of
+ * the compositions intern the non-terminals in level order, after the axiom.
+ */
+SymbolId LevelNonTerminal(const CompactGrammar& rules, std::size_t level) {
+    return rules.axiom_ + static_cast<SymbolId>(level);
+}
+
+/**
+ * @brief Returns the rules of a composition as a flat key: the left-hand
+ * side, the length and the right-hand side of every production.
+ */
+std::vector<std::uint32_t> RulesKey(const CompactGrammar& rules) {
+    std::vector<std::uint32_t> key;
+    key.reserve(rules.symbols_.size() + 2 * rules.ProductionCount());
+    for (std::uint32_t p = 0; p < rules.ProductionCount(); ++p) {
+        const std::span<const SymbolId> rhs = rules.Rhs(p);
+        key.push_back(rules.Lhs(p));
+        key.push_back(static_cast<std::uint32_t>(rhs.size()));
+        key.insert(key.end(), rhs.begin(), rhs.end());
+    }
+    return key;
+}
+
+/// @brief Inserts a symbol in a sorted vector, unless it is already there.
+void InsertSorted(std::vector<SymbolId>& symbols, SymbolId symbol) {
+    if (auto it = std::ranges::lower_bound(symbols, symbol);
+        it == symbols.end() || *it != symbol) {
+        symbols.insert(it, symbol);
+    }
+}
+
+/**
+ * @brief Returns the canonical labeling of the terminals of a composition,
+ * see CanonicalLabeling.
+ * @param symbols Receives the symbol of every number of the input.
+ */
+canonical_labeling TerminalLabeling(const GrammarFactory::composition& rules,
+                                    std::vector<SymbolId>& symbols) {
+    // Only the symbols of the rules are numbered: unused ones would tie
+    const CompactGrammar&      cg = rules.rules_;
+    std::vector<std::uint32_t> numbers(cg.st_.Size(), UINT32_MAX);
+    canonical_input            in;
+    symbols.clear();
+    const auto number = [&](SymbolId id) {
+        if (numbers[id] == UINT32_MAX) {
+            numbers[id] = static_cast<std::uint32_t>(symbols.size());
+            symbols.push_back(id);
+            in.kinds_.push_back(id == SymbolTable::EOL_ID_ ? EOL_ROLE
+                                : id == SymbolTable::EPSILON_ID_
+                                    ? EPSILON_ROLE
+                                : id == cg.axiom_       ? AXIOM_ROLE
+                                : cg.st_.IsTerminal(id) ? TERMINAL_ROLE
+                                                        : NON_TERMINAL_ROLE);
+        }
+        return numbers[id];
+    };
+    // Non-terminals first, in level order, so that they keep their numbers
+    for (SymbolId nt : cg.lhs_) {
+        number(nt);
+    }
+    for (std::uint32_t p = 0; p < cg.ProductionCount(); ++p) {
+        in.lhs_.push_back(numbers[cg.Lhs(p)]);
+        std::vector<std::uint32_t>& rhs = in.rhs_.emplace_back();
+        for (SymbolId symbol : cg.Rhs(p)) {
+            rhs.push_back(number(symbol));
+        }
+    }
+    return CanonicalLabeling(in, true);
+}
+
+/**
+ * @brief Replaces every symbol `s` of a composition with `renamed[s]`, and
+ * sorts the productions of every non-terminal.
+ * @param renamed A bijection of the terminals, identity elsewhere.
+ */
+void ApplyRenaming(GrammarFactory::composition& rules,
+                   const std::vector<SymbolId>& renamed) {
+    CompactGrammar& cg = rules.rules_;
+
+    // A non-terminal keeps the symbols of its range, in another order
+    std::vector<std::vector<SymbolId>> prods;
+    for (std::size_t k = 0; k + 1 < cg.nt_offsets_.size(); ++k) {
+        prods.clear();
+        for (std::uint32_t p = cg.nt_offsets_[k]; p < cg.nt_offsets_[k + 1];
+             ++p) {
+            std::vector<SymbolId>& prod = prods.emplace_back();
+            for (SymbolId symbol : cg.Rhs(p)) {
+                prod.push_back(renamed[symbol]);
+            }
+        }
+        std::ranges::sort(prods);
+        std::uint32_t p = cg.nt_offsets_[k];
+        for (const std::vector<SymbolId>& prod : prods) {
+            std::ranges::copy(prod, cg.symbols_.begin() + cg.rhs_offsets_[p]);
+            cg.rhs_offsets_[p + 1] =
+                cg.rhs_offsets_[p] + static_cast<std::uint32_t>(prod.size());
+            ++p;
+        }
+    }
+    // Sorted productions no longer line up with their items
+    rules.items_.clear();
+    for (SymbolId& t : rules.terminals_) {
+        t = renamed[t];
+    }
+    std::ranges::sort(rules.terminals_);
+}
+
+/**
+ * @brief Renames the terminals of a composition to the first ones of
+ * `alphabet`, in the order of their colors, and sorts the productions of
+ * every non-terminal.
+ * @param symbols The symbols of the labeling, see TerminalLabeling.
+ */
+void RenameTerminals(GrammarFactory::composition& rules,
+                     const std::vector<SymbolId>& symbols,
+                     const canonical_labeling&    labeling,
+                     const std::vector<SymbolId>& alphabet) {
+    CompactGrammar&            cg = rules.rules_;
+    std::vector<std::uint32_t> order;
+    for (std::uint32_t x = 0; x < symbols.size(); ++x) {
+        if (cg.st_.IsTerminalWthoEol(symbols[x]) &&
+            symbols[x] != SymbolTable::EOL_ID_) {
+            order.push_back(x);
+        }
+    }
+    std::ranges::sort(order, {},
+                      [&](std::uint32_t x) { return labeling.colors_[x]; });
+    std::vector<SymbolId> renamed(cg.st_.Size());
+    std::iota(renamed.begin(), renamed.end(), SymbolId{0});
+    for (std::size_t k = 0; k < order.size(); ++k) {
+        renamed[symbols[order[k]]] = alphabet.at(k);
+    }
+    ApplyRenaming(rules, renamed);
+}
+
+} // namespace
+
+GrammarFactory::GrammarFactory(std::shared_ptr<const catalog> shared)
+    : catalog_(std::move(shared)) {}
+
+const std::shared_ptr<const GrammarFactory::catalog>&
+GrammarFactory::EmptyCatalog() {
+    static const std::shared_ptr<const catalog> empty =
+        std::make_shared<const catalog>();
+    return empty;
+}
 
 void GrammarFactory::Init() {
-    items.emplace_back(
+    auto cat = std::make_shared<catalog>();
+    cat->items.emplace_back(
         std::unordered_map<std::string, std::vector<std::vector<std::string>>>{
             {"A", {{"a", "b", "A"}, {"a"}}}});
 
-    items.emplace_back(
+    cat->items.emplace_back(
         std::unordered_map<std::string, std::vector<std::vector<std::string>>>{
             {"A", {{"a", "b", "A"}, {"a", "b"}}}});
 
-    items.emplace_back(
+    cat->items.emplace_back(
         std::unordered_map<std::string, std::vector<std::vector<std::string>>>{
             {"A", {{"a", "A", "b"}, {"EPSILON"}}}});
 
-    items.emplace_back(
+    cat->items.emplace_back(
         std::unordered_map<std::string, std::vector<std::vector<std::string>>>{
             {"A", {{"A", "a"}, {"EPSILON"}}}});
 
-    items.emplace_back(
+    cat->items.emplace_back(
         std::unordered_map<std::string, std::vector<std::vector<std::string>>>{
             {"A", {{"a", "A"}, {"EPSILON"}}}});
 
-    items.emplace_back(
+    cat->items.emplace_back(
         std::unordered_map<std::string, std::vector<std::vector<std::string>>>{
             {"A", {{"a", "A", "c"}, {"b"}}}});
 
-    items.emplace_back(
+    cat->items.emplace_back(
         std::unordered_map<std::string, std::vector<std::vector<std::string>>>{
             {"A", {{"a", "A", "a"}, {"b"}}}});
 
-    items.emplace_back(
+    cat->items.emplace_back(
         std::unordered_map<std::string, std::vector<std::vector<std::string>>>{
             {"A", {{"A", "a"}, {"b"}}}});
 
-    items.emplace_back(
+    cat->items.emplace_back(
         std::unordered_map<std::string, std::vector<std::vector<std::string>>>{
             {"A", {{"b", "A"}, {"a"}}}});
+
+    // The builders read the catalog through `catalog_` while they fill it
+    const generation_stats stats = stats_;
+    catalog_                     = cat;
+    for (const std::string& t : cat->terminal_alphabet_) {
+        cat->terminal_ids_.push_back(cat->symbols_.Intern(t, TERMINAL));
+    }
+    cat->symbols_.Intern("S", NO_TERMINAL);
+    for (const std::string& nt : cat->non_terminal_alphabet_) {
+        cat->symbols_.Intern(nt, NO_TERMINAL);
+    }
+    for (std::size_t i = 0; i < cat->items.size(); ++i) {
+        composition& item = cat->item_rules_.emplace_back(
+            Composition(cat->items[i].g_));
+        item.items_ = {i};
+    }
+    BuildLv2Catalog(*cat);
+    BuildSLR1Compatibility(*cat);
+    for (std::size_t i = 0; i < cat->items.size(); ++i) {
+        ll1_construction state;
+        cat->ll1_items_.push_back(InitLL1Sets(ItemComposition(i), state));
+    }
+    cat->indices_[0] = MakeIndex(1);
+    cat->indices_[1] = MakeIndex(2);
+    stats_           = stats;
 }
 
 Grammar GrammarFactory::PickOne(int level) {
-    switch (level) {
-    case 1:
+    if (level <= 1) {
         return Lv1();
-        break;
-    case 2:
-        return Lv2();
-        break;
-    case 3:
-        return Lv3();
-        break;
-    case 4:
-        return Lv4();
-        break;
-    case 5:
-        return Lv5();
-        break;
-    case 6:
-        return Lv6();
-        break;
-    default:
-        return Lv7();
-        break;
     }
+    return LvN(level);
 }
 
 Grammar GrammarFactory::GenLL1Grammar(int level) {
-    while (true) {
-        Grammar   gr = PickOne(level);
-        LL1Parser ll1(gr);
-        if (!IsInfinite(gr) && !HasUnreachableSymbols(gr) &&
-            !HasDirectLeftRecursion(gr) && ll1.CreateLL1Table()) {
-            return gr;
-        }
+    if (const grammar_index* index = IndexOf(level);
+        index != nullptr && !index->ll1_.empty()) {
+        return DrawIndexed(*index, LL1_GRAMMAR);
+    }
+    return TryGenLL1Grammar(level, {}).grammar_;
+}
 
-        RemoveLeftRecursion(gr);
-        ll1 = LL1Parser(gr);
-        if (ll1.CreateLL1Table()) {
-            return gr;
+GrammarFactory::generation_result
+GrammarFactory::TryGenLL1Grammar(int level, const generation_limits& limits) {
+    const grammar_index* index = IndexOf(level);
+    if (index != nullptr && index->ll1_.empty()) {
+        index = nullptr;
+    }
+    const auto attempt = [&](Grammar& gr) -> std::optional<rejection_reason> {
+        if (index != nullptr) {
+            gr = DrawIndexed(*index, LL1_GRAMMAR);
+            return std::nullopt;
+        }
+        Timed(DRAW_STAGE, [&] {
+            gr = PickOne(level);
+            return false;
+        });
+        if (!verdict_cache_) {
+            rejection_reason reason;
+            if (MakeLL1(gr, reason) == NOT_LL1) {
+                return reason;
+            }
+            return std::nullopt;
+        }
+        const grammar_verdicts v = Verdicts(gr, true, false);
+        if (v.ll1_ == NOT_LL1) {
+            return RejectionOf(v);
         }
+        ApplyLL1Fix(gr, static_cast<ll1_fix>(v.ll1_));
+        return std::nullopt;
+    };
+    return Generate(limits, attempt);
+}
 
-        LeftFactorize(gr);
-        ll1 = LL1Parser(gr);
-        if (ll1.CreateLL1Table()) {
-            return gr;
+void GrammarFactory::GenerateBatch(grammar_class type, int level,
+                                   std::size_t count, std::size_t threads,
+                                   const batch_sink& sink) const {
+    threads =
+        std::clamp<std::size_t>(threads, 1, std::max<std::size_t>(count, 1));
+    std::vector<batch_share> shares(threads);
+    for (std::size_t w = 0; w < threads; ++w) {
+        shares[w].begin_ = count * w / threads;
+        shares[w].end_   = count * (w + 1) / threads;
+    }
+    std::mutex         sink_mutex;
+    std::atomic<bool>  stop{false};
+    std::exception_ptr error;
+
+    const auto work = [&](std::size_t w) {
+        try {
+            GrammarFactory factory = *this;
+            std::uint64_t  index;
+            while (!stop && (TakeFront(shares[w], index) ||
+                             Steal(shares, w, index))) {
+                const Grammar gr = type == LL1_GRAMMAR
+                                       ? factory.GenLL1Grammar(level, index)
+                                       : factory.GenSLR1Grammar(level, index);
+                std::lock_guard<std::mutex> lock(sink_mutex);
+                if (!stop && !sink(index, gr)) {
+                    stop = true;
+                }
+            }
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(sink_mutex);
+            if (!error) {
+                error = std::current_exception();
+            }
+            stop = true;
         }
+    };
+    std::vector<std::thread> workers;
+    for (std::size_t w = 1; w < threads; ++w) {
+        workers.emplace_back(work, w);
+    }
+    work(0);
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    if (error) {
+        std::rethrow_exception(error);
     }
 }
 
-Grammar GrammarFactory::GenSLR1Grammar(int level) {
-    Grammar    gr = PickOne(level);
-    SLR1Parser slr1(gr);
+Grammar GrammarFactory::GenLL1GrammarByConstruction(int level) {
+    generation_result result = TryGenLL1GrammarByConstruction(
+        level, {.max_attempts_ = MAX_CONSTRUCTION_RESTARTS_});
+    if (result.status_ != GENERATED) {
+        throw std::runtime_error("No LL(1) grammar of level " +
+                                 std::to_string(level) +
+                                 " found by construction.");
+    }
+    return std::move(result.grammar_);
+}
 
-    while (IsInfinite(gr) || HasUnreachableSymbols(gr) || !slr1.MakeParser()) {
-        gr   = PickOne(level);
-        slr1 = SLR1Parser(gr);
+GrammarFactory::generation_result
+GrammarFactory::TryGenLL1GrammarByConstruction(
+    int level, const generation_limits& limits) {
+    if (level <= 1 ? std::ranges::none_of(catalog_->ll1_items_,
+                                          [](bool ll1) { return ll1; })
+                   : catalog_->lv2_ll1_as_is_.Size() == 0) {
+        generation_result result;
+        result.status_ = OUT_OF_ATTEMPTS;
+        return result;
     }
-    return gr;
+    ll1_construction state;
+    const auto attempt = [&](Grammar& gr) -> std::optional<rejection_reason> {
+        const bool failed =
+            Timed(DRAW_STAGE, [&] { return !ConstructLL1(level, state); });
+        gr = state.rules_.ToGrammar();
+        if (failed) {
+            return REJECTED_CONFLICT;
+        }
+        return std::nullopt;
+    };
+    return Generate(limits, attempt);
 }
 
-void GrammarFactory::SanityChecks(Grammar& gr) {
-    std::cout << "Sanity check (Is Infinite?) : " << IsInfinite(gr) << "\n";
-    std::cout << "Sanity check (Has Unreachable Symbols?) : "
-              << HasUnreachableSymbols(gr) << "\n";
-    std::cout << "Sanity check (Has Direct Left Recursion?) : "
-              << HasDirectLeftRecursion(gr) << "\n";
+GrammarFactory::generation_result
+GrammarFactory::TryGenLL1GrammarByConstruction(
+    int level, std::uint64_t index, const generation_limits& limits) {
+    rng_.Seed(seed_, index);
+    return TryGenLL1GrammarByConstruction(level, limits);
 }
 
-Grammar GrammarFactory::Lv1() {
-    std::random_device                    rd;
-    std::mt19937                          gen(rd());
-    std::uniform_int_distribution<size_t> dist(0, items.size() - 1);
-    return Grammar(items.at(dist(gen)).g_);
-}
-
-Grammar GrammarFactory::Lv2() {
-    return Grammar(CreateLv2Item().g_);
-}
-
-Grammar GrammarFactory::Lv3() {
-    // STEP 1 Build a random LV2 base grammar ------------------------------
-    FactoryItem base = CreateLv2Item();
-
-    // STEP 2 Choose a random LV1 grammar -------------------------------
-    std::random_device                    rd;
-    std::mt19937                          gen(rd());
-    std::uniform_int_distribution<size_t> dist(0, items.size() - 1);
-    FactoryItem                           cmb    = items.at(dist(gen));
-    std::string                           new_nt = "C";
-
-    // STEP 3 Change non terminals in cmb to C ---------------------------
-    std::unordered_map<std::string, std::vector<production>>
-        cmb_updated_grammar;
-    cmb.st_.non_terminals_.emplace(new_nt);
-    for (auto& [nt, prods] : cmb.g_) {
-        for (auto& prod : prods) {
-            for (std::string& symbol : prod) {
-                if (!cmb.st_.IsTerminal(symbol)) {
-                    cmb.st_.non_terminals_.erase(symbol);
-                    symbol = new_nt;
-                }
-            }
+bool GrammarFactory::ConstructLL1(int level, ll1_construction& state) {
+    if (level <= 1) {
+        std::uniform_int_distribution<size_t> dist(0,
+                                                   catalog_->items.size() - 1);
+        const std::size_t item = dist(rng_);
+        state.rules_           = ItemComposition(item);
+        return catalog_->ll1_items_[item];
+    }
+    InitLL1Sets(
+        catalog_->lv2_catalog_[catalog_->lv2_ll1_as_is_.Sample(rng_)].rules_,
+        state);
+    for (int l = 3; l <= level; ++l) {
+        if (!ComposeLL1Step(state, l)) {
+            return false;
         }
-        cmb_updated_grammar[new_nt] = prods;
     }
-    cmb.g_ = std::move(cmb_updated_grammar);
-    cmb.st_.non_terminals_.emplace(new_nt);
-
-    // STEP 4 Change one base terminal to another that is not in cmb
-    std::unordered_set<std::string> cmb_terminals = cmb.st_.terminals_wtho_eol_;
-    std::unordered_set<std::string> terminal_alphabet_set(
-        terminal_alphabet_.begin(), terminal_alphabet_.end());
+    return true;
+}
 
-    for (const std::string& terminal : cmb_terminals) {
-        terminal_alphabet_set.erase(terminal);
+bool GrammarFactory::ComposeLL1Step(ll1_construction& state, int level) {
+    std::uniform_int_distribution<size_t> dist(0, catalog_->items.size() - 1);
+    ll1_undo                              undo;
+    for (int attempt = 0; attempt < MAX_STEP_ATTEMPTS_; ++attempt) {
+        const std::size_t cmb = dist(rng_);
+        if (!catalog_->ll1_items_[cmb]) {
+            continue;
+        }
+        const step_choice choice = DrawStepChoice(state.rules_, cmb);
+        if (ApplyLL1Step(state, cmb, level, choice, undo)) {
+            return true;
+        }
+        UndoLL1Step(state, undo);
     }
+    return false;
+}
 
-    std::uniform_int_distribution<size_t> terminal_dist(
-        0, terminal_alphabet_set.size() - 1);
-    std::vector<std::string> remaining_terminals(terminal_alphabet_set.begin(),
-                                                 terminal_alphabet_set.end());
-    const std::string& new_terminal = remaining_terminals[terminal_dist(gen)];
+bool GrammarFactory::InitLL1Sets(composition       rules,
+                                 ll1_construction& state) const {
+    state.rules_             = std::move(rules);
+    const CompactGrammar& cg = state.rules_.rules_;
+    const SymbolTable&    st = cg.st_;
+    state.sets_              = FirstFollow<SmallTerminalSet>(cg);
+    state.sets_.ComputeFirstSets(cg);
+    state.sets_.ComputeFollowSets(cg);
+    state.occurrences_.assign(st.non_terminal_ids_.size(), {});
+    for (std::uint32_t p = 0; p < cg.ProductionCount(); ++p) {
+        const std::span<const SymbolId> rhs = cg.Rhs(p);
+        for (std::uint32_t i = 0; i < rhs.size(); ++i) {
+            if (!st.IsTerminal(rhs[i])) {
+                state.occurrences_[st.kind_index_[rhs[i]]].emplace_back(p, i);
+            }
+        }
+    }
+    for (std::uint32_t a = 0; a < st.non_terminal_ids_.size(); ++a) {
+        if (!IsLL1NonTerminal(state, a)) {
+            return false;
+        }
+    }
+    return true;
+}
 
-    std::uniform_int_distribution<size_t> base_terminal_dist(
-        0, base.st_.terminals_wtho_eol_.size() - 1);
-    std::vector<std::string> base_terminals(
-        base.st_.terminals_wtho_eol_.begin(),
-        base.st_.terminals_wtho_eol_.end());
-    std::string terminal_to_replace =
-        base_terminals.at(base_terminal_dist(gen));
-
-    for (auto& [nt, prods] : base.g_) {
-        for (auto& prod : prods) {
-            for (std::string& symbol : prod) {
-                if (symbol == terminal_to_replace) {
-                    symbol = new_terminal;
-                }
+bool GrammarFactory::ApplyLL1Step(ll1_construction& state, std::size_t cmb,
+                                  int level, const step_choice& choice,
+                                  ll1_undo& undo) const {
+    using Set                           = SmallTerminalSet;
+    composition&                   rules = state.rules_;
+    const CompactGrammar&          cg    = rules.rules_;
+    const SymbolTable&             st    = cg.st_;
+    FirstFollow<SmallTerminalSet>& sets  = state.sets_;
+    const SymbolId renamed  = rules.terminals_[choice.to_terminal_];
+    const SymbolId replaced = StepNonTerminal(rules, choice);
+    // A renamed terminal that merges with another one may conflict with it
+    const bool merged = renamed != choice.new_terminal_ &&
+                        std::ranges::binary_search(rules.terminals_,
+                                                   choice.new_terminal_);
+    undo.first_.clear();
+    undo.follow_.clear();
+    undo.suffix_first_.clear();
+    undo.suffix_size_ = sets.suffix_first_.size();
+
+    ApplyComposeStep(rules, cmb, level, choice, &undo.step_);
+    const SymbolId      new_nt = LevelNonTerminal(cg, level);
+    const std::uint32_t n      = st.kind_index_[new_nt];
+    undo.non_terminal_         = n;
+    if (n == sets.first_.size()) {
+        // Interned by the step
+        sets.first_.push_back(sets.MakeSet());
+        sets.follow_.push_back(sets.MakeSet());
+        sets.nullable_.push_back(false);
+        state.occurrences_.emplace_back();
+    }
+    const std::size_t nts = sets.first_.size();
+    const auto production_of = [&](std::uint32_t position) {
+        return static_cast<std::uint32_t>(
+            std::ranges::upper_bound(cg.rhs_offsets_, position) -
+            cg.rhs_offsets_.begin() - 1);
+    };
+    // The new non-terminal replaced `replaced` and is in its own productions
+    auto& occurrences = state.occurrences_[n];
+    for (const auto& [i, before] : undo.step_.symbols_) {
+        if (cg.symbols_[i] == new_nt) {
+            const std::uint32_t p = production_of(i);
+            occurrences.emplace_back(p, i - cg.rhs_offsets_[p]);
+        }
+    }
+    for (std::uint32_t p = undo.step_.productions_; p < cg.ProductionCount();
+         ++p) {
+        const std::span<const SymbolId> rhs = cg.Rhs(p);
+        for (std::uint32_t i = 0; i < rhs.size(); ++i) {
+            if (rhs[i] == new_nt) {
+                occurrences.emplace_back(p, i);
             }
         }
     }
-    base.st_.terminals_wtho_eol_.erase(terminal_to_replace);
-    base.st_.terminals_wtho_eol_.insert(new_terminal);
-    base_terminal_dist = std::uniform_int_distribution<size_t>(
-        0, base.st_.terminals_wtho_eol_.size() - 1);
-    // -----------------------------------------------------
-
-    // STEP 5 Change one random terminal -> terminal B
-    terminal_to_replace = *std::next(base.st_.terminals_wtho_eol_.begin(),
-                                     base_terminal_dist(gen));
-    for (auto& [nt, prods] : base.g_) {
-        for (auto& prod : prods) {
-            for (std::string& symbol : prod) {
-                if (symbol == terminal_to_replace) {
-                    symbol = new_nt;
-                }
+    sets.suffix_first_.resize(cg.symbols_.size() + cg.ProductionCount(),
+                              sets.MakeSet());
+
+    if (renamed == SymbolTable::EPSILON_ID_ ||
+        replaced == SymbolTable::EPSILON_ID_) {
+        // NULLABLE may change anywhere
+        for (std::uint32_t a = 0; a < nts; ++a) {
+            undo.first_.emplace_back(a, sets.first_[a]);
+            undo.follow_.emplace_back(a, sets.follow_[a]);
+        }
+        for (std::size_t i = 0; i < undo.suffix_size_; ++i) {
+            undo.suffix_first_.emplace_back(i, sets.suffix_first_[i]);
+        }
+        sets.ComputeFirstSets(cg);
+        sets.ComputeFollowSets(cg);
+        for (std::uint32_t a = 0; a < nts; ++a) {
+            if (!IsLL1NonTerminal(state, a)) {
+                return false;
             }
         }
+        return true;
     }
 
-    std::unordered_map<std::string, std::vector<production>> combined_grammar =
-        base.g_;
-    for (auto& [nt, prods] : cmb.g_) {
-        combined_grammar[nt].insert(combined_grammar[nt].end(), prods.begin(),
-                                    prods.end());
+    std::vector<bool>          checked(nts, false);
+    std::vector<std::uint32_t> check;
+    const auto mark = [](std::vector<bool>& marks,
+                         std::vector<std::uint32_t>& list, std::uint32_t a) {
+        if (!marks[a]) {
+            marks[a] = true;
+            list.push_back(a);
+        }
+    };
+
+    // Renaming a terminal maps its bit in every set
+    const std::uint32_t x = st.kind_index_[renamed];
+    const std::uint32_t t = st.kind_index_[choice.new_terminal_];
+    const std::uint32_t y = st.kind_index_[replaced];
+    const auto rename = [&](Set& set, auto& log, auto i) {
+        if (x == t || !set.Contains(x)) {
+            return false;
+        }
+        log.emplace_back(i, set);
+        set.Erase(x);
+        set.Insert(t);
+        return true;
+    };
+    for (std::uint32_t a = 0; a < nts; ++a) {
+        const bool first  = rename(sets.first_[a], undo.first_, a);
+        const bool follow = rename(sets.follow_[a], undo.follow_, a);
+        if (merged && (first || follow)) {
+            mark(checked, check, a);
+        }
+    }
+    for (std::size_t i = 0; i < undo.suffix_size_; ++i) {
+        rename(sets.suffix_first_[i], undo.suffix_first_, i);
     }
 
-    return Grammar(combined_grammar);
-}
-
-Grammar GrammarFactory::Lv4() {
-    // STEP 1 Build a random LV3 base grammar ------------------------------
-    Grammar g = Lv3();
-    g.g_.erase("S");
-    FactoryItem base(g.g_);
-
-    // STEP 2 Choose a random LV1 grammar -------------------------------
-    std::random_device                    rd;
-    std::mt19937                          gen(rd());
-    std::uniform_int_distribution<size_t> dist(0, items.size() - 1);
-    FactoryItem                           cmb    = items.at(dist(gen));
-    std::string                           new_nt = "D";
-
-    // STEP 3 Change non terminals in cmb to C ---------------------------
-    std::unordered_map<std::string, std::vector<production>>
-        cmb_updated_grammar;
-    cmb.st_.non_terminals_.emplace(new_nt);
-    for (auto& [nt, prods] : cmb.g_) {
-        for (auto& prod : prods) {
-            for (std::string& symbol : prod) {
-                if (!cmb.st_.IsTerminal(symbol)) {
-                    cmb.st_.non_terminals_.erase(symbol);
-                    symbol = new_nt;
-                }
+    // NULLABLE and FIRST of the non-terminals that could reach `y` first,
+    // the sets of the others being final
+    std::vector<bool>          first_dirty(nts, false);
+    std::vector<std::uint32_t> firsts;
+    mark(first_dirty, firsts, n);
+    for (std::uint32_t a = 0; a < nts; ++a) {
+        if (sets.first_[a].Contains(y)) {
+            mark(first_dirty, firsts, a);
+        }
+    }
+    for (std::uint32_t a : firsts) {
+        undo.first_.emplace_back(a, sets.first_[a]);
+        sets.first_[a].Clear();
+    }
+    Set temp = sets.MakeSet();
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (std::uint32_t a : firsts) {
+            for (std::uint32_t p : cg.ProductionsOf(st.non_terminal_ids_[a])) {
+                temp.Clear();
+                sets.First(cg, cg.Rhs(p), temp);
+                changed |= sets.first_[a].UnionWith(temp);
             }
         }
-        cmb_updated_grammar[new_nt] = prods;
     }
-    cmb.g_ = std::move(cmb_updated_grammar);
-    cmb.st_.non_terminals_.emplace(new_nt);
-
-    // STEP 4 Change one base terminal to another that is not in cmb
-    std::unordered_set<std::string> cmb_terminals = cmb.st_.terminals_wtho_eol_;
-    std::unordered_set<std::string> terminal_alphabet_set(
-        terminal_alphabet_.begin(), terminal_alphabet_.end());
-
-    for (const std::string& terminal : cmb_terminals) {
-        terminal_alphabet_set.erase(terminal);
+    for (std::uint32_t a : firsts) {
+        sets.nullable_[a] = sets.first_[a].Contains(sets.EPSILON_BIT_);
+        mark(checked, check, a);
     }
 
-    std::uniform_int_distribution<size_t> terminal_dist(
-        0, terminal_alphabet_set.size() - 1);
-    std::vector<std::string> remaining_terminals(terminal_alphabet_set.begin(),
-                                                 terminal_alphabet_set.end());
-    const std::string& new_terminal = remaining_terminals[terminal_dist(gen)];
+    // FIRST of the suffixes of the productions `y` left, of those with a
+    // changed FIRST, and of the new ones
+    std::vector<std::uint32_t> productions;
+    for (const auto& [p, i] : occurrences) {
+        productions.push_back(p);
+    }
+    for (std::uint32_t p = undo.step_.productions_; p < cg.ProductionCount();
+         ++p) {
+        productions.push_back(p);
+    }
+    for (std::uint32_t a : firsts) {
+        for (const auto& [p, i] : state.occurrences_[a]) {
+            productions.push_back(p);
+        }
+    }
+    std::ranges::sort(productions);
+    const auto [end, last] = std::ranges::unique(productions);
+    productions.erase(end, last);
+    std::vector<bool>          follow_dirty(nts, false);
+    std::vector<std::uint32_t> follows;
+    mark(follow_dirty, follows, n);
+    for (std::uint32_t p : productions) {
+        const std::size_t base = sets.SuffixIndex(cg, p, 0);
+        const auto        rhs  = cg.Rhs(p);
+        if (p >= undo.step_.productions_) {
+            sets.ComputeSuffixFirst(cg, p);
+            continue;
+        }
+        const std::size_t logged = undo.suffix_first_.size();
+        for (std::size_t i = 0; i < rhs.size(); ++i) {
+            undo.suffix_first_.emplace_back(base + i,
+                                            sets.suffix_first_[base + i]);
+        }
+        sets.ComputeSuffixFirst(cg, p);
+        // FOLLOW of the symbol before a changed suffix changes
+        for (std::size_t i = 0; i + 1 < rhs.size(); ++i) {
+            if (!st.IsTerminal(rhs[i]) &&
+                !(undo.suffix_first_[logged + i + 1].second ==
+                  sets.suffix_first_[base + i + 1])) {
+                mark(follow_dirty, follows, st.kind_index_[rhs[i]]);
+            }
+        }
+        if (!(undo.suffix_first_[logged].second == sets.suffix_first_[base])) {
+            mark(checked, check, st.kind_index_[cg.Lhs(p)]);
+        }
+    }
 
-    std::uniform_int_distribution<size_t> base_terminal_dist(
-        0, base.st_.terminals_wtho_eol_.size() - 1);
-    std::vector<std::string> base_terminals(
-        base.st_.terminals_wtho_eol_.begin(),
-        base.st_.terminals_wtho_eol_.end());
-    std::string terminal_to_replace =
-        base_terminals.at(base_terminal_dist(gen));
-
-    for (auto& [nt, prods] : base.g_) {
-        for (auto& prod : prods) {
-            for (std::string& symbol : prod) {
-                if (symbol == terminal_to_replace) {
-                    symbol = new_terminal;
+    // FOLLOW flows to the nullable ends of the productions of a changed
+    // FOLLOW
+    for (std::size_t k = 0; k < follows.size(); ++k) {
+        const std::uint32_t a = follows[k];
+        for (std::uint32_t p : cg.ProductionsOf(st.non_terminal_ids_[a])) {
+            const auto rhs = cg.Rhs(p);
+            for (std::size_t i = 0; i < rhs.size(); ++i) {
+                if (!st.IsTerminal(rhs[i]) &&
+                    sets.SuffixFirst(cg, p, i + 1).Contains(
+                        sets.EPSILON_BIT_)) {
+                    mark(follow_dirty, follows, st.kind_index_[rhs[i]]);
                 }
             }
         }
     }
-    base.st_.terminals_wtho_eol_.erase(terminal_to_replace);
-    base.st_.terminals_wtho_eol_.insert(new_terminal);
-    base_terminal_dist = std::uniform_int_distribution<size_t>(
-        0, base.st_.terminals_wtho_eol_.size() - 1);
-    // -----------------------------------------------------
-
-    // STEP 5 Change one random terminal -> terminal B
-    terminal_to_replace = *std::next(base.st_.terminals_wtho_eol_.begin(),
-                                     base_terminal_dist(gen));
-    for (auto& [nt, prods] : base.g_) {
-        for (auto& prod : prods) {
-            for (std::string& symbol : prod) {
-                if (symbol == terminal_to_replace) {
-                    symbol = new_nt;
+    for (std::uint32_t a : follows) {
+        undo.follow_.emplace_back(a, sets.follow_[a]);
+        sets.follow_[a].Clear();
+        if (st.non_terminal_ids_[a] == cg.axiom_) {
+            sets.follow_[a].Insert(sets.EOL_BIT_);
+        }
+    }
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (std::uint32_t a : follows) {
+            for (const auto& [p, i] : state.occurrences_[a]) {
+                const Set& rest = sets.SuffixFirst(cg, p, i + 1);
+                changed |= sets.follow_[a].UnionWith(rest, sets.EPSILON_BIT_);
+                if (rest.Contains(sets.EPSILON_BIT_)) {
+                    changed |= sets.follow_[a].UnionWith(
+                        sets.follow_[st.kind_index_[cg.Lhs(p)]]);
                 }
             }
         }
     }
 
-    std::unordered_map<std::string, std::vector<production>> combined_grammar =
-        base.g_;
-    for (auto& [nt, prods] : cmb.g_) {
-        combined_grammar[nt].insert(combined_grammar[nt].end(), prods.begin(),
-                                    prods.end());
+    // Prediction sets of the productions of every changed non-terminal
+    for (std::uint32_t a : follows) {
+        mark(checked, check, a);
     }
-
-    return Grammar(combined_grammar);
+    return std::ranges::all_of(
+        check, [&](std::uint32_t a) { return IsLL1NonTerminal(state, a); });
 }
 
-Grammar GrammarFactory::Lv5() {
-    // STEP 1 Build a random LV3 base grammar ------------------------------
-    Grammar g = Lv4();
-    g.g_.erase("S");
-    FactoryItem base(g.g_);
-
-    // STEP 2 Choose a random LV1 grammar -------------------------------
-    std::random_device                    rd;
-    std::mt19937                          gen(rd());
-    std::uniform_int_distribution<size_t> dist(0, items.size() - 1);
-    FactoryItem                           cmb    = items.at(dist(gen));
-    std::string                           new_nt = "E";
+void GrammarFactory::UndoLL1Step(ll1_construction& state,
+                                 const ll1_undo&   undo) const {
+    FirstFollow<SmallTerminalSet>& sets = state.sets_;
+    for (auto it = undo.suffix_first_.rbegin();
+         it != undo.suffix_first_.rend(); ++it) {
+        sets.suffix_first_[it->first] = it->second;
+    }
+    sets.suffix_first_.resize(undo.suffix_size_);
+    for (auto it = undo.follow_.rbegin(); it != undo.follow_.rend(); ++it) {
+        sets.follow_[it->first] = it->second;
+    }
+    for (auto it = undo.first_.rbegin(); it != undo.first_.rend(); ++it) {
+        sets.first_[it->first] = it->second;
+        sets.nullable_[it->first] =
+            it->second.Contains(sets.EPSILON_BIT_);
+    }
+    state.occurrences_[undo.non_terminal_].clear();
+    UndoComposeStep(state.rules_, undo.step_);
+}
 
-    // STEP 3 Change non terminals in cmb to C ---------------------------
-    std::unordered_map<std::string, std::vector<production>>
-        cmb_updated_grammar;
-    cmb.st_.non_terminals_.emplace(new_nt);
-    for (auto& [nt, prods] : cmb.g_) {
-        for (auto& prod : prods) {
-            for (std::string& symbol : prod) {
-                if (!cmb.st_.IsTerminal(symbol)) {
-                    cmb.st_.non_terminals_.erase(symbol);
-                    symbol = new_nt;
-                }
-            }
+bool GrammarFactory::IsLL1NonTerminal(const ll1_construction& state,
+                                      std::uint32_t           a) const {
+    const CompactGrammar&                cg   = state.rules_.rules_;
+    const FirstFollow<SmallTerminalSet>& sets = state.sets_;
+    SmallTerminalSet                     seen;
+    for (std::uint32_t p : cg.ProductionsOf(cg.st_.non_terminal_ids_[a])) {
+        SmallTerminalSet predict = sets.SuffixFirst(cg, p, 0);
+        if (predict.Contains(sets.EPSILON_BIT_)) {
+            predict.Erase(sets.EPSILON_BIT_);
+            predict.UnionWith(sets.follow_[a]);
+        }
+        if (seen.Intersects(predict)) {
+            return false;
         }
-        cmb_updated_grammar[new_nt] = prods;
+        seen.UnionWith(predict);
     }
-    cmb.g_ = std::move(cmb_updated_grammar);
-    cmb.st_.non_terminals_.emplace(new_nt);
-
-    // STEP 4 Change one base terminal to another that is not in cmb
-    std::unordered_set<std::string> cmb_terminals = cmb.st_.terminals_wtho_eol_;
-    std::unordered_set<std::string> terminal_alphabet_set(
-        terminal_alphabet_.begin(), terminal_alphabet_.end());
+    return true;
+}
 
-    for (const std::string& terminal : cmb_terminals) {
-        terminal_alphabet_set.erase(terminal);
+Grammar GrammarFactory::GenSLR1Grammar(int level) {
+    if (const grammar_index* index = IndexOf(level);
+        index != nullptr && !index->slr1_.empty()) {
+        return DrawIndexed(*index, SLR1_GRAMMAR);
     }
+    return TryGenSLR1Grammar(level, {}).grammar_;
+}
 
-    std::uniform_int_distribution<size_t> terminal_dist(
-        0, terminal_alphabet_set.size() - 1);
-    std::vector<std::string> remaining_terminals(terminal_alphabet_set.begin(),
-                                                 terminal_alphabet_set.end());
-    const std::string& new_terminal = remaining_terminals[terminal_dist(gen)];
-
-    std::uniform_int_distribution<size_t> base_terminal_dist(
-        0, base.st_.terminals_wtho_eol_.size() - 1);
-    std::vector<std::string> base_terminals(
-        base.st_.terminals_wtho_eol_.begin(),
-        base.st_.terminals_wtho_eol_.end());
-    std::string terminal_to_replace =
-        base_terminals.at(base_terminal_dist(gen));
-
-    for (auto& [nt, prods] : base.g_) {
-        for (auto& prod : prods) {
-            for (std::string& symbol : prod) {
-                if (symbol == terminal_to_replace) {
-                    symbol = new_terminal;
-                }
+GrammarFactory::generation_result
+GrammarFactory::TryGenSLR1Grammar(int level, const generation_limits& limits) {
+    const grammar_index* index = IndexOf(level);
+    if (index != nullptr && index->slr1_.empty()) {
+        index = nullptr;
+    }
+    if (index == nullptr && level > 1 && catalog_->lv2_slr1_.Size() == 0) {
+        generation_result result;
+        result.status_ = OUT_OF_ATTEMPTS;
+        return result;
+    }
+    composition rules;
+    const auto  attempt = [&](Grammar& gr) -> std::optional<rejection_reason> {
+        if (index != nullptr) {
+            gr = DrawIndexed(*index, SLR1_GRAMMAR);
+            return std::nullopt;
+        }
+        // One start per attempt, so that the limits see every restart
+        const bool failed = Timed(
+            DRAW_STAGE, [&] { return !ComposeSLR1(level, rules, 1); });
+        gr = rules.ToGrammar();
+        if (failed) {
+            return REJECTED_CONFLICT;
+        }
+        if (!verdict_cache_) {
+            rejection_reason reason;
+            if (!IsAcceptedSLR1(gr, reason)) {
+                return reason;
             }
+            return std::nullopt;
         }
+        const grammar_verdicts v = Verdicts(gr, false, true);
+        if (v.slr1_ != 1) {
+            return RejectionOf(v);
+        }
+        return std::nullopt;
+    };
+    return Generate(limits, attempt);
+}
+
+Grammar GrammarFactory::DrawIndexed(const grammar_index& index,
+                                    grammar_class        type) {
+    const std::vector<std::uint32_t>& accepted =
+        type == LL1_GRAMMAR ? index.ll1_ : index.slr1_;
+    std::uniform_int_distribution<size_t> dist(0, accepted.size() - 1);
+    const catalog_entry& entry = index.grammars_[accepted[dist(rng_)]];
+
+    // The grammars of the index use the first terminals: a random bijection
+    // onto the alphabet draws every renaming of the class alike
+    const std::vector<SymbolId>& alphabet = catalog_->terminal_ids_;
+    std::vector<SymbolId>        shuffled = alphabet;
+    std::ranges::shuffle(shuffled, rng_);
+    composition           rules = entry.rules_;
+    std::vector<SymbolId> renamed(rules.rules_.st_.Size());
+    std::iota(renamed.begin(), renamed.end(), SymbolId{0});
+    for (std::size_t k = 0; k < alphabet.size(); ++k) {
+        renamed[alphabet[k]] = shuffled[k];
     }
-    base.st_.terminals_wtho_eol_.erase(terminal_to_replace);
-    base.st_.terminals_wtho_eol_.insert(new_terminal);
-    base_terminal_dist = std::uniform_int_distribution<size_t>(
-        0, base.st_.terminals_wtho_eol_.size() - 1);
-    // -----------------------------------------------------
-
-    // STEP 5 Change one random terminal -> terminal B
-    terminal_to_replace = *std::next(base.st_.terminals_wtho_eol_.begin(),
-                                     base_terminal_dist(gen));
-    for (auto& [nt, prods] : base.g_) {
-        for (auto& prod : prods) {
-            for (std::string& symbol : prod) {
-                if (symbol == terminal_to_replace) {
-                    symbol = new_nt;
-                }
-            }
+    ApplyRenaming(rules, renamed);
+    Grammar gr = rules.ToGrammar();
+    if (type == LL1_GRAMMAR) {
+        ApplyLL1Fix(gr, entry.ll1_);
+    }
+    return gr;
+}
+
+GrammarFactory::generation_result GrammarFactory::Generate(
+    const generation_limits& limits,
+    const std::function<std::optional<rejection_reason>(Grammar&)>& attempt) {
+    generation_result               result;
+    Grammar                         gr;
+    std::optional<rejection_reason> best;
+    const bool                      timed =
+        limits.deadline_ != std::chrono::steady_clock::time_point::max();
+    while (true) {
+        if (limits.stop_.stop_requested()) {
+            result.status_ = CANCELLED;
+            return result;
+        }
+        if (limits.max_attempts_ != 0 &&
+            result.attempts_ >= limits.max_attempts_) {
+            result.status_ = OUT_OF_ATTEMPTS;
+            return result;
+        }
+        if (timed && std::chrono::steady_clock::now() >= limits.deadline_) {
+            result.status_ = TIMED_OUT;
+            return result;
+        }
+        ++result.attempts_;
+        ++stats_.attempts_;
+        const std::optional<rejection_reason> reason = attempt(gr);
+        if (!reason) {
+            ++stats_.generated_;
+            result.grammar_ = std::move(gr);
+            result.status_  = GENERATED;
+            return result;
+        }
+        ++result.rejections_[*reason];
+        ++stats_.rejections_[*reason];
+        // A later reason passed more sanity checks: the grammar got further
+        if (!best || *reason > *best) {
+            best            = reason;
+            result.grammar_ = std::move(gr);
         }
     }
+}
 
-    std::unordered_map<std::string, std::vector<production>> combined_grammar =
-        base.g_;
-    for (auto& [nt, prods] : cmb.g_) {
-        combined_grammar[nt].insert(combined_grammar[nt].end(), prods.begin(),
-                                    prods.end());
+GrammarFactory::ll1_fix GrammarFactory::MakeLL1(Grammar& gr) {
+    rejection_reason reason;
+    return MakeLL1(gr, reason);
+}
+
+GrammarFactory::ll1_fix GrammarFactory::MakeLL1(Grammar&          gr,
+                                                rejection_reason& reason) {
+    std::shared_ptr<const GrammarAnalysis> analysis;
+    check_results                          results;
+    ll1_fix                                fix = AS_IS;
+    if (!RunChecks(ll1_checks_, gr, analysis, results)) {
+        // Before FixLL1, which transforms the grammar
+        reason = Rejection(gr, analysis, results);
+        fix    = FixLL1(gr);
     }
+    ++stats_.ll1_fixes_[fix];
+    return fix;
+}
 
-    return Grammar(combined_grammar);
+GrammarFactory::ll1_fix GrammarFactory::FixLL1(Grammar& gr) {
+    if (!Timed(REMOVE_LEFT_RECURSION_STAGE, [&] {
+            RemoveLeftRecursion(gr);
+            return !LL1Parser(gr).IsLL1();
+        })) {
+        return REMOVE_LEFT_RECURSION;
+    }
+    if (!Timed(LEFT_FACTORIZE_STAGE, [&] {
+            LeftFactorize(gr);
+            return !LL1Parser(gr).IsLL1();
+        })) {
+        return LEFT_FACTORIZE;
+    }
+    return NOT_LL1;
 }
 
-Grammar GrammarFactory::Lv6() {
-    // STEP 1 Build a random LV3 base grammar ------------------------------
-    Grammar g = Lv5();
-    g.g_.erase("S");
-    FactoryItem base(g.g_);
+bool GrammarFactory::IsLL1AsIs(Grammar& gr) {
+    auto analysis = std::make_shared<const GrammarAnalysis>(gr);
+    return !IsInfinite(*analysis) && !HasUnreachableSymbols(*analysis) &&
+           !HasDirectLeftRecursion(gr) && LL1Parser(analysis).IsLL1();
+}
 
-    // STEP 2 Choose a random LV1 grammar -------------------------------
-    std::random_device                    rd;
-    std::mt19937                          gen(rd());
-    std::uniform_int_distribution<size_t> dist(0, items.size() - 1);
-    FactoryItem                           cmb    = items.at(dist(gen));
-    std::string                           new_nt = "F";
+void GrammarFactory::ApplyLL1Fix(Grammar& gr, ll1_fix fix) {
+    if (fix == REMOVE_LEFT_RECURSION || fix == LEFT_FACTORIZE) {
+        RemoveLeftRecursion(gr);
+    }
+    if (fix == LEFT_FACTORIZE) {
+        LeftFactorize(gr);
+    }
+}
 
-    // STEP 3 Change non terminals in cmb to C ---------------------------
-    std::unordered_map<std::string, std::vector<production>>
-        cmb_updated_grammar;
-    cmb.st_.non_terminals_.emplace(new_nt);
-    for (auto& [nt, prods] : cmb.g_) {
-        for (auto& prod : prods) {
-            for (std::string& symbol : prod) {
-                if (!cmb.st_.IsTerminal(symbol)) {
-                    cmb.st_.non_terminals_.erase(symbol);
-                    symbol = new_nt;
-                }
-            }
+bool GrammarFactory::IsAcceptedSLR1(const Grammar& gr) {
+    rejection_reason reason;
+    return IsAcceptedSLR1(gr, reason);
+}
+
+bool GrammarFactory::IsAcceptedSLR1(const Grammar&    gr,
+                                    rejection_reason& reason) {
+    std::shared_ptr<const GrammarAnalysis> analysis;
+    check_results                          results;
+    if (RunChecks(slr1_checks_, gr, analysis, results)) {
+        return true;
+    }
+    reason = Rejection(gr, analysis, results);
+    return false;
+}
+
+bool GrammarFactory::RunChecks(
+    CheckOrder& order, const Grammar& gr,
+    std::shared_ptr<const GrammarAnalysis>& analysis, check_results& results) {
+    bool passed = true;
+    for (std::uint8_t check : order.Order()) {
+        if (RunCheck(static_cast<check_stage>(check), &order, gr, analysis,
+                     results)) {
+            passed = false;
+            break;
         }
-        cmb_updated_grammar[new_nt] = prods;
     }
-    cmb.g_ = std::move(cmb_updated_grammar);
-    cmb.st_.non_terminals_.emplace(new_nt);
+    order.FinishCandidate();
+    return passed;
+}
 
-    // STEP 4 Change one base terminal to another that is not in cmb
-    std::unordered_set<std::string> cmb_terminals = cmb.st_.terminals_wtho_eol_;
-    std::unordered_set<std::string> terminal_alphabet_set(
-        terminal_alphabet_.begin(), terminal_alphabet_.end());
+bool GrammarFactory::RunCheck(check_stage stage, CheckOrder* order,
+                              const Grammar&                          gr,
+                              std::shared_ptr<const GrammarAnalysis>& analysis,
+                              check_results&                          results) {
+    // Only HasDirectLeftRecursion reads the grammar itself
+    if (stage != LEFT_RECURSION_STAGE && !analysis) {
+        analysis = Analyse(gr);
+    }
+    const bool rejected = Timed(stage, order, [&] {
+        switch (stage) {
+        case LEFT_RECURSION_STAGE:
+            return HasDirectLeftRecursion(gr);
+        case INFINITE_STAGE:
+            return IsInfinite(*analysis);
+        case UNREACHABLE_STAGE:
+            return HasUnreachableSymbols(*analysis);
+        case LL1_TABLE_STAGE:
+            return !LL1Parser(analysis).IsLL1();
+        default:
+            return !SLR1Parser(analysis).MakeParser();
+        }
+    });
+    results.ran_ |= 1u << stage;
+    if (rejected) {
+        results.rejected_ |= 1u << stage;
+    }
+    return rejected;
+}
 
-    for (const std::string& terminal : cmb_terminals) {
-        terminal_alphabet_set.erase(terminal);
+GrammarFactory::rejection_reason
+GrammarFactory::Rejection(const Grammar&                          gr,
+                          std::shared_ptr<const GrammarAnalysis>& analysis,
+                          check_results&                          results) {
+    for (const auto& [stage, reason] :
+         {std::pair{INFINITE_STAGE, REJECTED_INFINITE},
+          std::pair{UNREACHABLE_STAGE, REJECTED_UNREACHABLE}}) {
+        const bool rejected = (results.ran_ & (1u << stage)) != 0
+                                  ? (results.rejected_ & (1u << stage)) != 0
+                                  : RunCheck(stage, nullptr, gr, analysis,
+                                             results);
+        if (rejected) {
+            return reason;
+        }
     }
+    return REJECTED_CONFLICT;
+}
 
-    std::uniform_int_distribution<size_t> terminal_dist(
-        0, terminal_alphabet_set.size() - 1);
-    std::vector<std::string> remaining_terminals(terminal_alphabet_set.begin(),
-                                                 terminal_alphabet_set.end());
-    const std::string& new_terminal = remaining_terminals[terminal_dist(gen)];
+std::shared_ptr<const GrammarAnalysis>
+GrammarFactory::Analyse(const Grammar& gr) {
+    std::shared_ptr<const GrammarAnalysis> analysis;
+    Timed(ANALYSIS_STAGE, [&] {
+        analysis = std::make_shared<const GrammarAnalysis>(gr);
+        return false;
+    });
+    return analysis;
+}
 
-    std::uniform_int_distribution<size_t> base_terminal_dist(
-        0, base.st_.terminals_wtho_eol_.size() - 1);
-    std::vector<std::string> base_terminals(
-        base.st_.terminals_wtho_eol_.begin(),
-        base.st_.terminals_wtho_eol_.end());
-    std::string terminal_to_replace =
-        base_terminals.at(base_terminal_dist(gen));
-
-    for (auto& [nt, prods] : base.g_) {
-        for (auto& prod : prods) {
-            for (std::string& symbol : prod) {
-                if (symbol == terminal_to_replace) {
-                    symbol = new_terminal;
-                }
-            }
+grammar_verdicts GrammarFactory::Verdicts(const Grammar& gr, bool ll1,
+                                          bool slr1) {
+    const grammar_fingerprint              fp = Fingerprint(gr);
+    std::shared_ptr<const GrammarAnalysis> analysis;
+    grammar_verdicts                       v;
+    if (std::optional<grammar_verdicts> cached = verdict_cache_->Find(fp)) {
+        v = *cached;
+        if ((!ll1 || v.ll1_ != grammar_verdicts::UNKNOWN_) &&
+            (!slr1 || v.slr1_ != grammar_verdicts::UNKNOWN_)) {
+            return v;
         }
+    } else {
+        analysis          = Analyse(gr);
+        v.infinite_       = Timed(INFINITE_STAGE,
+                                  [&] { return IsInfinite(*analysis); });
+        v.unreachable_    = Timed(UNREACHABLE_STAGE, [&] {
+            return HasUnreachableSymbols(*analysis);
+        });
+        v.left_recursive_ = Timed(LEFT_RECURSION_STAGE,
+                                  [&] { return HasDirectLeftRecursion(gr); });
     }
-    base.st_.terminals_wtho_eol_.erase(terminal_to_replace);
-    base.st_.terminals_wtho_eol_.insert(new_terminal);
-    base_terminal_dist = std::uniform_int_distribution<size_t>(
-        0, base.st_.terminals_wtho_eol_.size() - 1);
-    // -----------------------------------------------------
-
-    // STEP 5 Change one random terminal -> terminal B
-    terminal_to_replace = *std::next(base.st_.terminals_wtho_eol_.begin(),
-                                     base_terminal_dist(gen));
-    for (auto& [nt, prods] : base.g_) {
-        for (auto& prod : prods) {
-            for (std::string& symbol : prod) {
-                if (symbol == terminal_to_replace) {
-                    symbol = new_nt;
-                }
-            }
+    if (!analysis) {
+        analysis = Analyse(gr);
+    }
+    const bool sane = !v.infinite_ && !v.unreachable_;
+    if (ll1 && v.ll1_ == grammar_verdicts::UNKNOWN_) {
+        // MakeLL1, sharing the analysis of the sanity checks
+        if (sane && !v.left_recursive_ &&
+            !Timed(LL1_TABLE_STAGE,
+                   [&] { return !LL1Parser(analysis).IsLL1(); })) {
+            v.ll1_ = AS_IS;
+        } else {
+            Grammar copy = gr;
+            v.ll1_       = FixLL1(copy);
         }
+        ++stats_.ll1_fixes_[v.ll1_];
     }
+    if (slr1 && v.slr1_ == grammar_verdicts::UNKNOWN_) {
+        v.slr1_ = sane && !Timed(SLR1_AUTOMATON_STAGE, [&] {
+            return !SLR1Parser(analysis).MakeParser();
+        });
+    }
+    verdict_cache_->Store(fp, v);
+    return v;
+}
+
+Grammar GrammarFactory::PickOne(int level, std::uint64_t index) {
+    rng_.Seed(seed_, index);
+    return PickOne(level);
+}
+
+Grammar GrammarFactory::GenLL1Grammar(int level, std::uint64_t index) {
+    rng_.Seed(seed_, index);
+    return GenLL1Grammar(level);
+}
+
+Grammar GrammarFactory::GenSLR1Grammar(int level, std::uint64_t index) {
+    rng_.Seed(seed_, index);
+    return GenSLR1Grammar(level);
+}
+
+GrammarFactory::generation_result
+GrammarFactory::TryGenLL1Grammar(int level, std::uint64_t index,
+                                 const generation_limits& limits) {
+    rng_.Seed(seed_, index);
+    return TryGenLL1Grammar(level, limits);
+}
+
+GrammarFactory::generation_result
+GrammarFactory::TryGenSLR1Grammar(int level, std::uint64_t index,
+                                  const generation_limits& limits) {
+    rng_.Seed(seed_, index);
+    return TryGenSLR1Grammar(level, limits);
+}
+
+void GrammarFactory::Seed(std::uint64_t seed) {
+    seed_ = seed;
+    rng_.Seed(seed);
+}
+
+void GrammarFactory::SanityChecks(Grammar& gr) {
+    const GrammarAnalysis analysis(gr);
+    std::cout << "Sanity check (Is Infinite?) : " << IsInfinite(analysis)
+              << "\n";
+    std::cout << "Sanity check (Has Unreachable Symbols?) : "
+              << HasUnreachableSymbols(analysis) << "\n";
+    std::cout << "Sanity check (Has Direct Left Recursion?) : "
+              << HasDirectLeftRecursion(gr) << "\n";
+}
+
+Grammar GrammarFactory::Lv1() {
+    std::uniform_int_distribution<size_t> dist(0, catalog_->items.size() - 1);
+    return Grammar(catalog_->items.at(dist(rng_)).g_);
+}
 
-    std::unordered_map<std::string, std::vector<production>> combined_grammar =
-        base.g_;
-    for (auto& [nt, prods] : cmb.g_) {
-        combined_grammar[nt].insert(combined_grammar[nt].end(), prods.begin(),
-                                    prods.end());
+Grammar GrammarFactory::LvN(int level) {
+    return Compose(level).ToGrammar();
+}
+
+GrammarFactory::composition GrammarFactory::Compose(int level) {
+    if (level <= 1) {
+        std::uniform_int_distribution<size_t> dist(0,
+                                                   catalog_->items.size() - 1);
+        return ItemComposition(dist(rng_));
     }
 
-    return Grammar(combined_grammar);
+    composition result = DrawLv2().rules_;
+    for (int l = 3; l <= level; ++l) {
+        std::uniform_int_distribution<size_t> dist(0,
+                                                   catalog_->items.size() - 1);
+        ComposeStep(result, dist(rng_), l);
+    }
+    return result;
 }
 
-Grammar GrammarFactory::Lv7() {
-    Grammar g = Lv6();
-    g.g_.erase("S");
-    FactoryItem base(g.g_);
+const GrammarFactory::catalog_entry& GrammarFactory::DrawLv2() {
+    return catalog_->lv2_catalog_[catalog_->lv2_any_.Sample(rng_)];
+}
 
-    // STEP 2 Choose a random LV1 grammar -------------------------------
-    std::random_device                    rd;
-    std::mt19937                          gen(rd());
-    std::uniform_int_distribution<size_t> dist(0, items.size() - 1);
-    FactoryItem                           cmb    = items.at(dist(gen));
-    std::string                           new_nt = "G";
+bool GrammarFactory::ComposeSLR1(int level, composition& rules,
+                                 int restarts) {
+    if (level <= 1) {
+        rules = Compose(level);
+        return true;
+    }
+    if (catalog_->lv2_slr1_.Size() == 0) {
+        return false;
+    }
+    for (int restart = 0; restart < restarts; ++restart) {
+        rules = catalog_->lv2_catalog_[catalog_->lv2_slr1_.Sample(rng_)].rules_;
+        int l = 3;
+        while (l <= level && ComposeSLR1Step(rules, l)) {
+            ++l;
+        }
+        if (l > level) {
+            return true;
+        }
+    }
+    return false;
+}
 
-    // STEP 3 Change non terminals in cmb to C ---------------------------
-    std::unordered_map<std::string, std::vector<production>>
-        cmb_updated_grammar;
-    cmb.st_.non_terminals_.emplace(new_nt);
-    for (auto& [nt, prods] : cmb.g_) {
-        for (auto& prod : prods) {
-            for (std::string& symbol : prod) {
-                if (!cmb.st_.IsTerminal(symbol)) {
-                    cmb.st_.non_terminals_.erase(symbol);
-                    symbol = new_nt;
+bool GrammarFactory::ComposeSLR1Step(composition& base, int level) {
+    std::uniform_int_distribution<size_t> dist(0, catalog_->items.size() - 1);
+    for (int attempt = 0; attempt < MAX_STEP_ATTEMPTS_; ++attempt) {
+        const std::size_t cmb    = dist(rng_);
+        const step_choice choice = DrawStepChoice(base, cmb);
+        if (IsSLR1Compatible(base, cmb, choice)) {
+            ApplyComposeStep(base, cmb, level, choice);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool GrammarFactory::IsSLR1Compatible(const composition& base,
+                                      std::size_t        cmb,
+                                      const step_choice& choice) const {
+    const SymbolId        renamed  = base.terminals_[choice.to_terminal_];
+    const SymbolId        replaced = StepNonTerminal(base, choice);
+    const CompactGrammar& rules    = base.rules_;
+    for (std::size_t l = 1; l <= base.items_.size(); ++l) {
+        const std::size_t     item = base.items_[l - 1];
+        const CompactGrammar& item_rules =
+            catalog_->item_rules_[item].rules_;
+        // The productions of the level line up with those of its item
+        std::uint32_t item_p =
+            *item_rules.ProductionsOf(LevelNonTerminal(item_rules, 1)).begin();
+        for (std::uint32_t p :
+             rules.ProductionsOf(LevelNonTerminal(rules, l))) {
+            const std::span<const SymbolId> rhs      = rules.Rhs(p);
+            const std::span<const SymbolId> item_rhs = item_rules.Rhs(item_p++);
+            for (std::size_t q = 0; q < rhs.size(); ++q) {
+                const SymbolId symbol =
+                    rhs[q] == renamed ? choice.new_terminal_ : rhs[q];
+                if (symbol == replaced &&
+                    !catalog_->slr1_compatible_[item].at(item_rhs[q])[cmb]) {
+                    return false;
                 }
             }
         }
-        cmb_updated_grammar[new_nt] = prods;
     }
-    cmb.g_ = std::move(cmb_updated_grammar);
-    cmb.st_.non_terminals_.emplace(new_nt);
+    return true;
+}
 
-    // STEP 4 Change one base terminal to another that is not in cmb
-    std::unordered_set<std::string> cmb_terminals = cmb.st_.terminals_wtho_eol_;
-    std::unordered_set<std::string> terminal_alphabet_set(
-        terminal_alphabet_.begin(), terminal_alphabet_.end());
+void GrammarFactory::BuildSLR1Compatibility(catalog& cat) {
+    std::map<std::vector<std::uint32_t>, bool> slr1;
+    for (const catalog_entry& entry : cat.lv2_catalog_) {
+        slr1.emplace(RulesKey(entry.rules_.rules_), entry.slr1_);
+    }
 
-    for (const std::string& terminal : cmb_terminals) {
-        terminal_alphabet_set.erase(terminal);
+    cat.slr1_compatible_.assign(cat.items.size(), {});
+    step_undo undo;
+    for (std::size_t first = 0; first < cat.items.size(); ++first) {
+        composition base = ItemComposition(first);
+        for (SymbolId t : base.terminals_) {
+            cat.slr1_compatible_[first][t].assign(cat.items.size(), false);
+        }
+        for (std::size_t cmb = 0; cmb < cat.items.size(); ++cmb) {
+            ForEachStepChoice(base, cmb, [&](const step_choice& choice,
+                                             std::uint64_t) {
+                // Item terminals that the step turns into the new
+                // non-terminal
+                const SymbolId renamed  = base.terminals_[choice.to_terminal_];
+                const SymbolId replaced = StepNonTerminal(base, choice);
+                ApplyComposeStep(base, cmb, 2, choice, &undo);
+                auto [it, inserted] =
+                    slr1.try_emplace(RulesKey(base.rules_), false);
+                if (inserted) {
+                    it->second = IsAcceptedSLR1(base.ToGrammar());
+                }
+                UndoComposeStep(base, undo);
+                if (!it->second) {
+                    return;
+                }
+                for (SymbolId t : base.terminals_) {
+                    if ((t == renamed ? choice.new_terminal_ : t) == replaced) {
+                        cat.slr1_compatible_[first][t][cmb] = true;
+                    }
+                }
+            });
+        }
     }
+}
 
-    std::uniform_int_distribution<size_t> terminal_dist(
-        0, terminal_alphabet_set.size() - 1);
-    std::vector<std::string> remaining_terminals(terminal_alphabet_set.begin(),
-                                                 terminal_alphabet_set.end());
-    const std::string& new_terminal = remaining_terminals[terminal_dist(gen)];
+GrammarFactory::composition
+GrammarFactory::ItemComposition(std::size_t item) const {
+    return catalog_->item_rules_.at(item);
+}
 
-    std::uniform_int_distribution<size_t> base_terminal_dist(
-        0, base.st_.terminals_wtho_eol_.size() - 1);
-    std::vector<std::string> base_terminals(
-        base.st_.terminals_wtho_eol_.begin(),
-        base.st_.terminals_wtho_eol_.end());
-    std::string terminal_to_replace =
-        base_terminals.at(base_terminal_dist(gen));
-
-    for (auto& [nt, prods] : base.g_) {
-        for (auto& prod : prods) {
-            for (std::string& symbol : prod) {
-                if (symbol == terminal_to_replace) {
-                    symbol = new_terminal;
-                }
+GrammarFactory::composition GrammarFactory::Composition(
+    const std::unordered_map<std::string, std::vector<production>>& rules)
+    const {
+    composition     result;
+    CompactGrammar& cg = result.rules_;
+    cg.st_             = catalog_->symbols_;
+    for (const auto& [nt, prods] : rules) {
+        cg.st_.Intern(nt, NO_TERMINAL);
+        for (const production& prod : prods) {
+            for (const std::string& symbol : prod) {
+                cg.st_.Intern(symbol, symbol == cg.st_.EPSILON_ ||
+                                              std::islower(symbol[0])
+                                          ? TERMINAL
+                                          : NO_TERMINAL);
             }
         }
     }
-    base.st_.terminals_wtho_eol_.erase(terminal_to_replace);
-    base.st_.terminals_wtho_eol_.insert(new_terminal);
-    base_terminal_dist = std::uniform_int_distribution<size_t>(
-        0, base.st_.terminals_wtho_eol_.size() - 1);
-    // -----------------------------------------------------
-
-    // STEP 5 Change one random terminal -> terminal B
-    terminal_to_replace = *std::next(base.st_.terminals_wtho_eol_.begin(),
-                                     base_terminal_dist(gen));
-    for (auto& [nt, prods] : base.g_) {
-        for (auto& prod : prods) {
-            for (std::string& symbol : prod) {
-                if (symbol == terminal_to_replace) {
-                    symbol = new_nt;
+    cg.axiom_ = cg.st_.Id("S");
+
+    // Productions grouped by non-terminal, in the order of the table
+    for (SymbolId nt : cg.st_.non_terminal_ids_) {
+        if (nt == cg.axiom_) {
+            cg.symbols_.push_back(LevelNonTerminal(cg, 1));
+            cg.symbols_.push_back(SymbolTable::EOL_ID_);
+            cg.rhs_offsets_.push_back(
+                static_cast<std::uint32_t>(cg.symbols_.size()));
+            cg.lhs_.push_back(nt);
+        } else if (auto it = rules.find(cg.st_.Name(nt)); it != rules.end()) {
+            for (const production& prod : it->second) {
+                for (const std::string& symbol : prod) {
+                    cg.symbols_.push_back(cg.st_.Id(symbol));
                 }
+                cg.rhs_offsets_.push_back(
+                    static_cast<std::uint32_t>(cg.symbols_.size()));
+                cg.lhs_.push_back(nt);
             }
         }
+        cg.nt_offsets_.push_back(cg.ProductionCount());
+    }
+    for (SymbolId symbol : cg.symbols_) {
+        if (symbol != SymbolTable::EOL_ID_ && cg.st_.IsTerminal(symbol)) {
+            result.terminals_.push_back(symbol);
+        }
+    }
+    std::ranges::sort(result.terminals_);
+    const auto [end, last] = std::ranges::unique(result.terminals_);
+    result.terminals_.erase(end, last);
+    return result;
+}
+
+void GrammarFactory::ComposeStep(composition& base, std::size_t cmb,
+                                 int level) {
+    ApplyComposeStep(base, cmb, level, DrawStepChoice(base, cmb));
+}
+
+GrammarFactory::step_choice
+GrammarFactory::DrawStepChoice(const composition& base, std::size_t cmb) {
+    const std::vector<SymbolId>& cmb_terminals =
+        catalog_->item_rules_.at(cmb).terminals_;
+    const std::vector<SymbolId>& terminals = base.terminals_;
+
+    // STEP 1 Choose a terminal that is not in cmb -----------------------
+    const auto fresh = [&](SymbolId t) {
+        return !std::ranges::binary_search(cmb_terminals, t);
+    };
+    std::uniform_int_distribution<size_t> terminal_dist(
+        0, std::ranges::count_if(catalog_->terminal_ids_, fresh) - 1);
+    std::size_t    skip         = terminal_dist(rng_);
+    const SymbolId new_terminal = *std::ranges::find_if(
+        catalog_->terminal_ids_,
+        [&](SymbolId t) { return fresh(t) && skip-- == 0; });
+
+    // STEP 2 Choose the base terminal it replaces -----------------------
+    std::uniform_int_distribution<size_t> base_terminal_dist(
+        0, terminals.size() - 1);
+    const std::size_t to_terminal = base_terminal_dist(rng_);
+
+    // STEP 3 Choose the terminal that becomes the new non-terminal, among
+    // the terminals left after the first replacement
+    const bool merged = terminals[to_terminal] != new_terminal &&
+                        std::ranges::binary_search(terminals, new_terminal);
+    base_terminal_dist = std::uniform_int_distribution<size_t>(
+        0, terminals.size() - (merged ? 2 : 1));
+    const std::size_t to_nt = base_terminal_dist(rng_);
+
+    return {new_terminal, to_terminal, to_nt};
+}
+
+SymbolId GrammarFactory::StepNonTerminal(const composition& base,
+                                         const step_choice& choice) const {
+    // base.terminals_ after the first replacement, as ApplyComposeStep
+    // builds it
+    std::vector<SymbolId> terminals = base.terminals_;
+    terminals.erase(terminals.begin() + choice.to_terminal_);
+    InsertSorted(terminals, choice.new_terminal_);
+    return terminals[choice.to_nt_];
+}
+
+void GrammarFactory::ApplyComposeStep(composition& base, std::size_t cmb,
+                                      int level, const step_choice& choice,
+                                      step_undo* undo) const {
+    const composition&     item      = catalog_->item_rules_.at(cmb);
+    CompactGrammar&        rules     = base.rules_;
+    std::vector<SymbolId>& terminals = base.terminals_;
+    if (undo != nullptr) {
+        undo->symbols_.clear();
+        undo->productions_ = rules.ProductionCount();
+        undo->terminals_   = terminals;
+    }
+
+    const SymbolId renamed = terminals[choice.to_terminal_];
+    terminals.erase(terminals.begin() + choice.to_terminal_);
+    InsertSorted(terminals, choice.new_terminal_);
+    const SymbolId replaced = terminals[choice.to_nt_];
+    terminals.erase(terminals.begin() + choice.to_nt_);
+
+    // Levels beyond the alphabet intern their non-terminal when they come
+    SymbolId new_nt = LevelNonTerminal(rules, level);
+    if (new_nt >= rules.st_.Size()) {
+        new_nt = rules.st_.Intern(NonTerminalName(level), NO_TERMINAL);
+        rules.nt_offsets_.push_back(rules.nt_offsets_.back());
     }
 
-    std::unordered_map<std::string, std::vector<production>> combined_grammar =
-        base.g_;
-    for (auto& [nt, prods] : cmb.g_) {
-        combined_grammar[nt].insert(combined_grammar[nt].end(), prods.begin(),
-                                    prods.end());
+    // Apply both replacements in one pass
+    for (std::uint32_t i = 0; i < rules.symbols_.size(); ++i) {
+        SymbolId&      symbol = rules.symbols_[i];
+        const SymbolId before = symbol;
+        if (symbol == renamed) {
+            symbol = choice.new_terminal_;
+        }
+        if (symbol == replaced) {
+            symbol = new_nt;
+        }
+        if (undo != nullptr && symbol != before) {
+            undo->symbols_.emplace_back(i, before);
+        }
     }
 
-    return Grammar(combined_grammar);
+    // Add cmb with its non-terminal renamed to new_nt, after every other
+    // non-terminal
+    const CompactGrammar& added = item.rules_;
+    for (std::uint32_t p : added.ProductionsOf(LevelNonTerminal(added, 1))) {
+        for (SymbolId symbol : added.Rhs(p)) {
+            rules.symbols_.push_back(added.st_.IsTerminal(symbol) ? symbol
+                                                                   : new_nt);
+        }
+        rules.rhs_offsets_.push_back(
+            static_cast<std::uint32_t>(rules.symbols_.size()));
+        rules.lhs_.push_back(new_nt);
+    }
+    std::fill(rules.nt_offsets_.begin() + rules.st_.kind_index_[new_nt] + 1,
+              rules.nt_offsets_.end(), rules.ProductionCount());
+    for (SymbolId t : item.terminals_) {
+        InsertSorted(terminals, t);
+    }
+    if (!base.items_.empty()) {
+        base.items_.push_back(cmb);
+    }
 }
 
-GrammarFactory::FactoryItem GrammarFactory::CreateLv2Item() {
-    // STEP 1 Choose a random base grammar ----------------------------------
-    std::random_device                    rd;
-    std::mt19937                          gen(rd());
-    std::uniform_int_distribution<size_t> dist(0, items.size() - 1);
-    FactoryItem                           base = items.at(dist(gen));
-    // -----------------------------------------------------
+void GrammarFactory::UndoComposeStep(composition&     base,
+                                     const step_undo& undo) const {
+    CompactGrammar& rules = base.rules_;
+    rules.symbols_.resize(rules.rhs_offsets_[undo.productions_]);
+    rules.rhs_offsets_.resize(undo.productions_ + 1);
+    rules.lhs_.resize(undo.productions_);
+    for (std::uint32_t& offset : rules.nt_offsets_) {
+        offset = std::min(offset, undo.productions_);
+    }
+    for (const auto& [i, symbol] : undo.symbols_) {
+        rules.symbols_[i] = symbol;
+    }
+    base.terminals_ = undo.terminals_;
+    if (!base.items_.empty()) {
+        base.items_.pop_back();
+    }
+}
 
-    // STEP 2 Choose a random cmb grammar such that base != cmb
-    // ------------------------------
-    FactoryItem cmb = items.at(dist(gen));
-    while (base.g_ == cmb.g_) {
-        cmb = items.at(dist(gen));
+void GrammarFactory::ForEachStepChoice(
+    const composition& base, std::size_t cmb,
+    const std::function<void(const step_choice&, std::uint64_t)>& visit)
+    const {
+    const std::vector<SymbolId>& cmb_terminals =
+        catalog_->item_rules_.at(cmb).terminals_;
+    // A copy: `visit` may edit `base` meanwhile
+    const std::vector<SymbolId>  terminals = base.terminals_;
+    const std::vector<SymbolId>& alphabet  = catalog_->terminal_ids_;
+    const std::uint64_t fresh_count = std::ranges::count_if(
+        alphabet, [&](SymbolId t) {
+            return !std::ranges::binary_search(cmb_terminals, t);
+        });
+
+    for (SymbolId new_terminal : alphabet) {
+        if (std::ranges::binary_search(cmb_terminals, new_terminal)) {
+            continue;
+        }
+        for (std::size_t to_terminal = 0; to_terminal < terminals.size();
+             ++to_terminal) {
+            const bool merged =
+                terminals[to_terminal] != new_terminal &&
+                std::ranges::binary_search(terminals, new_terminal);
+            const std::size_t   left = terminals.size() - (merged ? 1 : 0);
+            const std::uint64_t outcomes =
+                fresh_count * terminals.size() * left;
+            for (std::size_t to_nt = 0; to_nt < left; ++to_nt) {
+                visit({new_terminal, to_terminal, to_nt}, outcomes);
+            }
+        }
     }
-    // -----------------------------------------------------
+}
 
-    std::string new_nt = "B";
-    // STEP 3 Change non terminals in cmb to B
-    // --------------------------------------------
-    std::unordered_map<std::string, std::vector<production>>
-        cmb_updated_grammar;
-    cmb.st_.non_terminals_.emplace(new_nt);
-    for (auto& [nt, prods] : cmb.g_) {
-        for (auto& prod : prods) {
-            for (std::string& symbol : prod) {
-                if (!cmb.st_.IsTerminal(symbol)) {
-                    symbol = new_nt;
-                    cmb.st_.non_terminals_.erase(symbol);
-                }
+void GrammarFactory::BuildLv2Catalog(catalog& cat) {
+    // Different draws can compose the same rules: entries are merged, and
+    // `draws` keeps, for every draw, its entry and the number of equally
+    // likely outcomes of its step. The choice of the two items is uniform
+    // over the same range for every draw, so it does not weigh.
+    std::map<std::vector<std::uint32_t>, std::size_t>  entry_of;
+    std::vector<std::pair<std::size_t, std::uint64_t>> draws;
+    step_undo                                          undo;
+    for (std::size_t first = 0; first < cat.items.size(); ++first) {
+        composition base = ItemComposition(first);
+        for (std::size_t cmb = 0; cmb < cat.items.size(); ++cmb) {
+            if (cmb == first) {
+                continue;
             }
+            ForEachStepChoice(base, cmb, [&](const step_choice& choice,
+                                             std::uint64_t      outcomes) {
+                ApplyComposeStep(base, cmb, 2, choice, &undo);
+                auto [it, inserted] = entry_of.try_emplace(
+                    RulesKey(base.rules_), cat.lv2_catalog_.size());
+                if (inserted) {
+                    cat.lv2_catalog_.push_back({base});
+                }
+                draws.emplace_back(it->second, outcomes);
+                UndoComposeStep(base, undo);
+            });
         }
-        cmb_updated_grammar[new_nt] = prods;
     }
-    cmb.g_ = std::move(cmb_updated_grammar);
-    // -----------------------------------------------------
 
-    // STEP 4 Change one base terminal to another that is not in cmb
-    std::unordered_set<std::string> cmb_terminals = cmb.st_.terminals_wtho_eol_;
-    std::unordered_set<std::string> terminal_alphabet_set(
-        terminal_alphabet_.begin(), terminal_alphabet_.end());
+    // The probability of a draw is 1 / outcomes; scale to integer weights
+    std::uint64_t scale = 1;
+    for (const auto& [entry, outcomes] : draws) {
+        scale = std::lcm(scale, outcomes);
+    }
+    std::vector<std::uint64_t> weights(cat.lv2_catalog_.size(), 0);
+    for (const auto& [entry, outcomes] : draws) {
+        weights[entry] += scale / outcomes;
+    }
+    for (catalog_entry& entry : cat.lv2_catalog_) {
+        Grammar gr  = entry.rules_.ToGrammar();
+        entry.slr1_ = IsAcceptedSLR1(gr);
+        entry.ll1_  = MakeLL1(gr);
+    }
+    cat.lv2_any_ = AliasTable(weights);
+    std::vector<std::uint64_t> as_is(weights.size(), 0);
+    for (std::size_t i = 0; i < weights.size(); ++i) {
+        if (cat.lv2_catalog_[i].ll1_ == AS_IS) {
+            as_is[i] = weights[i];
+        }
+    }
+    if (std::ranges::any_of(as_is, [](std::uint64_t w) { return w != 0; })) {
+        cat.lv2_ll1_as_is_ = AliasTable(as_is);
+    }
+    std::vector<std::uint64_t> slr1(weights.size(), 0);
+    for (std::size_t i = 0; i < weights.size(); ++i) {
+        if (cat.lv2_catalog_[i].slr1_) {
+            slr1[i] = weights[i];
+        }
+    }
+    if (std::ranges::any_of(slr1, [](std::uint64_t w) { return w != 0; })) {
+        cat.lv2_slr1_ = AliasTable(slr1);
+    }
+}
 
-    for (const std::string& terminal : cmb_terminals) {
-        terminal_alphabet_set.erase(terminal);
+void GrammarFactory::BuildIndex(int level) {
+    const generation_stats               stats = stats_;
+    std::shared_ptr<const grammar_index> index = MakeIndex(level);
+    stats_                                     = stats;
+    auto next = std::make_shared<catalog>(*catalog_);
+    next->indices_.at(level - 1) = std::move(index);
+    catalog_                     = std::move(next);
+}
+
+void GrammarFactory::EnsureIndex(int level) {
+    if (level >= 1 && level <= MAX_INDEXED_LEVEL_ &&
+        IndexOf(level) == nullptr) {
+        BuildIndex(level);
     }
+}
 
-    std::uniform_int_distribution<size_t> terminal_dist(
-        0, terminal_alphabet_set.size() - 1);
-    std::vector<std::string> remaining_terminals(terminal_alphabet_set.begin(),
-                                                 terminal_alphabet_set.end());
-    const std::string& new_terminal = remaining_terminals[terminal_dist(gen)];
+std::shared_ptr<const GrammarFactory::grammar_index>
+GrammarFactory::MakeIndex(int level) {
+    grammar_index                   index;
+    std::unordered_set<std::string> seen;
+    const auto add = [&](const composition&   rules,
+                         const catalog_entry* verdicts) {
+        std::vector<SymbolId> symbols;
+        canonical_labeling    labeling = TerminalLabeling(rules, symbols);
+        if (!seen.insert(std::move(labeling.form_)).second) {
+            return;
+        }
+        catalog_entry& entry = index.grammars_.emplace_back();
+        entry.rules_         = rules;
+        RenameTerminals(entry.rules_, symbols, labeling,
+                        catalog_->terminal_ids_);
+        if (verdicts != nullptr) {
+            entry.ll1_  = verdicts->ll1_;
+            entry.slr1_ = verdicts->slr1_;
+        } else {
+            Grammar gr  = entry.rules_.ToGrammar();
+            entry.slr1_ = IsAcceptedSLR1(gr);
+            entry.ll1_  = MakeLL1(gr);
+        }
+    };
 
-    std::uniform_int_distribution<size_t> base_terminal_dist(
-        0, base.st_.terminals_wtho_eol_.size() - 1);
-    std::vector<std::string> base_terminals(
-        base.st_.terminals_wtho_eol_.begin(),
-        base.st_.terminals_wtho_eol_.end());
-    std::string terminal_to_replace =
-        base_terminals.at(base_terminal_dist(gen));
-
-    for (auto& [nt, prods] : base.g_) {
-        for (auto& prod : prods) {
-            for (std::string& symbol : prod) {
-                if (symbol == terminal_to_replace) {
-                    symbol = new_terminal;
-                }
+    if (level == 1) {
+        for (std::size_t item = 0; item < catalog_->items.size(); ++item) {
+            add(catalog_->item_rules_[item], nullptr);
+        }
+    } else if (level == 2) {
+        // Verdicts do not depend on the names of the terminals
+        for (const catalog_entry& entry : catalog_->lv2_catalog_) {
+            add(entry.rules_, &entry);
+        }
+    } else {
+        step_undo undo;
+        for (const catalog_entry& entry : catalog_->lv2_catalog_) {
+            composition base = entry.rules_;
+            for (std::size_t cmb = 0; cmb < catalog_->items.size(); ++cmb) {
+                // Terminals in neither grammar only differ by their names, so
+                // only the first one is tried
+                const std::vector<SymbolId>& cmb_terminals =
+                    catalog_->item_rules_[cmb].terminals_;
+                const SymbolId unused = *std::ranges::find_if(
+                    catalog_->terminal_ids_, [&](SymbolId t) {
+                        return !std::ranges::binary_search(cmb_terminals, t) &&
+                               !std::ranges::binary_search(base.terminals_, t);
+                    });
+                ForEachStepChoice(base, cmb, [&](const step_choice& choice,
+                                                 std::uint64_t) {
+                    if (choice.new_terminal_ != unused &&
+                        !std::ranges::binary_search(base.terminals_,
+                                                    choice.new_terminal_)) {
+                        return;
+                    }
+                    ApplyComposeStep(base, cmb, 3, choice, &undo);
+                    add(base, nullptr);
+                    UndoComposeStep(base, undo);
+                });
             }
         }
     }
-    base.st_.terminals_wtho_eol_.erase(terminal_to_replace);
-    base.st_.terminals_wtho_eol_.insert(new_terminal);
-    base_terminal_dist = std::uniform_int_distribution<size_t>(
-        0, base.st_.terminals_wtho_eol_.size() - 1);
-    // -----------------------------------------------------
-
-    // STEP 5 Change one random terminal -> terminal B
-    terminal_to_replace = *std::next(base.st_.terminals_wtho_eol_.begin(),
-                                     base_terminal_dist(gen));
-    for (auto& [nt, prods] : base.g_) {
-        for (auto& prod : prods) {
-            for (std::string& symbol : prod) {
-                if (symbol == terminal_to_replace) {
-                    symbol = new_nt;
-                }
-            }
+
+    for (std::uint32_t i = 0; i < index.grammars_.size(); ++i) {
+        if (index.grammars_[i].ll1_ != NOT_LL1) {
+            index.ll1_.push_back(i);
+        }
+        if (index.grammars_[i].slr1_) {
+            index.slr1_.push_back(i);
         }
     }
+    return std::make_shared<const grammar_index>(std::move(index));
+}
 
-    std::unordered_map<std::string, std::vector<production>> combined_grammar =
-        base.g_;
-    for (auto& [nt, prods] : cmb.g_) {
-        combined_grammar[nt].insert(combined_grammar[nt].end(), prods.begin(),
-                                    prods.end());
+const GrammarFactory::grammar_index* GrammarFactory::IndexOf(int level) const {
+    if (level < 1 || level > MAX_INDEXED_LEVEL_ ||
+        !catalog_->indices_[level - 1]) {
+        return nullptr;
     }
+    return catalog_->indices_[level - 1].get();
+}
+
+std::string GrammarFactory::Canonicalize(composition& rules) const {
+    std::vector<SymbolId> symbols;
+    canonical_labeling    labeling = TerminalLabeling(rules, symbols);
+    RenameTerminals(rules, symbols, labeling, catalog_->terminal_ids_);
+    return std::move(labeling.form_);
+}
 
-    return {combined_grammar};
+std::string GrammarFactory::NonTerminalName(int level) const {
+    const std::vector<std::string>& alphabet = catalog_->non_terminal_alphabet_;
+    if (static_cast<std::size_t>(level) <= alphabet.size()) {
+        return alphabet[level - 1];
+    }
+    return "N" + std::to_string(level);
 }
 
 bool GrammarFactory::HasUnreachableSymbols(Grammar& grammar) const {
-    std::unordered_set<std::string> reachable;
-    std::queue<std::string>         pending;
+    return HasUnreachableSymbols(GrammarAnalysis(grammar));
+}
 
-    pending.push(grammar.axiom_);
-    reachable.insert(grammar.axiom_);
+bool GrammarFactory::HasUnreachableSymbols(
+    const GrammarAnalysis& analysis) const {
+    const CompactGrammar& cg = analysis.cg_;
+    std::vector<bool>     reachable(cg.st_.Size(), false);
+    std::queue<SymbolId>  pending;
+
+    pending.push(cg.axiom_);
+    reachable[cg.axiom_] = true;
 
     while (!pending.empty()) {
-        std::string current = pending.front();
+        SymbolId current = pending.front();
         pending.pop();
 
-        if (auto it = grammar.g_.find(current); it != grammar.g_.end()) {
-            for (const auto& production : it->second) {
-                for (const auto& symbol : production) {
-                    if (!grammar.st_.IsTerminal(symbol) &&
-                        !reachable.contains(symbol)) {
-                        reachable.insert(symbol);
-                        pending.push(symbol);
-                    }
+        for (std::uint32_t p : cg.ProductionsOf(current)) {
+            for (SymbolId symbol : cg.Rhs(p)) {
+                if (!cg.st_.IsTerminal(symbol) && !reachable[symbol]) {
+                    reachable[symbol] = true;
+                    pending.push(symbol);
                 }
             }
         }
     }
 
     return std::ranges::any_of(
-        grammar.st_.non_terminals_,
-        [&reachable](const auto& nt) { return !reachable.contains(nt); });
+        cg.st_.non_terminals_,
+        [&](const auto& nt) { return !reachable[cg.st_.Id(nt)]; });
 }
 
 bool GrammarFactory::IsInfinite(Grammar& grammar) const {
-    std::unordered_set<std::string> generating;
-    bool                            changed = true;
+    return IsInfinite(GrammarAnalysis(grammar));
+}
+
+bool GrammarFactory::IsInfinite(const GrammarAnalysis& analysis) const {
+    const CompactGrammar& cg = analysis.cg_;
+    std::vector<bool>     generating(cg.st_.Size(), false);
+    std::size_t           generating_count = 0;
+    bool                  changed          = true;
 
     while (changed) {
         changed = false;
-        for (const auto& [nt, productions] : grammar.g_) {
-            if (generating.contains(nt)) {
+        for (std::uint32_t p = 0; p < cg.ProductionCount(); ++p) {
+            const SymbolId nt = cg.Lhs(p);
+            if (generating[nt]) {
                 continue;
             }
-            for (const auto& prod : productions) {
-                bool all_generating = true;
-                for (const auto& symbol : prod) {
-                    if (!grammar.st_.IsTerminal(symbol) &&
-                        !generating.contains(symbol)) {
-                        all_generating = false;
-                        break;
-                    }
-                }
-                if (all_generating) {
-                    generating.insert(nt);
-                    changed = true;
-                    break;
-                }
+            if (std::ranges::all_of(cg.Rhs(p), [&](SymbolId symbol) {
+                    return cg.st_.IsTerminal(symbol) || generating[symbol];
+                })) {
+                generating[nt] = true;
+                ++generating_count;
+                changed = true;
             }
         }
     }
     // Counterexample:  S -> A; A -> B A c | e; B -> B a | B. Axiom can derive
     // into a terminal string (A -> e) return generating.find(grammar.axiom_) ==
     // generating.end();
-    return generating != grammar.st_.non_terminals_;
+    return generating_count != cg.st_.non_terminals_.size() ||
+           !std::ranges::all_of(
+               cg.st_.non_terminals_,
+               [&](const auto& nt) { return generating[cg.st_.Id(nt)]; });
 }
 
 bool GrammarFactory::HasDirectLeftRecursion(const Grammar& grammar) const {
@@ -751,23 +1716,27 @@ bool GrammarFactory::HasDirectLeftRecursion(const Grammar& grammar) const {
 }
 
 bool GrammarFactory::HasIndirectLeftRecursion(Grammar& grammar) {
-    const std::unordered_set<std::string> nullable = NullableSymbols(grammar);
-    std::unordered_map<std::string, std::unordered_set<std::string>> graph;
+    return HasIndirectLeftRecursion(GrammarAnalysis(grammar));
+}
 
-    for (const auto& [nt, productions] : grammar.g_) {
-        graph[nt] = {};
-        for (const production& prod : productions) {
-            if (!grammar.st_.IsTerminal(prod[0])) {
-                graph[nt].insert(prod[0]);
+bool GrammarFactory::HasIndirectLeftRecursion(const GrammarAnalysis& analysis) {
+    const CompactGrammar&    cg       = analysis.cg_;
+    const std::vector<bool>& nullable = analysis.Nullable();
+    std::unordered_map<SymbolId, std::unordered_set<SymbolId>> graph;
+
+    for (std::uint32_t p = 0; p < cg.ProductionCount(); ++p) {
+        const std::span<const SymbolId> prod = cg.Rhs(p);
+        auto&                           adj  = graph[cg.Lhs(p)];
+        if (!cg.st_.IsTerminal(prod[0])) {
+            adj.insert(prod[0]);
+        }
+        for (size_t i = 1; i < prod.size(); ++i) {
+            if (cg.st_.IsTerminal(prod[i])) {
+                break;
             }
-            for (size_t i = 1; i < prod.size(); ++i) {
-                if (grammar.st_.IsTerminal(prod[i])) {
-                    break;
-                }
-                graph[nt].insert(prod[i]);
-                if (!nullable.contains(prod[i])) {
-                    break;
-                }
+            adj.insert(prod[i]);
+            if (!nullable[cg.st_.kind_index_[prod[i]]]) {
+                break;
             }
         }
     }
@@ -775,17 +1744,17 @@ bool GrammarFactory::HasIndirectLeftRecursion(Grammar& grammar) {
 }
 
 bool GrammarFactory::HasCycle(
-    const std::unordered_map<std::string, std::unordered_set<std::string>>&
-        graph) const {
-    std::unordered_map<std::string, int> in_degree;
-    std::queue<std::string>              q;
+    const std::unordered_map<SymbolId, std::unordered_set<SymbolId>>& graph)
+    const {
+    std::unordered_map<SymbolId, int> in_degree;
+    std::queue<SymbolId>              q;
 
     for (const auto& [nt, _] : graph) {
         in_degree[nt] = 0;
     }
 
     for (const auto& [nt, adjacents] : graph) {
-        for (const std::string& adj : adjacents) {
+        for (SymbolId adj : adjacents) {
             in_degree[adj]++;
         }
     }
@@ -798,13 +1767,15 @@ bool GrammarFactory::HasCycle(
 
     int processed_nodes = 0;
     while (!q.empty()) {
-        std::string node = q.front();
+        SymbolId node = q.front();
         q.pop();
         processed_nodes++;
 
-        for (const std::string& adj : graph.at(node)) {
-            if (--in_degree[adj] == 0) {
-                q.push(adj);
+        if (auto it = graph.find(node); it != graph.end()) {
+            for (SymbolId adj : it->second) {
+                if (--in_degree[adj] == 0) {
+                    q.push(adj);
+                }
             }
         }
     }
@@ -813,38 +1784,12 @@ bool GrammarFactory::HasCycle(
 
 std::unordered_set<std::string>
 GrammarFactory::NullableSymbols(const Grammar& grammar) const {
-    std::unordered_set<std::string> nullable;
-    bool                            changed;
-
-    nullable.reserve(grammar.st_.non_terminals_.size());
-    do {
-        changed = false;
-        for (const auto& [nt, productions] : grammar.g_) {
-            if (nullable.contains(nt)) {
-                continue;
-            }
-            for (const production& prod : productions) {
-                if (prod.size() == 1 && prod[0] == grammar.st_.EPSILON_) {
-                    nullable.insert(nt);
-                    changed = true;
-                } else {
-                    bool all_nullable = true;
-                    for (const std::string& sym : prod) {
-                        if (!nullable.contains(sym) &&
-                            sym != grammar.st_.EOL_) {
-                            all_nullable = false;
-                            break;
-                        }
-                    }
-                    if (all_nullable) {
-                        nullable.insert(nt);
-                        changed = true;
-                    }
-                }
-            }
-        }
-    } while (changed);
-    return nullable;
+    const GrammarAnalysis           analysis(grammar);
+    std::unordered_set<std::string> names;
+    for (SymbolId id : analysis.NullableSymbols()) {
+        names.insert(analysis.cg_.st_.Name(id));
+    }
+    return names;
 }
 
 void GrammarFactory::RemoveLeftRecursion(Grammar& grammar) {
@@ -0,0 +1,195 @@
+#include "grammar_pool.hpp"
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+GrammarPool::GrammarPool(std::shared_ptr<const GrammarFactory::catalog> catalog,
+                         std::uint64_t seed, const std::vector<pool_key>& keys,
+                         pool_config config)
+    : catalog_(std::move(catalog)), seed_(seed), config_(config) {
+    if (config_.high_watermark_ == 0 ||
+        config_.high_watermark_ < config_.low_watermark_) {
+        throw std::invalid_argument(
+            "Pool watermarks must satisfy 0 < high and low <= high.");
+    }
+    const std::int64_t start = Now();
+    GrammarFactory     indexer(catalog_);
+    for (const pool_key& key : keys) {
+        if (key.second < 1) {
+            throw std::invalid_argument("Pool level must be at least 1, not " +
+                                        std::to_string(key.second) + ".");
+        }
+        if (Find(key.first, key.second) == nullptr) {
+            indexer.EnsureIndex(key.second);
+            pools_.push_back(
+                std::make_unique<pool>(key, config_.high_watermark_));
+            pools_.back()->refill_start_ns_ = start;
+        }
+    }
+    catalog_ = indexer.catalog_;
+    for (std::size_t t = 0; t < config_.threads_; ++t) {
+        threads_.emplace_back(&GrammarPool::Refill, this);
+    }
+}
+
+GrammarPool::~GrammarPool() {
+    {
+        std::lock_guard<std::mutex> lock(wake_mutex_);
+        stop_.request_stop();
+    }
+    wake_.notify_all();
+    for (std::thread& thread : threads_) {
+        thread.join();
+    }
+}
+
+std::unique_ptr<pooled_grammar>
+GrammarPool::TryTake(GrammarFactory::grammar_class type, int level) {
+    pool* p = Find(type, level);
+    if (p == nullptr) {
+        return nullptr;
+    }
+    std::unique_ptr<pooled_grammar> grammar;
+    if (p->ring_.TryPop(grammar)) {
+        ++p->hits_;
+    } else {
+        ++p->misses_;
+    }
+    bool idle = false;
+    if (p->ring_.Size() < config_.low_watermark_ &&
+        p->refilling_.compare_exchange_strong(idle, true)) {
+        p->refill_start_ns_ = Now();
+        {
+            std::lock_guard<std::mutex> lock(wake_mutex_);
+            ++refill_requests_;
+        }
+        wake_.notify_one();
+    }
+    return grammar;
+}
+
+pool_stats GrammarPool::Stats(GrammarFactory::grammar_class type,
+                              int level) const {
+    const pool* p = Find(type, level);
+    if (p == nullptr) {
+        throw std::out_of_range("No pool of level " + std::to_string(level) +
+                                ".");
+    }
+    return {p->hits_,         p->misses_,     p->generated_,   p->refills_,
+            p->total_lag_ns_, p->max_lag_ns_, p->ring_.Size()};
+}
+
+bool GrammarPool::WaitFull(std::chrono::milliseconds timeout) const {
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (!std::ranges::all_of(pools_, [&](const std::unique_ptr<pool>& p) {
+        return p->ring_.Size() >= config_.high_watermark_;
+    })) {
+        if (std::chrono::steady_clock::now() >= deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+GrammarPool::pool* GrammarPool::Find(GrammarFactory::grammar_class type,
+                                     int level) const {
+    for (const std::unique_ptr<pool>& p : pools_) {
+        if (p->key_ == pool_key{type, level}) {
+            return p.get();
+        }
+    }
+    return nullptr;
+}
+
+GrammarPool::pool* GrammarPool::Reserve() {
+    while (true) {
+        pool*       best    = nullptr;
+        std::size_t missing = 0;
+        for (const std::unique_ptr<pool>& p : pools_) {
+            const std::size_t have = p->ring_.Size() + p->pending_;
+            if (p->refilling_ && have < config_.high_watermark_ &&
+                config_.high_watermark_ - have > missing) {
+                best    = p.get();
+                missing = config_.high_watermark_ - have;
+            }
+        }
+        if (best == nullptr) {
+            return nullptr;
+        }
+        // Another thread may have reserved the last grammar meanwhile
+        if (best->ring_.Size() + best->pending_.fetch_add(1) <
+            config_.high_watermark_) {
+            return best;
+        }
+        --best->pending_;
+    }
+}
+
+std::unique_ptr<pooled_grammar>
+GrammarPool::Generate(GrammarFactory& factory, pool& p) const {
+    auto grammar    = std::make_unique<pooled_grammar>();
+    grammar->index_ = p.next_index_++;
+    const auto [type, level] = p.key_;
+    const GrammarFactory::generation_limits limits{.stop_ = stop_.get_token()};
+    GrammarFactory::generation_result       result =
+        type == GrammarFactory::LL1_GRAMMAR
+                  ? factory.TryGenLL1Grammar(level, grammar->index_, limits)
+                  : factory.TryGenSLR1Grammar(level, grammar->index_, limits);
+    if (result.status_ != GrammarFactory::GENERATED) {
+        return nullptr;
+    }
+    grammar->grammar_ = std::move(result.grammar_);
+    if (type == GrammarFactory::LL1_GRAMMAR) {
+        grammar->ll1_.emplace(grammar->grammar_);
+        grammar->ll1_->CreateLL1Table();
+    } else {
+        grammar->grammar_.TransformToAugmentedGrammar();
+        grammar->slr1_.emplace(grammar->grammar_);
+        grammar->slr1_->MakeParser();
+    }
+    return grammar;
+}
+
+void GrammarPool::Refill() {
+    GrammarFactory factory(catalog_);
+    factory.Seed(seed_);
+    while (!stop_.stop_requested()) {
+        std::uint64_t requests = 0;
+        {
+            std::lock_guard<std::mutex> lock(wake_mutex_);
+            requests = refill_requests_;
+        }
+        pool* p = Reserve();
+        if (p == nullptr) {
+            // A request made since `requests` was read has a pool to refill
+            std::unique_lock<std::mutex> lock(wake_mutex_);
+            wake_.wait(lock, [&] {
+                return stop_.stop_requested() || refill_requests_ != requests;
+            });
+            continue;
+        }
+        std::unique_ptr<pooled_grammar> grammar = Generate(factory, *p);
+        if (grammar != nullptr && p->ring_.TryPush(grammar)) {
+            ++p->generated_;
+        }
+        --p->pending_;
+        if (p->ring_.Size() >= config_.high_watermark_ &&
+            p->refilling_.exchange(false)) {
+            const auto lag = static_cast<std::uint64_t>(
+                std::max<std::int64_t>(Now() - p->refill_start_ns_, 0));
+            ++p->refills_;
+            p->total_lag_ns_ += lag;
+            std::uint64_t longest = p->max_lag_ns_;
+            while (lag > longest &&
+                   !p->max_lag_ns_.compare_exchange_weak(longest, lag)) {
+            }
+        }
+    }
+}
+
+std::int64_t GrammarPool::Now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
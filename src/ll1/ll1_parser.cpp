@@ -1,193 +1,182 @@
 #include <algorithm>
+#include <cstdint>
 #include <iostream>
 #include <span>
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
+#include <variant>
 
 #include "grammar.hpp"
 #include "ll1_parser.hpp"
 #include "symbol_table.hpp"
 #include "tabulate.hpp"
 
-LL1Parser::LL1Parser(Grammar gr) : gr_(std::move(gr)) {
-    ComputeFirstSets();
-    ComputeFollowSets();
-}
+LL1Parser::LL1Parser(const Grammar& gr)
+    : LL1Parser(std::make_shared<const GrammarAnalysis>(gr)) {}
+
+LL1Parser::LL1Parser(std::shared_ptr<const GrammarAnalysis> analysis)
+    : analysis_(std::move(analysis)) {}
 
 bool LL1Parser::CreateLL1Table() {
-    if (first_sets_.empty() || follow_sets_.empty()) {
-        ComputeFirstSets();
-        ComputeFollowSets();
-    }
-    size_t nrows{gr_.g_.size()};
+    const CompactGrammar& cg = analysis_->cg_;
+
+    size_t nrows{cg.st_.non_terminal_ids_.size()};
     ll1_t_.reserve(nrows);
     bool has_conflict{false};
-    for (const auto& [lhs, productions] : gr_.g_) {
-        std::unordered_map<std::string, std::vector<production>> column;
-        for (const production& p : productions) {
-            std::unordered_set<std::string> ds = PredictionSymbols(lhs, p);
-            column.reserve(ds.size());
-            for (const std::string& symbol : ds) {
-                auto& cell = column[symbol];
-                if (!cell.empty()) {
-                    has_conflict = true;
-                }
-                cell.push_back(p);
+    // Productions of the same antecedent are contiguous in the compact grammar
+    for (std::uint32_t p = 0; p < cg.ProductionCount(); ++p) {
+        const SymbolId                  lhs    = cg.Lhs(p);
+        const std::span<const SymbolId> rhs    = cg.Rhs(p);
+        auto&                           column = ll1_t_[lhs];
+        std::unordered_set<SymbolId>    ds     = PredictionSymbols(p);
+        column.reserve(ds.size());
+        for (SymbolId symbol : ds) {
+            auto& cell = column[symbol];
+            if (!cell.empty()) {
+                has_conflict = true;
             }
+            cell.emplace_back(rhs.begin(), rhs.end());
         }
-        ll1_t_.try_emplace(lhs, std::move(column));
     }
     return !has_conflict;
 }
 
-void LL1Parser::First(std::span<const std::string>     rule,
-                      std::unordered_set<std::string>& result) {
-    if (rule.empty() || (rule.size() == 1 && rule[0] == gr_.st_.EPSILON_)) {
-        result.insert(gr_.st_.EPSILON_);
-        return;
-    }
-
-    if (rule.size() > 1 && rule[0] == gr_.st_.EPSILON_) {
-        First(std::span<const std::string>(rule.begin() + 1, rule.end()),
-              result);
-    } else {
-
-        if (gr_.st_.IsTerminal(rule[0])) {
-            // EOL cannot be in first sets, if we reach EOL it means that the
-            // axiom is nullable, so epsilon is included instead
-            if (rule[0] == gr_.st_.EOL_) {
-                result.insert(gr_.st_.EPSILON_);
-                return;
+bool LL1Parser::IsLL1() const {
+    const CompactGrammar& cg = analysis_->cg_;
+
+    return std::visit(
+        [&](const auto& sets) {
+            const std::uint32_t epsilon = sets.EPSILON_BIT_;
+            auto                seen    = sets.MakeSet();
+            for (SymbolId nt : cg.st_.non_terminal_ids_) {
+                seen.Clear();
+                for (std::uint32_t p : cg.ProductionsOf(nt)) {
+                    auto hd = sets.SuffixFirst(cg, p, 0);
+                    if (hd.Contains(epsilon)) {
+                        hd.Erase(epsilon);
+                        // Computes FOLLOW in place, into `sets`
+                        analysis_->Sets();
+                        hd.UnionWith(sets.FollowOf(cg, nt));
+                    }
+                    if (hd.Intersects(seen)) {
+                        return false;
+                    }
+                    seen.UnionWith(hd);
+                }
             }
-            result.insert(rule[0]);
-            return;
-        }
+            return true;
+        },
+        analysis_->FirstSets());
+}
 
-        const std::unordered_set<std::string>& fii = first_sets_[rule[0]];
-        for (const auto& s : fii) {
-            if (s != gr_.st_.EPSILON_) {
-                result.insert(s);
-            }
-        }
+void LL1Parser::First(std::span<const SymbolId>     rule,
+                      std::unordered_set<SymbolId>& result) {
+    const CompactGrammar& cg = analysis_->cg_;
+
+    std::visit(
+        [&](const auto& sets) {
+            auto first = sets.MakeSet();
+            sets.First(cg, rule, first);
+            result.merge(sets.ToSymbols(cg, first));
+        },
+        analysis_->Sets());
+}
 
-        if (!fii.contains(gr_.st_.EPSILON_)) {
-            return;
-        }
-        First(std::span<const std::string>(rule.begin() + 1, rule.end()),
-              result);
+void LL1Parser::First(std::span<const std::string>     rule,
+                      std::unordered_set<std::string>& result) {
+    const SymbolTable& st = analysis_->cg_.st_;
+
+    id_production ids;
+    ids.reserve(rule.size());
+    for (const std::string& symbol : rule) {
+        ids.push_back(st.Id(symbol));
+    }
+    std::unordered_set<SymbolId> id_result;
+    First(ids, id_result);
+    for (SymbolId id : id_result) {
+        result.insert(st.Name(id));
     }
 }
 
-// Least fixed point
 void LL1Parser::ComputeFirstSets() {
-    // Init all FIRST to empty
-    for (const auto& [nonTerminal, _] : gr_.g_) {
-        first_sets_[nonTerminal] = {};
-    }
-
-    bool changed;
-    do {
-        auto old_first_sets = first_sets_; // Copy current state
-
-        for (const auto& [nonTerminal, productions] : gr_.g_) {
-            for (const auto& prod : productions) {
-                std::unordered_set<std::string> tempFirst;
-                First(prod, tempFirst);
-
-                if (tempFirst.contains(gr_.st_.EOL_)) {
-                    tempFirst.erase(gr_.st_.EOL_);
-                    tempFirst.insert(gr_.st_.EPSILON_);
-                }
-
-                auto& current_set = first_sets_[nonTerminal];
-                current_set.insert(tempFirst.begin(), tempFirst.end());
-            }
-        }
-
-        // Until all remain the same
-        changed = (old_first_sets != first_sets_);
-
-    } while (changed);
+    analysis_->FirstSets();
 }
 
 void LL1Parser::ComputeFollowSets() {
-    for (const auto& [nt, _] : gr_.g_) {
-        follow_sets_[nt] = {};
-    }
-    follow_sets_[gr_.axiom_].insert(gr_.st_.EOL_);
-
-    bool changed;
-    do {
-        changed = false;
-        for (const auto& [lhs, productions] : gr_.g_) {
-            for (const production& rhs : productions) {
-                for (size_t i = 0; i < rhs.size(); ++i) {
-                    const std::string& symbol = rhs[i];
-                    if (!gr_.st_.IsTerminal(symbol)) {
-                        changed |= UpdateFollow(symbol, lhs, rhs, i);
-                    }
-                }
-            }
-        }
-    } while (changed);
+    analysis_->Sets();
 }
 
-bool LL1Parser::UpdateFollow(const std::string& symbol, const std::string& lhs,
-                             const production& rhs, size_t i) {
-    bool changed = false;
+std::unordered_set<SymbolId> LL1Parser::Follow(SymbolId arg) {
+    const CompactGrammar& cg = analysis_->cg_;
 
-    std::unordered_set<std::string> first_remaining;
-    if (i + 1 < rhs.size()) {
-        First(std::span<const std::string>(rhs.begin() + i + 1, rhs.end()),
-              first_remaining);
-    } else {
-        first_remaining.insert(gr_.st_.EPSILON_);
+    if (arg >= cg.st_.Size() || cg.st_.IsTerminal(arg)) {
+        return {};
     }
+    return std::visit(
+        [&](const auto& sets) {
+            return sets.ToSymbols(cg, sets.FollowOf(cg, arg));
+        },
+        analysis_->Sets());
+}
 
-    // Add FIRST(β) \ {ε}
-    for (const auto& terminal : first_remaining) {
-        if (terminal != gr_.st_.EPSILON_) {
-            changed |= follow_sets_[symbol].insert(terminal).second;
-        }
-    }
+std::unordered_set<std::string> LL1Parser::Follow(const std::string& arg) {
+    const SymbolTable& st = analysis_->cg_.st_;
 
-    // If FIRST(β) contains ε, add FOLLOW(lhs)
-    if (first_remaining.contains(gr_.st_.EPSILON_)) {
-        for (const auto& terminal : follow_sets_[lhs]) {
-            changed |= follow_sets_[symbol].insert(terminal).second;
-        }
+    std::unordered_set<std::string> names;
+    if (!st.In(arg)) {
+        return names;
     }
-
-    return changed;
+    for (SymbolId id : Follow(st.Id(arg))) {
+        names.insert(st.Name(id));
+    }
+    return names;
 }
 
-std::unordered_set<std::string> LL1Parser::Follow(const std::string& arg) {
-    if (!follow_sets_.contains(arg)) {
-        return {};
-    }
-    return follow_sets_.at(arg);
+std::unordered_set<SymbolId>
+LL1Parser::PredictionSymbols(SymbolId                  antecedent,
+                             std::span<const SymbolId> consequent) {
+    const CompactGrammar& cg = analysis_->cg_;
+
+    return std::visit(
+        [&](const auto& sets) {
+            const std::uint32_t epsilon = sets.EPSILON_BIT_;
+            auto                hd      = sets.MakeSet();
+            sets.First(cg, consequent, hd);
+            if (hd.Contains(epsilon)) {
+                hd.Erase(epsilon);
+                hd.UnionWith(sets.FollowOf(cg, antecedent));
+            }
+            return sets.ToSymbols(cg, hd);
+        },
+        analysis_->Sets());
 }
 
-std::unordered_set<std::string>
-LL1Parser::PredictionSymbols(const std::string&              antecedent,
-                             const std::vector<std::string>& consequent) {
-    std::unordered_set<std::string> hd{};
-    First({consequent}, hd);
-    if (!hd.contains(gr_.st_.EPSILON_)) {
-        return hd;
-    }
-    hd.erase(gr_.st_.EPSILON_);
-    hd.merge(Follow(antecedent));
-    return hd;
+std::unordered_set<SymbolId>
+LL1Parser::PredictionSymbols(std::uint32_t production) {
+    const CompactGrammar& cg = analysis_->cg_;
+
+    return std::visit(
+        [&](const auto& sets) {
+            const std::uint32_t epsilon = sets.EPSILON_BIT_;
+            auto                hd      = sets.SuffixFirst(cg, production, 0);
+            if (hd.Contains(epsilon)) {
+                hd.Erase(epsilon);
+                hd.UnionWith(sets.FollowOf(cg, cg.Lhs(production)));
+            }
+            return sets.ToSymbols(cg, hd);
+        },
+        analysis_->Sets());
 }
 
 void LL1Parser::PrintTable() {
+    const SymbolTable& st = analysis_->cg_.st_;
+
     using namespace tabulate;
     Table table;
 
-    Table::Row_t                          headers = {"Non-terminal"};
-    std::unordered_map<std::string, bool> columns;
+    Table::Row_t                       headers = {"Non-terminal"};
+    std::unordered_map<SymbolId, bool> columns;
 
     for (const auto& outerPair : ll1_t_) {
         for (const auto& innerPair : outerPair.second) {
@@ -196,7 +185,7 @@ void LL1Parser::PrintTable() {
     }
 
     for (const auto& col : columns) {
-        headers.push_back(col.first);
+        headers.push_back(st.Name(col.first));
     }
 
     auto& header_row = table.add_row(headers);
@@ -205,22 +194,23 @@ void LL1Parser::PrintTable() {
         .font_color(Color::yellow)
         .font_style({FontStyle::bold});
 
-    std::vector<std::string> non_terminals;
+    std::vector<SymbolId> non_terminals;
     for (const auto& outerPair : ll1_t_) {
         non_terminals.push_back(outerPair.first);
     }
 
-    std::ranges::sort(non_terminals,
-                      [this](const std::string& a, const std::string& b) {
-                          if (a == gr_.axiom_)
-                              return true; // Axiom comes first
-                          if (b == gr_.axiom_)
-                              return false; // Axiom comes first
-                          return a < b;     // Sort the rest alphabetically
-                      });
+    const SymbolId axiom = analysis_->cg_.axiom_;
+    std::ranges::sort(non_terminals, [&](SymbolId a, SymbolId b) {
+        if (a == axiom)
+            return true; // Axiom comes first
+        if (b == axiom)
+            return false; // Axiom comes first
+        // Sort the rest alphabetically
+        return st.Name(a) < st.Name(b);
+    });
 
-    for (const std::string& nonTerminal : non_terminals) {
-        Table::Row_t row_data = {nonTerminal};
+    for (SymbolId nonTerminal : non_terminals) {
+        Table::Row_t row_data = {st.Name(nonTerminal)};
 
         for (const auto& col : columns) {
             auto innerIt = ll1_t_.at(nonTerminal).find(col.first);
@@ -228,8 +218,8 @@ void LL1Parser::PrintTable() {
                 std::string cell_content;
                 for (const auto& prod : innerIt->second) {
                     cell_content += "[ ";
-                    for (const std::string& elem : prod) {
-                        cell_content += elem + " ";
+                    for (SymbolId elem : prod) {
+                        cell_content += st.Name(elem) + " ";
                     }
                     cell_content += "] ";
                 }
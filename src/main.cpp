@@ -1,20 +1,293 @@
 #include "grammar.hpp"
+#include "grammar_corpus.hpp"
 #include "grammar_factory.hpp"
 #include "ll1_parser.hpp"
+#include "philox_engine.hpp"
 #include "slr1_parser.hpp"
+#include "verdict_cache.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
 #include <iostream>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <thread>
+#include <vector>
+
+namespace {
+
+/**
+ * @brief Writes a corpus with every level from 1 to `max level`:
+ * `gen corpus [file] [max level] [draws] [seed]`.
+ */
+int WriteCorpus(const std::vector<std::string>& args) {
+    if (args.size() < 4 || args.size() > 6) {
+        std::cerr << "Usage: gen corpus [file] [max level] [draws] [seed]"
+                  << std::endl;
+        return 1;
+    }
+    int         max_level;
+    std::size_t draws = 1000;
+    try {
+        max_level = std::stoi(args[3]);
+        if (args.size() > 4) {
+            draws = std::stoull(args[4]);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: Invalid level or number of draws." << std::endl;
+        return 1;
+    }
+
+    GrammarFactory factory;
+    factory.Init();
+    if (args.size() > 5) {
+        try {
+            factory.Seed(std::stoull(args[5]));
+        } catch (const std::exception& e) {
+            std::cerr << "Error: Invalid seed. Please use a non-negative "
+                         "integer."
+                      << std::endl;
+            return 1;
+        }
+    }
+    std::cout << "Seed: " << factory.seed_ << "\n";
+
+    GrammarCorpusWriter writer;
+    for (int level = 1; level <= max_level; ++level) {
+        const std::size_t before = writer.Size();
+        writer.AddLevel(factory, level, draws);
+        std::cout << "Level " << level << ": " << writer.Size() - before
+                  << " grammars\n";
+    }
+    try {
+        writer.Write(args[2]);
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+/// @brief Writes a string as a JSON string; control characters are written
+/// as \u00XX escapes.
+void WriteJsonString(std::ostream& out, const std::string& s) {
+    static constexpr char HEX[] = "0123456789abcdef";
+    out << '"';
+    for (char c : s) {
+        const auto byte = static_cast<unsigned char>(c);
+        if (byte < 0x20) {
+            out << "\\u00" << HEX[byte >> 4] << HEX[byte & 0xf];
+            continue;
+        }
+        if (c == '"' || c == '\\') {
+            out << '\\';
+        }
+        out << c;
+    }
+    out << '"';
+}
+
+/**
+ * @brief Writes a grammar of a batch as one JSON line, with its rules sorted
+ * by non-terminal.
+ */
+void WriteJsonLine(std::ostream& out, std::uint64_t index, std::uint64_t seed,
+                   const std::string& type, int level, const Grammar& gr) {
+    out << "{\"index\":" << index << ",\"seed\":" << seed << ",\"type\":";
+    WriteJsonString(out, type);
+    out << ",\"level\":" << level << ",\"axiom\":";
+    WriteJsonString(out, gr.axiom_);
+    out << ",\"rules\":{";
+    const std::map<std::string, std::vector<production>> rules(gr.g_.begin(),
+                                                              gr.g_.end());
+    bool first_rule = true;
+    for (const auto& [nt, prods] : rules) {
+        out << (first_rule ? "" : ",");
+        first_rule = false;
+        WriteJsonString(out, nt);
+        out << ":[";
+        for (std::size_t p = 0; p < prods.size(); ++p) {
+            out << (p == 0 ? "[" : ",[");
+            for (std::size_t i = 0; i < prods[p].size(); ++i) {
+                out << (i == 0 ? "" : ",");
+                WriteJsonString(out, prods[p][i]);
+            }
+            out << "]";
+        }
+        out << "]";
+    }
+    out << "}}\n";
+}
+
+/**
+ * @brief Writes a batch of grammars as JSON Lines to stdout:
+ * `gen batch [ll|slr] [level] [count] [threads] [seed]`.
+ */
+int WriteBatch(const std::vector<std::string>& args) {
+    if (args.size() < 5 || args.size() > 7 ||
+        (args[2] != "ll" && args[2] != "slr")) {
+        std::cerr << "Usage: gen batch [ll|slr] [level] [count] [threads] "
+                     "[seed]"
+                  << std::endl;
+        return 1;
+    }
+    int         level;
+    std::size_t count;
+    std::size_t threads = std::max(1u, std::thread::hardware_concurrency());
+    try {
+        level = std::stoi(args[3]);
+        count = std::stoull(args[4]);
+        if (args.size() > 5) {
+            threads = std::stoull(args[5]);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: Invalid level, count or number of threads."
+                  << std::endl;
+        return 1;
+    }
+    if (level < 1) {
+        std::cerr << "Error: Difficulty level must be at least 1." << std::endl;
+        return 1;
+    }
+
+    GrammarFactory factory;
+    factory.Init();
+    factory.EnsureIndex(level);
+    if (args.size() > 6) {
+        try {
+            factory.Seed(std::stoull(args[6]));
+        } catch (const std::exception& e) {
+            std::cerr << "Error: Invalid seed. Please use a non-negative "
+                         "integer."
+                      << std::endl;
+            return 1;
+        }
+    }
+
+    std::ios::sync_with_stdio(false);
+    factory.GenerateBatch(
+        args[2] == "ll" ? GrammarFactory::LL1_GRAMMAR
+                        : GrammarFactory::SLR1_GRAMMAR,
+        level, count, threads,
+        [&](std::uint64_t index, const Grammar& gr) {
+            WriteJsonLine(std::cout, index, factory.seed_, args[2], level, gr);
+            return static_cast<bool>(std::cout);
+        });
+    std::cout.flush();
+    return std::cout ? 0 : 1;
+}
+
+/// @brief Name of every GrammarFactory::check_stage in WriteStats.
+constexpr const char* STAGE_NAMES[GrammarFactory::CHECK_STAGES] = {
+    "draw",
+    "analysis",
+    "infinite",
+    "unreachable",
+    "left recursion",
+    "LL(1) table",
+    "remove left recursion",
+    "left factorize",
+    "SLR(1) automaton"};
+
+/**
+ * @brief Writes the counters of a factory, and the time of every check
+ * stage that ran: total, mean and upper bounds of the median and of the
+ * 99th percentile.
+ */
+void WriteStats(std::ostream& out, const GrammarFactory::generation_stats& s) {
+    out << "Attempts: " << s.attempts_ << ", generated: " << s.generated_
+        << "\nRejected: " << s.rejections_[GrammarFactory::REJECTED_INFINITE]
+        << " infinite, " << s.rejections_[GrammarFactory::REJECTED_UNREACHABLE]
+        << " with unreachable symbols, "
+        << s.rejections_[GrammarFactory::REJECTED_CONFLICT]
+        << " with conflicts\nLL(1) checks: "
+        << s.ll1_fixes_[GrammarFactory::AS_IS] << " as is, "
+        << s.ll1_fixes_[GrammarFactory::REMOVE_LEFT_RECURSION]
+        << " after RemoveLeftRecursion, "
+        << s.ll1_fixes_[GrammarFactory::LEFT_FACTORIZE]
+        << " after LeftFactorize, " << s.ll1_fixes_[GrammarFactory::NOT_LL1]
+        << " not LL(1)\n";
+    out << std::left << std::setw(22) << "Stage" << std::right << std::setw(10)
+        << "runs" << std::setw(10) << "failures" << std::setw(12)
+        << "total ms" << std::setw(10) << "mean us" << std::setw(10)
+        << "p50 us" << std::setw(10) << "p99 us" << "\n";
+    for (std::size_t i = 0; i < GrammarFactory::CHECK_STAGES; ++i) {
+        const GrammarFactory::stage_stats& stage = s.stages_[i];
+        if (stage.runs_ == 0) {
+            continue;
+        }
+        const auto us = [](std::uint64_t ns) {
+            return static_cast<double>(ns) / 1000.0;
+        };
+        out << std::left << std::setw(22) << STAGE_NAMES[i] << std::right
+            << std::setw(10) << stage.runs_ << std::setw(10)
+            << stage.failures_ << std::fixed << std::setprecision(1)
+            << std::setw(12) << us(stage.total_ns_) / 1000.0 << std::setw(10)
+            << us(stage.total_ns_) / static_cast<double>(stage.runs_)
+            << std::setw(10) << us(stage.Quantile(0.5)) << std::setw(10)
+            << us(stage.Quantile(0.99)) << "\n";
+    }
+}
+
+} // namespace
 
 int main(int argc, char** argv) {
-    if (argc != 3) {
-        std::cerr << "Usage: " << argv[0] << " [ll|slr] [1|2|3]" << std::endl;
+    std::vector<std::string> args(argv, argv + argc);
+    if (args.size() > 1 && args[1] == "corpus") {
+        return WriteCorpus(args);
+    }
+    if (args.size() > 1 && args[1] == "batch") {
+        return WriteBatch(args);
+    }
+
+    const bool stats     = std::erase(args, std::string("--stats")) > 0;
+    const bool construct = std::erase(args, std::string("--construct")) > 0;
+
+    std::string                              corpus_path;
+    std::string                              cache_path;
+    std::optional<std::chrono::milliseconds> timeout;
+    while (args.size() > 2) {
+        const std::string& option = args[args.size() - 2];
+        if (option == "--corpus") {
+            corpus_path = args.back();
+        } else if (option == "--cache") {
+            cache_path = args.back();
+        } else if (option == "--timeout") {
+            try {
+                timeout = std::chrono::milliseconds(std::stoull(args.back()));
+            } catch (const std::exception& e) {
+                std::cerr << "Error: Invalid timeout. Please use a number of "
+                             "milliseconds."
+                          << std::endl;
+                return 1;
+            }
+        } else {
+            break;
+        }
+        args.resize(args.size() - 2);
+    }
+
+    if (args.size() != 3 && args.size() != 4) {
+        std::cerr << "Usage: " << argv[0]
+                  << " [ll|slr] [level] [seed] [--corpus file] [--cache file] "
+                     "[--timeout ms] [--construct] [--stats]\n"
+                  << "       " << argv[0]
+                  << " corpus [file] [max level] [draws] [seed]\n"
+                  << "       " << argv[0]
+                  << " batch [ll|slr] [level] [count] [threads] [seed]"
+                  << std::endl;
         return 1;
     }
 
-    std::string analysis_type = argv[1];
+    std::string analysis_type = args[1];
     int         level;
 
     try {
-        level = std::stoi(argv[2]);
+        level = std::stoi(args[2]);
     } catch (const std::invalid_argument& e) {
         std::cerr << "Error: Invalid difficulty level. Please use 1, 2, or 3."
                   << std::endl;
@@ -24,33 +297,133 @@ int main(int argc, char** argv) {
         return 1;
     }
 
-    if (level < 1 || level > 7) {
-        std::cerr << "Error: Difficulty level must be between 1 and 7."
+    if (level < 1) {
+        std::cerr << "Error: Difficulty level must be at least 1." << std::endl;
+        return 1;
+    }
+
+    if (analysis_type != "ll" && analysis_type != "slr") {
+        std::cerr << "Error: Invalid analysis type. Use 'll' or 'slr'."
                   << std::endl;
         return 1;
     }
 
-    GrammarFactory factory;
-    factory.Init();
+    if (construct && (analysis_type != "ll" || !corpus_path.empty())) {
+        std::cerr << "Error: --construct only generates ll grammars, without "
+                     "a corpus."
+                  << std::endl;
+        return 1;
+    }
+
+    // A corpus replaces Init: the grammars are already classified
+    GrammarFactory               factory;
+    std::optional<GrammarCorpus> corpus;
+    try {
+        if (corpus_path.empty()) {
+            factory.Init();
+            if (!construct) {
+                factory.EnsureIndex(level);
+            }
+        } else {
+            corpus.emplace(corpus_path);
+        }
+        if (!cache_path.empty()) {
+            factory.verdict_cache_ =
+                std::make_shared<VerdictCache>(VerdictCache::DEFAULT_CAPACITY_);
+            factory.verdict_cache_->Load(cache_path);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    if (args.size() == 4) {
+        try {
+            factory.Seed(std::stoull(args[3]));
+        } catch (const std::exception& e) {
+            std::cerr << "Error: Invalid seed. Please use a non-negative "
+                         "integer."
+                      << std::endl;
+            return 1;
+        }
+    }
+    std::cout << "Seed: " << factory.seed_ << "\n";
+
+    std::optional<GrammarView> drawn;
+    if (corpus) {
+        PhiloxEngine rng(factory.seed_);
+        drawn = corpus->Sample(
+            level, analysis_type == "ll" ? CORPUS_LL1 : CORPUS_SLR1, rng);
+        if (!drawn) {
+            std::cerr << "Error: The corpus has no " << analysis_type
+                      << " grammar of level " << level << "." << std::endl;
+            return 1;
+        }
+    }
+
+    std::optional<GrammarFactory::generation_result> generated;
+    if (!drawn) {
+        GrammarFactory::generation_limits limits;
+        if (timeout) {
+            limits.deadline_ = std::chrono::steady_clock::now() + *timeout;
+        }
+        generated =
+            construct ? factory.TryGenLL1GrammarByConstruction(level, limits)
+            : analysis_type == "ll" ? factory.TryGenLL1Grammar(level, limits)
+                                    : factory.TryGenSLR1Grammar(level, limits);
+        if (generated->status_ != GrammarFactory::GENERATED) {
+            const auto& rejections = generated->rejections_;
+            std::cerr << "Error: No " << analysis_type << " grammar of level "
+                      << level << " within the timeout: "
+                      << generated->attempts_ << " attempts, "
+                      << rejections[GrammarFactory::REJECTED_INFINITE]
+                      << " infinite, "
+                      << rejections[GrammarFactory::REJECTED_UNREACHABLE]
+                      << " with unreachable symbols, "
+                      << rejections[GrammarFactory::REJECTED_CONFLICT]
+                      << " with conflicts." << std::endl;
+            if (stats) {
+                WriteStats(std::cout, factory.stats_);
+            }
+            return 1;
+        }
+    }
+
     Grammar gr;
     if (analysis_type == "ll") {
-        gr = factory.GenLL1Grammar(level);
+        if (drawn) {
+            gr = drawn->ToGrammar();
+            factory.ApplyLL1Fix(gr, drawn->LL1Fix());
+        } else {
+            gr = std::move(generated->grammar_);
+        }
         LL1Parser ll1(gr);
         gr.Debug();
         std::cout << "Is ll1? : " << ll1.CreateLL1Table() << "\n";
         ll1.PrintTable();
-    } else if (analysis_type == "slr") {
-        gr = factory.GenSLR1Grammar(level);
+    } else {
+        gr = drawn ? drawn->ToGrammar() : std::move(generated->grammar_);
         gr.TransformToAugmentedGrammar();
         SLR1Parser slr1(gr);
         gr.Debug();
         std::cout << "Is slr1? : " << slr1.MakeParser() << "\n";
         slr1.DebugStates();
         slr1.DebugActions();
-    } else {
-        std::cerr << "Error: Invalid analysis type. Use 'll' or 'slr'."
-                  << std::endl;
-        return 1;
+    }
+
+    if (factory.verdict_cache_) {
+        try {
+            factory.verdict_cache_->Save(cache_path);
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+            return 1;
+        }
+        std::cout << "Verdict cache: " << factory.verdict_cache_->Hits()
+                  << " hits, " << factory.verdict_cache_->Misses()
+                  << " misses, " << factory.verdict_cache_->Size()
+                  << " grammars\n";
+    }
+    if (stats) {
+        WriteStats(std::cout, factory.stats_);
     }
     return 0;
-}
\ No newline at end of file
+}
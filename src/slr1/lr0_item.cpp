@@ -1,96 +1,57 @@
 #include <cstddef>
-#include <functional>
-#include <iostream> // DEBUG ONLY
+#include <cstdint>
+#include <iostream>
+#include <span>
 #include <string>
-#include <utility>
-#include <vector>
 
+#include "compact_grammar.hpp"
 #include "lr0_item.hpp"
 #include "symbol_table.hpp"
 
-Lr0Item::Lr0Item(std::string antecedent, std::vector<std::string> consequent,
-                 std::string epsilon, std::string eol)
-    : antecedent_(std::move(antecedent)), consequent_(std::move(consequent)),
-      epsilon_(std::move(epsilon)), eol_(std::move(eol)), dot_(0) {
-    if (this->consequent_.size() == 1 && this->consequent_[0] == epsilon_) {
+Lr0Item::Lr0Item(const CompactGrammar& grammar, std::uint32_t production,
+                 std::uint32_t dot)
+    : production_(production), dot_(dot) {
+    if (grammar.IsEpsilon(production_)) {
         dot_ = 1;
     }
 }
 
-Lr0Item::Lr0Item(std::string antecedent, std::vector<std::string> consequent,
-                 unsigned int dot, std::string epsilon, std::string eol)
-    : antecedent_(std::move(antecedent)), consequent_(std::move(consequent)),
-      epsilon_(std::move(epsilon)), eol_(std::move(eol)), dot_(dot) {
-    if (this->consequent_.size() == 1 && this->consequent_[0] == epsilon_) {
-        dot_ = 1;
-    }
-}
-
-std::string Lr0Item::NextToDot() const {
-    if (dot_ >= consequent_.size()) {
-        return epsilon_;
+SymbolId Lr0Item::NextToDot(const CompactGrammar& grammar) const {
+    std::span<const SymbolId> consequent = grammar.Rhs(production_);
+    if (dot_ >= consequent.size()) {
+        return SymbolTable::EPSILON_ID_;
     }
-    return consequent_[dot_];
+    return consequent[dot_];
 }
 
-void Lr0Item::AdvanceDot() {
-    if (dot_ < consequent_.size()) {
+void Lr0Item::AdvanceDot(const CompactGrammar& grammar) {
+    if (dot_ < grammar.Rhs(production_).size()) {
         dot_++;
     }
 }
 
-bool Lr0Item::IsComplete() const {
-    return dot_ >= consequent_.size() ||
-           (consequent_.size() == 1 && consequent_[0] == epsilon_);
+bool Lr0Item::IsComplete(const CompactGrammar& grammar) const {
+    return dot_ >= grammar.Rhs(production_).size() ||
+           grammar.IsEpsilon(production_);
 }
 
-void Lr0Item::PrintItem() const {
-    std::cout << "[ " << antecedent_ << " -> ";
-    for (unsigned int i = 0; i < consequent_.size(); ++i) {
-        if (i == dot_) {
-            std::cout << "· ";
-        }
-        std::cout << consequent_[i] << " ";
-    }
-    if (dot_ == consequent_.size()) {
-        std::cout << "· ";
-    }
-    std::cout << "]";
+void Lr0Item::PrintItem(const CompactGrammar& grammar) const {
+    std::cout << ToString(grammar);
 }
 
-std::string Lr0Item::ToString() const {
-    std::string str = "[ " + antecedent_ + " -> ";
-    for (size_t i = 0; i < consequent_.size(); ++i) {
+std::string Lr0Item::ToString(const CompactGrammar& grammar) const {
+    const SymbolTable&        st         = grammar.st_;
+    std::span<const SymbolId> consequent = grammar.Rhs(production_);
+    std::string str = "[ " + st.Name(grammar.Lhs(production_)) + " -> ";
+    for (size_t i = 0; i < consequent.size(); ++i) {
         if (i == dot_) {
             str += "· ";
         }
-        str += consequent_[i] + " ";
+        str += st.Name(consequent[i]) + " ";
     }
-    if (dot_ == consequent_.size()) {
+    if (dot_ == consequent.size()) {
         str += "· ";
     }
     str += "]";
     return str;
 }
-
-bool Lr0Item::operator==(const Lr0Item& other) const {
-    return antecedent_ == other.antecedent_ &&
-           consequent_ == other.consequent_ && dot_ == other.dot_;
-}
-
-namespace std {
-std::size_t hash<Lr0Item>::operator()(const Lr0Item& item) const {
-    std::size_t seed = 0;
-
-    seed ^= std::hash<std::string>()(item.antecedent_) + 0x9e3779b9 +
-            (seed << 6) + (seed >> 2);
-    for (const auto& str : item.consequent_) {
-        seed ^= std::hash<std::string>()(str) + 0x9e3779b9 + (seed << 6) +
-                (seed >> 2);
-    }
-    seed ^=
-        std::hash<int>()(item.dot_) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
-
-    return seed;
-}
-} // namespace std
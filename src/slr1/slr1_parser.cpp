@@ -1,11 +1,13 @@
 #include <algorithm>
+#include <cstdint>
 #include <format>
 #include <iostream>
 #include <map>
-#include <queue>
+#include <span>
 #include <stack>
 #include <string>
 #include <unordered_set>
+#include <variant>
 #include <vector>
 
 #include "grammar.hpp"
@@ -13,16 +15,19 @@
 #include "symbol_table.hpp"
 #include "tabulate.hpp"
 
-SLR1Parser::SLR1Parser(Grammar gr) : gr_(std::move(gr)) {}
+SLR1Parser::SLR1Parser(const Grammar& gr)
+    : SLR1Parser(std::make_shared<const GrammarAnalysis>(gr)) {}
+
+SLR1Parser::SLR1Parser(std::shared_ptr<const GrammarAnalysis> analysis)
+    : analysis_(std::move(analysis)) {}
 
 std::unordered_set<Lr0Item> SLR1Parser::AllItems() const {
+    const CompactGrammar& cg = analysis_->cg_;
+
     std::unordered_set<Lr0Item> items;
-    for (const auto& [lhs, productions] : gr_.g_) {
-        for (const auto& production : productions) {
-            for (unsigned int i = 0; i <= production.size(); ++i)
-                items.emplace(lhs, production, i, gr_.st_.EPSILON_,
-                              gr_.st_.EOL_);
-        }
+    for (std::uint32_t p = 0; p < cg.ProductionCount(); ++p) {
+        for (std::uint32_t i = 0; i <= cg.Rhs(p).size(); ++i)
+            items.emplace(cg, p, i);
     }
     return items;
 }
@@ -32,17 +37,13 @@ void SLR1Parser::DebugStates() const {
     tabulate::Table::Row_t header = {"State ID", "Items"};
     table.add_row(header);
 
-    for (size_t state = 0; state < states_.size(); ++state) {
+    for (const state& st : states_) {
         tabulate::Table::Row_t row;
-        const auto             currentIt =
-            std::ranges::find_if(states_, [state](const auto& st) -> bool {
-                return st.id_ == state;
-            });
-        row.push_back(std::to_string(state));
+        row.push_back(std::to_string(st.id_));
 
         std::string str = "";
-        for (const auto& item : currentIt->items_) {
-            str += item.ToString();
+        for (const auto& item : st.items_) {
+            str += item.ToString(analysis_->cg_);
             str += "\n";
         }
         row.push_back(str);
@@ -58,19 +59,24 @@ void SLR1Parser::DebugStates() const {
 }
 
 void SLR1Parser::DebugActions() {
-    std::vector<std::string> columns;
-    columns.reserve(gr_.st_.terminals_.size() + gr_.st_.non_terminals_.size());
+    const CompactGrammar& cg = analysis_->cg_;
+
+    std::vector<SymbolId> columns;
+    columns.reserve(cg.st_.terminals_.size() + cg.st_.non_terminals_.size());
     tabulate::Table        table;
     tabulate::Table::Row_t header = {"State"};
-    for (const auto& s : gr_.st_.terminals_) {
-        if (s == gr_.st_.EPSILON_) {
+    for (const auto& s : cg.st_.terminals_) {
+        if (s == cg.st_.EPSILON_) {
             continue;
         }
-        columns.push_back(s);
+        columns.push_back(cg.st_.Id(s));
+    }
+    for (const auto& s : cg.st_.non_terminals_) {
+        columns.push_back(cg.st_.Id(s));
+    }
+    for (SymbolId symbol : columns) {
+        header.push_back(cg.st_.Name(symbol));
     }
-    columns.insert(columns.end(), gr_.st_.non_terminals_.begin(),
-                   gr_.st_.non_terminals_.end());
-    header.insert(header.end(), columns.begin(), columns.end());
     table.add_row(header);
 
     for (unsigned state = 0; state < states_.size(); ++state) {
@@ -79,10 +85,10 @@ void SLR1Parser::DebugActions() {
         const auto  action_entry = actions_.find(state);
         const auto  trans_entry  = transitions_.find(state);
         const auto& transitions  = trans_entry->second;
-        for (const auto& symbol : columns) {
+        for (SymbolId symbol : columns) {
             std::string cell = "-";
 
-            if (const bool is_terminal = gr_.st_.IsTerminal(symbol);
+            if (const bool is_terminal = cg.st_.IsTerminal(symbol);
                 !is_terminal) {
                 if (trans_entry != transitions_.end()) {
                     const auto it = transitions.find(symbol);
@@ -136,12 +142,12 @@ void SLR1Parser::DebugActions() {
             if (action.action == Action::Reduce) {
                 tabulate::Table::Row_t row;
                 std::string            rule;
-                rule += action.item->antecedent_ + " -> ";
-                for (const auto& sym : action.item->consequent_) {
-                    rule += sym + " ";
+                rule += cg.st_.Name(action.item->Antecedent(cg)) + " -> ";
+                for (SymbolId sym : cg.Rhs(action.item->production_)) {
+                    rule += cg.st_.Name(sym) + " ";
                 }
                 row.push_back(std::to_string(state));
-                row.push_back(symbol);
+                row.push_back(cg.st_.Name(symbol));
                 row.push_back(rule);
                 reduce_table.add_row(row);
             }
@@ -158,36 +164,48 @@ void SLR1Parser::DebugActions() {
 }
 
 void SLR1Parser::MakeInitialState() {
-    state initial;
-    initial.id_ = 0;
-    auto axiom  = gr_.g_.at(gr_.axiom_);
+    const CompactGrammar& cg = analysis_->cg_;
+
     // the axiom must be unique
-    initial.items_.emplace(gr_.axiom_, axiom[0], gr_.st_.EPSILON_,
-                           gr_.st_.EOL_);
-    Closure(initial.items_);
-    states_.insert(initial);
+    InternState({Lr0Item(cg, cg.ProductionsOf(cg.axiom_).front())});
+}
+
+std::pair<unsigned int, bool> SLR1Parser::InternState(kernel k) {
+    std::ranges::sort(k);
+    if (auto it = state_ids_.find(k); it != state_ids_.end()) {
+        return {it->second, false};
+    }
+    const auto id = static_cast<unsigned int>(states_.size());
+    state      st;
+    st.id_ = id;
+    st.items_.insert(k.begin(), k.end());
+    Closure(st.items_);
+    states_.push_back(std::move(st));
+    state_ids_.emplace(std::move(k), id);
+    return {id, true};
 }
 
 bool SLR1Parser::SolveLRConflicts(const state& st) {
+    const CompactGrammar& cg = analysis_->cg_;
+
     for (const Lr0Item& item : st.items_) {
-        if (item.IsComplete()) {
+        if (item.IsComplete(cg)) {
             // Regla 3: Si el ítem es del axioma, ACCEPT en EOL
-            if (item.antecedent_ == gr_.axiom_) {
-                actions_[st.id_][gr_.st_.EOL_] = {nullptr, Action::Accept};
+            if (item.Antecedent(cg) == cg.axiom_) {
+                actions_[st.id_][SymbolTable::EOL_ID_] = {nullptr,
+                                                          Action::Accept};
             } else {
                 // Regla 2: Si el ítem es completo, REDUCE en FOLLOW(A)
-                std::unordered_set<std::string> follows =
-                    Follow(item.antecedent_);
-                for (const std::string& sym : follows) {
+                std::unordered_set<SymbolId> follows =
+                    Follow(item.Antecedent(cg));
+                for (SymbolId sym : follows) {
                     if (auto it = actions_[st.id_].find(sym);
                         it != actions_[st.id_].end()) {
                         // Si ya hay un Reduce, comparar las reglas.
                         // REDUCE/REDUCE si reglas distintas
                         if (it->second.action == Action::Reduce) {
-                            if (!(it->second.item->antecedent_ ==
-                                      item.antecedent_ &&
-                                  it->second.item->consequent_ ==
-                                      item.consequent_)) {
+                            if (it->second.item->production_ !=
+                                item.production_) {
                                 return false;
                             }
                         } else {
@@ -199,8 +217,8 @@ bool SLR1Parser::SolveLRConflicts(const state& st) {
             }
         } else {
             // Regla 1: Si hay un terminal después del punto, hacemos SHIFT
-            std::string nextToDot = item.NextToDot();
-            if (gr_.st_.IsTerminal(nextToDot)) {
+            SymbolId nextToDot = item.NextToDot(cg);
+            if (cg.st_.IsTerminal(nextToDot)) {
                 if (auto it = actions_[st.id_].find(nextToDot);
                     it != actions_[st.id_].end()) {
                     // Si hay una acción previa, hay conflicto si es REDUCE
@@ -218,70 +236,29 @@ bool SLR1Parser::SolveLRConflicts(const state& st) {
 }
 
 bool SLR1Parser::MakeParser() {
+    const CompactGrammar& cg = analysis_->cg_;
+
     ComputeFirstSets();
     ComputeFollowSets();
     MakeInitialState();
-    std::queue<unsigned int> pending;
-    pending.push(0);
-    unsigned int current = 0;
-    size_t       i       = 1;
-
-    do {
-        std::unordered_set<std::string> nextSymbols;
-        current = pending.front();
-        pending.pop();
-        auto it = std::ranges::find_if(
-            states_, [current](const state& st) { return st.id_ == current; });
-        if (it == states_.end()) {
-            break;
-        }
-        const state& qi = *it;
 
-        std::ranges::for_each(qi.items_, [&](const Lr0Item& item) {
-            std::string next = item.NextToDot();
-            if (next != gr_.st_.EPSILON_) {
-                nextSymbols.insert(next);
-            }
-        });
-
-        for (const std::string& symbol : nextSymbols) {
-            state newState;
-            newState.id_ = i;
-            for (const auto& item : qi.items_) {
-                if (item.NextToDot() == symbol) {
-                    Lr0Item newItem = item;
-                    newItem.AdvanceDot();
-                    newState.items_.insert(newItem);
-                }
-            }
-
-            Closure(newState.items_);
-            auto [iterator, inserted] = states_.insert(newState);
-            std::map<std::string, unsigned int> column;
-
-            if (inserted) {
-                pending.push(i);
-                if (transitions_.contains(current)) {
-                    transitions_[current].try_emplace(symbol, i);
-                } else {
-                    column.try_emplace(symbol, i);
-                    transitions_.try_emplace(current, std::move(column));
-                }
-                ++i;
-            } else {
-                if (transitions_.contains(current)) {
-                    transitions_[current].try_emplace(symbol, iterator->id_);
-                } else {
-                    column.try_emplace(symbol, iterator->id_);
-                    transitions_.try_emplace(current, std::move(column));
-                }
+    // States are numbered in creation order, so walking ids is a BFS
+    for (unsigned int current = 0; current < states_.size(); ++current) {
+        // Split the items by the symbol after the dot in one pass
+        std::map<SymbolId, kernel> gotos;
+        for (const Lr0Item& item : states_[current].items_) {
+            SymbolId next = item.NextToDot(cg);
+            if (next == SymbolTable::EPSILON_ID_) {
+                continue;
             }
+            Lr0Item advanced = item;
+            advanced.AdvanceDot(cg);
+            gotos[next].push_back(advanced);
         }
-        current++;
-    } while (!pending.empty());
-    for (const state& st : states_) {
-        if (!SolveLRConflicts(st)) {
-            return false;
+
+        // states_ may grow here, items of `current` are not used anymore
+        for (auto& [symbol, k] : gotos) {
+            transitions_[current][symbol] = InternState(std::move(k)).first;
         }
     }
     return std::ranges::all_of(
@@ -289,26 +266,25 @@ bool SLR1Parser::MakeParser() {
 }
 
 void SLR1Parser::Closure(std::unordered_set<Lr0Item>& items) {
-    std::unordered_set<std::string> visited;
+    std::unordered_set<SymbolId> visited;
     ClosureUtil(items, items.size(), visited);
 }
 
-void SLR1Parser::ClosureUtil(std::unordered_set<Lr0Item>&     items,
-                             std::size_t                      size,
-                             std::unordered_set<std::string>& visited) {
+void SLR1Parser::ClosureUtil(std::unordered_set<Lr0Item>&  items,
+                             std::size_t                   size,
+                             std::unordered_set<SymbolId>& visited) {
+    const CompactGrammar&       cg = analysis_->cg_;
     std::unordered_set<Lr0Item> newItems;
 
     for (const auto& item : items) {
-        std::string next = item.NextToDot();
-        if (next == gr_.st_.EPSILON_) {
+        SymbolId next = item.NextToDot(cg);
+        if (next == SymbolTable::EPSILON_ID_) {
             continue;
         }
-        if (!gr_.st_.IsTerminal(next) && !visited.contains(next)) {
-            const std::vector<production>& rules = gr_.g_.at(next);
-            std::ranges::for_each(rules, [&](const auto& rule) {
-                newItems.insert(
-                    {item.NextToDot(), rule, gr_.st_.EPSILON_, gr_.st_.EOL_});
-            });
+        if (!cg.st_.IsTerminal(next) && !visited.contains(next)) {
+            for (std::uint32_t p : cg.ProductionsOf(next)) {
+                newItems.emplace(cg, p);
+            }
             visited.insert(next);
         }
     }
@@ -318,14 +294,15 @@ void SLR1Parser::ClosureUtil(std::unordered_set<Lr0Item>&     items,
 }
 
 std::unordered_set<Lr0Item>
-SLR1Parser::Delta(const std::unordered_set<Lr0Item>& items,
-                  const std::string&                 str) {
-    if (str == gr_.st_.EPSILON_) {
+SLR1Parser::Delta(const std::unordered_set<Lr0Item>& items, SymbolId str) {
+    const CompactGrammar& cg = analysis_->cg_;
+
+    if (str == SymbolTable::EPSILON_ID_) {
         return {}; // DELTA(I, EPSILON) = empty
     }
     std::vector<Lr0Item> filtered;
     std::ranges::for_each(items, [&](const Lr0Item& item) -> void {
-        std::string next = item.NextToDot();
+        SymbolId next = item.NextToDot(cg);
         if (next == str) {
             filtered.push_back(item);
         }
@@ -336,7 +313,7 @@ SLR1Parser::Delta(const std::unordered_set<Lr0Item>& items,
         std::unordered_set<Lr0Item> delta_items;
         delta_items.reserve(filtered.size());
         for (Lr0Item& lr : filtered) {
-            lr.AdvanceDot();
+            lr.AdvanceDot(cg);
             delta_items.insert(lr);
         }
         Closure(delta_items);
@@ -344,130 +321,47 @@ SLR1Parser::Delta(const std::unordered_set<Lr0Item>& items,
     }
 }
 
-void SLR1Parser::First(std::span<const std::string>     rule,
-                       std::unordered_set<std::string>& result) {
-    if (rule.empty() || (rule.size() == 1 && rule[0] == gr_.st_.EPSILON_)) {
-        result.insert(gr_.st_.EPSILON_);
-        return;
-    }
-
-    if (rule.size() > 1 && rule[0] == gr_.st_.EPSILON_) {
-        First(std::span<const std::string>(rule.begin() + 1, rule.end()),
-              result);
-    } else {
-
-        if (gr_.st_.IsTerminal(rule[0])) {
-            // EOL cannot be in first sets, if we reach EOL it means that the
-            // axiom is nullable, so epsilon is included instead
-            if (rule[0] == gr_.st_.EOL_) {
-                result.insert(gr_.st_.EPSILON_);
-                return;
-            }
-            result.insert(rule[0]);
-            return;
-        }
-
-        const std::unordered_set<std::string>& fii = first_sets_[rule[0]];
-        for (const auto& s : fii) {
-            if (s != gr_.st_.EPSILON_) {
-                result.insert(s);
-            }
-        }
+std::unordered_set<Lr0Item>
+SLR1Parser::Delta(const std::unordered_set<Lr0Item>& items,
+                  const std::string&                 str) {
+    const SymbolTable& st = analysis_->cg_.st_;
 
-        if (!fii.contains(gr_.st_.EPSILON_)) {
-            return;
-        }
-        First(std::span<const std::string>(rule.begin() + 1, rule.end()),
-              result);
+    if (!st.In(str)) {
+        return {};
     }
+    return Delta(items, st.Id(str));
 }
 
-// Least fixed point
-void SLR1Parser::ComputeFirstSets() {
-    // Init all FIRST to empty
-    for (const auto& [nonTerminal, _] : gr_.g_) {
-        first_sets_[nonTerminal] = {};
-    }
-
-    bool changed;
-    do {
-        auto old_first_sets = first_sets_; // Copy current state
-
-        for (const auto& [nonTerminal, productions] : gr_.g_) {
-            for (const auto& prod : productions) {
-                std::unordered_set<std::string> tempFirst;
-                First(prod, tempFirst);
-
-                if (tempFirst.contains(gr_.st_.EOL_)) {
-                    tempFirst.erase(gr_.st_.EOL_);
-                    tempFirst.insert(gr_.st_.EPSILON_);
-                }
-
-                auto& current_set = first_sets_[nonTerminal];
-                current_set.insert(tempFirst.begin(), tempFirst.end());
-            }
-        }
-
-        // Until all remain the same
-        changed = (old_first_sets != first_sets_);
+void SLR1Parser::First(std::span<const SymbolId>     rule,
+                       std::unordered_set<SymbolId>& result) {
+    const CompactGrammar& cg = analysis_->cg_;
+
+    std::visit(
+        [&](const auto& sets) {
+            auto first = sets.MakeSet();
+            sets.First(cg, rule, first);
+            result.merge(sets.ToSymbols(cg, first));
+        },
+        analysis_->Sets());
+}
 
-    } while (changed);
+void SLR1Parser::ComputeFirstSets() {
+    analysis_->FirstSets();
 }
 
 void SLR1Parser::ComputeFollowSets() {
-    for (const auto& [nt, _] : gr_.g_) {
-        follow_sets_[nt] = {};
-    }
-    follow_sets_[gr_.axiom_].insert(gr_.st_.EOL_);
-
-    bool changed;
-    do {
-        changed = false;
-        for (const auto& [lhs, productions] : gr_.g_) {
-            for (const production& rhs : productions) {
-                for (size_t i = 0; i < rhs.size(); ++i) {
-                    const std::string& symbol = rhs[i];
-                    if (!gr_.st_.IsTerminal(symbol)) {
-                        changed |= UpdateFollow(symbol, lhs, rhs, i);
-                    }
-                }
-            }
-        }
-    } while (changed);
+    analysis_->Sets();
 }
 
-bool SLR1Parser::UpdateFollow(const std::string& symbol, const std::string& lhs,
-                              const production& rhs, size_t i) {
-    bool changed = false;
-
-    std::unordered_set<std::string> first_remaining;
-    if (i + 1 < rhs.size()) {
-        First(std::span<const std::string>(rhs.begin() + i + 1, rhs.end()),
-              first_remaining);
-    } else {
-        first_remaining.insert(gr_.st_.EPSILON_);
-    }
-
-    // Add FIRST(β) \ {ε}
-    for (const auto& terminal : first_remaining) {
-        if (terminal != gr_.st_.EPSILON_) {
-            changed |= follow_sets_[symbol].insert(terminal).second;
-        }
-    }
-
-    // If FIRST(β) contains ε, add FOLLOW(lhs)
-    if (first_remaining.contains(gr_.st_.EPSILON_)) {
-        for (const auto& terminal : follow_sets_[lhs]) {
-            changed |= follow_sets_[symbol].insert(terminal).second;
-        }
-    }
-
-    return changed;
-}
+std::unordered_set<SymbolId> SLR1Parser::Follow(SymbolId arg) {
+    const CompactGrammar& cg = analysis_->cg_;
 
-std::unordered_set<std::string> SLR1Parser::Follow(const std::string& arg) {
-    if (!follow_sets_.contains(arg)) {
+    if (arg >= cg.st_.Size() || cg.st_.IsTerminal(arg)) {
         return {};
     }
-    return follow_sets_.at(arg);
+    return std::visit(
+        [&](const auto& sets) {
+            return sets.ToSymbols(cg, sets.FollowOf(cg, arg));
+        },
+        analysis_->Sets());
 }
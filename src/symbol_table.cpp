@@ -1,27 +1,60 @@
 #include "symbol_table.hpp"
+#include <stdexcept>
+#include <string>
 #include <unordered_map>
 #include <vector>
 
-void SymbolTable::PutSymbol(const std::string& identifier, bool isTerminal) {
+SymbolId SymbolTable::PutSymbol(const std::string& identifier,
+                                bool               isTerminal) {
+    const symbol_type kind = isTerminal ? TERMINAL : NO_TERMINAL;
+    const SymbolId    id   = Intern(identifier, kind);
+    if (kinds_[id] != kind) {
+        throw std::invalid_argument(
+            "Symbol " + identifier + " is already interned as a " +
+            (isTerminal ? "non-terminal." : "terminal."));
+    }
     if (isTerminal) {
-        st_.insert({identifier, TERMINAL});
         terminals_.insert(identifier);
         terminals_wtho_eol_.insert(identifier);
 
     } else {
-        st_.insert({identifier, NO_TERMINAL});
         non_terminals_.insert(identifier);
     }
+    return id;
+}
+
+SymbolId SymbolTable::Intern(const std::string& identifier) {
+    return Intern(identifier, NO_TERMINAL);
+}
+
+SymbolId SymbolTable::Intern(const std::string& identifier,
+                             symbol_type        kind) {
+    auto [it, inserted] =
+        ids_.try_emplace(identifier, static_cast<SymbolId>(names_.size()));
+    if (inserted) {
+        std::vector<SymbolId>& range =
+            kind == TERMINAL ? terminal_ids_ : non_terminal_ids_;
+        names_.push_back(identifier);
+        kinds_.push_back(kind);
+        kind_index_.push_back(static_cast<std::uint32_t>(range.size()));
+        range.push_back(it->second);
+    }
+    return it->second;
+}
+
+SymbolId SymbolTable::Id(const std::string& s) const {
+    return ids_.at(s);
 }
 
-bool SymbolTable::In(const std::string& s) {
-    return st_.contains(s);
+bool SymbolTable::In(const std::string& s) const {
+    return ids_.contains(s);
 }
 
-bool SymbolTable::IsTerminal(const std::string& s) {
-    return terminals_.contains(s);
+bool SymbolTable::IsTerminal(const std::string& s) const {
+    auto it = ids_.find(s);
+    return it != ids_.end() && IsTerminal(it->second);
 }
 
-bool SymbolTable::IsTerminalWthoEol(const std::string& s) {
-    return s != EPSILON_ && terminals_.contains(s);
+bool SymbolTable::IsTerminalWthoEol(const std::string& s) const {
+    return s != EPSILON_ && IsTerminal(s);
 }
@@ -1,17 +1,47 @@
+#include "compact_grammar.hpp"
 #include "grammar.hpp"
+#include "grammar_corpus.hpp"
 #include "grammar_factory.hpp"
+#include "grammar_pool.hpp"
 #include "ll1_parser.hpp"
+#include "philox_engine.hpp"
 #include "slr1_parser.hpp"
+#include "verdict_cache.hpp"
 #include <algorithm>
+#include <cstring>
+#include <fstream>
 #include <gtest/gtest.h>
+#include <iterator>
+#include <map>
+#include <numeric>
+#include <stdexcept>
+#include <stop_token>
+#include <thread>
 namespace testing {
 namespace internal {
 template <> void PrintTo(const Lr0Item& item, std::ostream* os) {
-    *os << item.ToString();
+    *os << "[ production " << item.production_ << " (dot " << item.dot_
+        << ") ]";
 }
 } // namespace internal
 } // namespace testing
 
+Lr0Item MakeItem(const SLR1Parser& slr1, const std::string& antecedent,
+                 const std::vector<std::string>& consequent,
+                 unsigned int                    dot = 0) {
+    const CompactGrammar& cg = slr1.analysis_->cg_;
+    for (std::uint32_t p : cg.ProductionsOf(cg.st_.Id(antecedent))) {
+        std::vector<std::string> rhs;
+        for (SymbolId symbol : cg.Rhs(p)) {
+            rhs.push_back(cg.st_.Name(symbol));
+        }
+        if (rhs == consequent) {
+            return {cg, p, dot};
+        }
+    }
+    throw std::invalid_argument("Production not in grammar: " + antecedent);
+}
+
 void SortProductions(Grammar& grammar) {
     for (auto& [nt, productions] : grammar.g_) {
         std::sort(productions.begin(), productions.end());
@@ -59,6 +89,27 @@ TEST(GrammarTest, IsInfinite_WhenGrammarIsNotInfinite) {
     EXPECT_FALSE(result);
 }
 
+TEST(GrammarTest, SymbolKindIndexesAreStable) {
+    SymbolTable st;
+    const SymbolId a = st.PutSymbol("a", true);
+    const SymbolId A = st.Intern("A");
+    const SymbolId b = st.Intern("b", TERMINAL);
+    const SymbolId B = st.PutSymbol("B", false);
+    EXPECT_EQ(st.terminal_ids_,
+              (std::vector<SymbolId>{SymbolTable::EOL_ID_,
+                                     SymbolTable::EPSILON_ID_, a, b}));
+    EXPECT_EQ(st.non_terminal_ids_, (std::vector<SymbolId>{A, B}));
+    EXPECT_EQ(st.kind_index_[b], 3u);
+    EXPECT_EQ(st.kind_index_[B], 1u);
+
+    // Kinds are fixed once interned
+    EXPECT_EQ(st.Intern("b"), b);
+    EXPECT_TRUE(st.IsTerminal(b));
+    EXPECT_THROW(st.PutSymbol("A", true), std::invalid_argument);
+    EXPECT_THROW(st.PutSymbol("a", false), std::invalid_argument);
+    EXPECT_EQ(st.kind_index_[A], 0u);
+}
+
 TEST(GrammarTest, HasUnreachableSymbols_WhenGrammarHasUnreachableSymbols) {
     Grammar        g;
     GrammarFactory factory;
@@ -1041,6 +1092,843 @@ TEST(GrammarTest, LeftFactorize_SingleProduction) {
     EXPECT_EQ(g.g_, g_factorized.g_);
 }
 
+TEST(GrammarTest, FactorySeedReproducesGrammars) {
+    GrammarFactory first;
+    GrammarFactory second;
+    first.Init();
+    second.Init();
+    first.Seed(1234);
+    second.Seed(1234);
+
+    const Grammar lv7 = first.PickOne(7);
+    EXPECT_EQ(lv7.g_, second.PickOne(7).g_);
+    for (int level = 1; level <= 6; ++level) {
+        EXPECT_EQ(first.PickOne(level).g_, second.PickOne(level).g_);
+    }
+    EXPECT_EQ(first.GenLL1Grammar(3).g_, second.GenLL1Grammar(3).g_);
+    EXPECT_EQ(first.GenSLR1Grammar(3).g_, second.GenSLR1Grammar(3).g_);
+
+    // Seeding again restarts the sequence
+    first.Seed(1234);
+    EXPECT_EQ(first.PickOne(7).g_, lv7.g_);
+    EXPECT_EQ(first.seed_, 1234U);
+}
+
+TEST(GrammarTest, PhiloxEngineMatchesReferenceVectors) {
+    // Known answers of Philox4x32-10 from the Random123 distribution
+    EXPECT_EQ(PhiloxEngine::Block({0, 0}, {0, 0, 0, 0}),
+              (PhiloxEngine::counter{0x6627e8d5, 0xe169c58d, 0xbc57ac4c,
+                                     0x9b00dbd8}));
+    EXPECT_EQ(PhiloxEngine::Block({0xa4093822, 0x299f31d0},
+                                  {0x243f6a88, 0x85a308d3, 0x13198a2e,
+                                   0x03707344}),
+              (PhiloxEngine::counter{0xd16cfe09, 0x94fdcceb, 0x5001e420,
+                                     0x24126ea1}));
+
+    PhiloxEngine sequential(7, 3);
+    for (int i = 0; i < 11; ++i) {
+        sequential();
+    }
+    PhiloxEngine skipped(7, 3);
+    skipped.Discard(11);
+    EXPECT_EQ(sequential(), skipped());
+}
+
+TEST(GrammarTest, FactoryIndexedGrammarsDoNotDependOnOrder) {
+    GrammarFactory forward;
+    GrammarFactory backward;
+    forward.Init();
+    backward.Init();
+    forward.Seed(99);
+    backward.Seed(99);
+
+    std::vector<Grammar> grammars;
+    for (std::uint64_t k = 0; k < 8; ++k) {
+        grammars.push_back(forward.PickOne(5, k));
+    }
+    for (std::uint64_t k = 8; k-- > 0;) {
+        EXPECT_EQ(backward.PickOne(5, k).g_, grammars[k].g_);
+    }
+
+    // Stream 0 is the sequence read right after seeding
+    backward.Seed(99);
+    EXPECT_EQ(backward.PickOne(5).g_, grammars[0].g_);
+    EXPECT_EQ(forward.GenSLR1Grammar(3, 42).g_,
+              backward.GenSLR1Grammar(3, 42).g_);
+}
+
+TEST(GrammarTest, FactoryComposesLevelsBeyondSeven) {
+    GrammarFactory factory;
+    factory.Init();
+    factory.Seed(5);
+
+    for (int level = 1; level <= 10; ++level) {
+        const GrammarFactory::composition c  = factory.Compose(level);
+        const Grammar                     gr = c.ToGrammar();
+        // Every level adds one non-terminal to the axiom
+        EXPECT_EQ(gr.g_.size(), static_cast<std::size_t>(level) + 1);
+        // The terminals kept up to date by the steps are the ones in the rules
+        std::unordered_set<std::string> terminals;
+        for (SymbolId t : c.terminals_) {
+            terminals.insert(c.rules_.st_.Name(t));
+        }
+        EXPECT_EQ(terminals, gr.st_.terminals_wtho_eol_);
+    }
+
+    const Grammar lv10 = factory.PickOne(10);
+    EXPECT_TRUE(lv10.g_.contains("G"));
+    EXPECT_TRUE(lv10.g_.contains("N8"));
+    EXPECT_TRUE(lv10.g_.contains("N10"));
+}
+
+TEST(GrammarTest, FactoryUndoComposeStepRestoresComposition) {
+    GrammarFactory factory;
+    factory.Init();
+    factory.Seed(8);
+    GrammarFactory::composition base = factory.Compose(7);
+    for (int i = 0; i < 20; ++i) {
+        const GrammarFactory::composition before = base;
+        const std::size_t cmb = i % factory.catalog_->items.size();
+        GrammarFactory::step_undo undo;
+        factory.ApplyComposeStep(base, cmb, 8,
+                                 factory.DrawStepChoice(base, cmb), &undo);
+        EXPECT_NE(base.rules_.symbols_, before.rules_.symbols_);
+        factory.UndoComposeStep(base, undo);
+        EXPECT_EQ(base.rules_.symbols_, before.rules_.symbols_);
+        EXPECT_EQ(base.rules_.rhs_offsets_, before.rules_.rhs_offsets_);
+        EXPECT_EQ(base.rules_.lhs_, before.rules_.lhs_);
+        EXPECT_EQ(base.terminals_, before.terminals_);
+        EXPECT_EQ(base.items_, before.items_);
+        EXPECT_EQ(base.ToGrammar().g_, before.ToGrammar().g_);
+    }
+}
+
+TEST(GrammarTest, FactoryLv2CatalogVerdictsMatchChecks) {
+    GrammarFactory factory;
+    factory.Init();
+    const GrammarFactory::catalog& cat = *factory.catalog_;
+    ASSERT_FALSE(cat.lv2_catalog_.empty());
+
+    for (const GrammarFactory::catalog_entry& entry : cat.lv2_catalog_) {
+        Grammar gr = entry.rules_.ToGrammar();
+        EXPECT_EQ(factory.IsAcceptedSLR1(gr), entry.slr1_);
+        if (entry.ll1_ != GrammarFactory::NOT_LL1) {
+            factory.ApplyLL1Fix(gr, entry.ll1_);
+            EXPECT_TRUE(LL1Parser(gr).CreateLL1Table());
+        }
+    }
+    EXPECT_TRUE(LL1Parser(factory.GenLL1Grammar(2)).CreateLL1Table());
+    EXPECT_TRUE(factory.IsAcceptedSLR1(factory.GenSLR1Grammar(2)));
+}
+
+TEST(GrammarTest, FactoryCanonicalizeMergesRenamedTerminals) {
+    GrammarFactory factory;
+    factory.Init();
+
+    GrammarFactory::composition first = factory.Composition(
+        {{"A", {{"d", "B", "A"}, {"EPSILON"}}}, {"B", {{"b", "B"}, {"d"}}}});
+    GrammarFactory::composition renamed = factory.Composition(
+        {{"A", {{"EPSILON"}, {"k", "B", "A"}}}, {"B", {{"k"}, {"a", "B"}}}});
+    GrammarFactory::composition other = factory.Composition(
+        {{"A", {{"d", "B", "A"}, {"EPSILON"}}}, {"B", {{"b", "B"}, {"b"}}}});
+
+    const std::string key = factory.Canonicalize(first);
+    EXPECT_EQ(factory.Canonicalize(renamed), key);
+    EXPECT_NE(factory.Canonicalize(other), key);
+    EXPECT_EQ(first.ToGrammar().g_, renamed.ToGrammar().g_);
+    const SymbolTable& st = first.rules_.st_;
+    EXPECT_EQ(first.terminals_,
+              (std::vector<SymbolId>{SymbolTable::EPSILON_ID_, st.Id("a"),
+                                     st.Id("b")}));
+}
+
+TEST(GrammarTest, FactoryIndexClassifiesEveryLevel2Grammar) {
+    GrammarFactory factory;
+    factory.Init();
+    ASSERT_NE(factory.IndexOf(1), nullptr);
+    ASSERT_NE(factory.IndexOf(2), nullptr);
+    EXPECT_EQ(factory.IndexOf(3), nullptr);
+
+    const GrammarFactory::grammar_index& index = *factory.IndexOf(2);
+    EXPECT_LT(index.grammars_.size(), factory.catalog_->lv2_catalog_.size());
+    std::unordered_set<std::string> keys;
+    for (const GrammarFactory::catalog_entry& entry : index.grammars_) {
+        GrammarFactory::composition rules = entry.rules_;
+        EXPECT_TRUE(keys.insert(factory.Canonicalize(rules)).second);
+        Grammar gr = entry.rules_.ToGrammar();
+        EXPECT_EQ(factory.IsAcceptedSLR1(gr), entry.slr1_);
+        EXPECT_EQ(factory.MakeLL1(gr), entry.ll1_);
+    }
+    EXPECT_FALSE(index.ll1_.empty());
+    EXPECT_FALSE(index.slr1_.empty());
+
+    // Requests are drawn from the index, with their terminals renamed
+    factory.Seed(9);
+    bool renamed = false;
+    for (int draw = 0; draw < 20; ++draw) {
+        const Grammar drawn = factory.GenSLR1Grammar(2);
+        EXPECT_TRUE(std::ranges::any_of(index.slr1_, [&](std::uint32_t i) {
+            return CanonicalForm(index.grammars_[i].rules_.ToGrammar()) ==
+                   CanonicalForm(drawn);
+        }));
+        for (const auto& [nt, prods] : drawn.g_) {
+            for (const std::vector<std::string>& prod : prods) {
+                renamed |= std::ranges::any_of(prod, [](const auto& symbol) {
+                    return symbol.size() == 1 && symbol[0] > 'd' &&
+                           symbol[0] <= 'z';
+                });
+            }
+        }
+    }
+    EXPECT_TRUE(renamed);
+}
+
+TEST(GrammarTest, FactoryConstructiveLL1GrammarsAreLL1AsIs) {
+    GrammarFactory factory;
+    factory.Init();
+    factory.Seed(11);
+    for (int level = 1; level <= 6; ++level) {
+        for (int i = 0; i < 5; ++i) {
+            Grammar gr = factory.GenLL1GrammarByConstruction(level);
+            EXPECT_TRUE(gr.g_.contains(factory.NonTerminalName(level)));
+            Grammar copy = gr;
+            EXPECT_EQ(factory.MakeLL1(copy), GrammarFactory::AS_IS);
+            EXPECT_EQ(copy.g_, gr.g_);
+        }
+    }
+}
+
+TEST(GrammarTest, TryGenLL1GrammarByConstructionStopsAtLimits) {
+    GrammarFactory factory;
+    factory.Init();
+    factory.Seed(3);
+    GrammarFactory::generation_result result =
+        factory.TryGenLL1GrammarByConstruction(5, {.max_attempts_ = 50});
+    ASSERT_EQ(result.status_, GrammarFactory::GENERATED);
+    EXPECT_EQ(factory.MakeLL1(result.grammar_), GrammarFactory::AS_IS);
+
+    // Every restart is an attempt that the limits see
+    result = factory.TryGenLL1GrammarByConstruction(15, {.max_attempts_ = 2});
+    if (result.status_ != GrammarFactory::GENERATED) {
+        EXPECT_EQ(result.status_, GrammarFactory::OUT_OF_ATTEMPTS);
+        EXPECT_EQ(result.attempts_, 2u);
+        EXPECT_EQ(result.rejections_[GrammarFactory::REJECTED_CONFLICT], 2u);
+    }
+    std::stop_source source;
+    source.request_stop();
+    result = factory.TryGenLL1GrammarByConstruction(
+        15, {.stop_ = source.get_token()});
+    EXPECT_EQ(result.status_, GrammarFactory::CANCELLED);
+    EXPECT_EQ(result.attempts_, 0u);
+}
+
+TEST(GrammarTest, FactoryIncrementalLL1CheckMatchesFullCheck) {
+    GrammarFactory factory;
+    factory.Init();
+    factory.Seed(17);
+    const GrammarFactory::catalog&        cat = *factory.catalog_;
+    std::uniform_int_distribution<size_t> dist(0, cat.items.size() - 1);
+    const auto same_sets = [](const GrammarFactory::ll1_construction& a,
+                              const GrammarFactory::ll1_construction& b) {
+        EXPECT_EQ(a.sets_.nullable_, b.sets_.nullable_);
+        EXPECT_TRUE(a.sets_.first_ == b.sets_.first_);
+        EXPECT_TRUE(a.sets_.follow_ == b.sets_.follow_);
+        EXPECT_TRUE(a.sets_.suffix_first_ == b.sets_.suffix_first_);
+        EXPECT_EQ(a.occurrences_, b.occurrences_);
+    };
+    int accepted = 0;
+    int rejected = 0;
+    for (int start = 0; start < 20; ++start) {
+        GrammarFactory::ll1_construction state;
+        ASSERT_TRUE(factory.InitLL1Sets(
+            cat.lv2_catalog_[cat.lv2_ll1_as_is_.Sample(factory.rng_)].rules_,
+            state));
+        GrammarFactory::ll1_undo undo;
+        for (int level = 3; level <= 9; ++level) {
+            for (int attempt = 0; attempt < 20; ++attempt) {
+                const std::size_t cmb = dist(factory.rng_);
+                const GrammarFactory::step_choice choice =
+                    factory.DrawStepChoice(state.rules_, cmb);
+                const Grammar before = state.rules_.ToGrammar();
+                const bool    ll1 =
+                    factory.ApplyLL1Step(state, cmb, level, choice, undo);
+                Grammar gr = state.rules_.ToGrammar();
+                ASSERT_EQ(ll1, factory.IsLL1AsIs(gr));
+                GrammarFactory::ll1_construction fresh;
+                factory.InitLL1Sets(state.rules_, fresh);
+                same_sets(state, fresh);
+                if (ll1) {
+                    ++accepted;
+                    break;
+                }
+                // Undone, the sets are those of the grammar before the step
+                factory.UndoLL1Step(state, undo);
+                EXPECT_EQ(state.rules_.ToGrammar().g_, before.g_);
+                EXPECT_TRUE(factory.InitLL1Sets(state.rules_, fresh));
+                same_sets(state, fresh);
+                ++rejected;
+            }
+        }
+    }
+    EXPECT_GT(accepted, 0);
+    EXPECT_GT(rejected, 0);
+}
+
+TEST(GrammarTest, FactorySLR1CompatibilityMatchesLevel2Compositions) {
+    GrammarFactory factory;
+    factory.Init();
+    const GrammarFactory::catalog& cat = *factory.catalog_;
+    ASSERT_EQ(cat.slr1_compatible_.size(), cat.items.size());
+    std::size_t incompatible = 0;
+    for (std::size_t first = 0; first < cat.items.size(); ++first) {
+        const GrammarFactory::composition base =
+            factory.ItemComposition(first);
+        for (std::size_t cmb = 0; cmb < cat.items.size(); ++cmb) {
+            std::map<SymbolId, bool> expected;
+            factory.ForEachStepChoice(
+                base, cmb,
+                [&](const GrammarFactory::step_choice& choice, std::uint64_t) {
+                    GrammarFactory::composition rules = base;
+                    factory.ApplyComposeStep(rules, cmb, 2, choice);
+                    const bool slr1 = factory.IsAcceptedSLR1(rules.ToGrammar());
+                    for (SymbolId t : base.terminals_) {
+                        const SymbolId renamed =
+                            t == base.terminals_[choice.to_terminal_]
+                                ? choice.new_terminal_
+                                : t;
+                        if (renamed == factory.StepNonTerminal(base, choice)) {
+                            expected[t] = expected[t] || slr1;
+                        }
+                    }
+                });
+            for (const auto& [t, compatible] : expected) {
+                EXPECT_EQ(cat.slr1_compatible_[first].at(t)[cmb], compatible);
+                incompatible += !compatible;
+            }
+        }
+    }
+    EXPECT_GT(incompatible, 0);
+
+    // The start of a composition is always SLR(1)
+    factory.Seed(4);
+    ASSERT_GT(cat.lv2_slr1_.Size(), 0u);
+    for (int i = 0; i < 50; ++i) {
+        EXPECT_TRUE(
+            cat.lv2_catalog_[cat.lv2_slr1_.Sample(factory.rng_)].slr1_);
+    }
+
+    // Composed grammars only take compatible steps
+    for (int i = 0; i < 20; ++i) {
+        GrammarFactory::composition rules;
+        ASSERT_TRUE(factory.ComposeSLR1(5, rules));
+        EXPECT_TRUE(
+            rules.ToGrammar().g_.contains(factory.NonTerminalName(5)));
+        EXPECT_EQ(rules.items_.size(), 5u);
+    }
+}
+
+TEST(GrammarTest, FactoryBatchMatchesIndexedGeneration) {
+    GrammarFactory factory;
+    factory.Init();
+    factory.Seed(12);
+    for (GrammarFactory::grammar_class type :
+         {GrammarFactory::LL1_GRAMMAR, GrammarFactory::SLR1_GRAMMAR}) {
+        std::map<std::uint64_t, Grammar> batch;
+        factory.GenerateBatch(type, 4, 24, 4,
+                              [&](std::uint64_t index, const Grammar& gr) {
+                                  EXPECT_TRUE(batch.emplace(index, gr).second);
+                                  return true;
+                              });
+        ASSERT_EQ(batch.size(), 24u);
+        for (auto& [index, gr] : batch) {
+            const Grammar expected = type == GrammarFactory::LL1_GRAMMAR
+                                         ? factory.GenLL1Grammar(4, index)
+                                         : factory.GenSLR1Grammar(4, index);
+            EXPECT_EQ(gr.g_, expected.g_);
+        }
+    }
+
+    // A sink that refuses stops every thread
+    std::size_t calls = 0;
+    factory.GenerateBatch(GrammarFactory::SLR1_GRAMMAR, 3, 1000, 4,
+                          [&](std::uint64_t, const Grammar&) {
+                              ++calls;
+                              return false;
+                          });
+    EXPECT_EQ(calls, 1u);
+}
+
+TEST(GrammarTest, FactoriesShareOneCatalogAcrossThreads) {
+    GrammarFactory factory;
+    factory.Init();
+    factory.Seed(21);
+    std::vector<std::vector<Grammar>> results(4);
+    std::vector<std::thread>          threads;
+    for (std::uint64_t t = 0; t < results.size(); ++t) {
+        threads.emplace_back([&, t] {
+            GrammarFactory context(factory.catalog_);
+            context.Seed(21);
+            for (std::uint64_t i = 0; i < 5; ++i) {
+                results[t].push_back(context.GenLL1Grammar(4, t * 5 + i));
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    for (std::uint64_t t = 0; t < results.size(); ++t) {
+        for (std::uint64_t i = 0; i < 5; ++i) {
+            EXPECT_EQ(results[t][i].g_,
+                      factory.GenLL1Grammar(4, t * 5 + i).g_);
+        }
+    }
+
+    // BuildIndex gives the factory a new catalog, and leaves the shared one
+    const std::shared_ptr<const GrammarFactory::catalog> shared =
+        factory.catalog_;
+    const GrammarFactory context(shared);
+    factory.BuildIndex(1);
+    EXPECT_NE(factory.catalog_, shared);
+    EXPECT_EQ(context.catalog_, shared);
+    EXPECT_EQ(factory.catalog_->items.size(), shared->items.size());
+
+    // EnsureIndex keeps built indices, and skips levels it cannot index
+    const std::shared_ptr<const GrammarFactory::catalog> indexed =
+        factory.catalog_;
+    factory.EnsureIndex(1);
+    factory.EnsureIndex(GrammarFactory::MAX_INDEXED_LEVEL_ + 1);
+    EXPECT_EQ(factory.catalog_, indexed);
+}
+
+TEST(GrammarTest, TryGenStopsAtLimits) {
+    GrammarFactory factory;
+    factory.Init();
+    factory.Seed(23);
+
+    // Level 7 rejects most LL(1) draws, so 3 attempts are not enough
+    GrammarFactory::generation_result result =
+        factory.TryGenLL1Grammar(7, {.max_attempts_ = 3});
+    EXPECT_EQ(result.status_, GrammarFactory::OUT_OF_ATTEMPTS);
+    EXPECT_EQ(result.attempts_, 3u);
+    EXPECT_EQ(result.rejections_[GrammarFactory::REJECTED_INFINITE] +
+                  result.rejections_[GrammarFactory::REJECTED_UNREACHABLE] +
+                  result.rejections_[GrammarFactory::REJECTED_CONFLICT],
+              3u);
+    EXPECT_FALSE(result.grammar_.g_.empty());
+
+    result = factory.TryGenSLR1Grammar(
+        5, {.deadline_ = std::chrono::steady_clock::now()});
+    EXPECT_EQ(result.status_, GrammarFactory::TIMED_OUT);
+    EXPECT_EQ(result.attempts_, 0u);
+    EXPECT_TRUE(result.grammar_.g_.empty());
+
+    std::stop_source source;
+    source.request_stop();
+    result = factory.TryGenLL1Grammar(5, {.stop_ = source.get_token()});
+    EXPECT_EQ(result.status_, GrammarFactory::CANCELLED);
+    EXPECT_EQ(result.attempts_, 0u);
+
+    // Every SLR(1) start is an attempt, whether it is composed or not
+    result = factory.TryGenSLR1Grammar(15, {.max_attempts_ = 2});
+    if (result.status_ != GrammarFactory::GENERATED) {
+        EXPECT_EQ(result.status_, GrammarFactory::OUT_OF_ATTEMPTS);
+        EXPECT_EQ(result.attempts_, 2u);
+        EXPECT_FALSE(result.grammar_.g_.empty());
+    }
+
+    // Indexed levels never reject
+    result = factory.TryGenSLR1Grammar(2, {.max_attempts_ = 1});
+    EXPECT_EQ(result.status_, GrammarFactory::GENERATED);
+    EXPECT_EQ(result.attempts_, 1u);
+    EXPECT_TRUE(factory.IsAcceptedSLR1(result.grammar_));
+}
+
+TEST(GrammarTest, FactoryStatsCountAttemptsAndStages) {
+    GrammarFactory factory;
+    factory.Init();
+    factory.Seed(24);
+    EXPECT_EQ(factory.stats_.attempts_, 0u);
+    EXPECT_EQ(factory.stats_.stages_[GrammarFactory::ANALYSIS_STAGE].runs_,
+              0u);
+
+    const GrammarFactory::generation_result result =
+        factory.TryGenLL1Grammar(5, {.max_attempts_ = 20});
+    const GrammarFactory::generation_stats stats = factory.stats_;
+    EXPECT_EQ(stats.attempts_, result.attempts_);
+    EXPECT_EQ(stats.generated_,
+              result.status_ == GrammarFactory::GENERATED ? 1u : 0u);
+    EXPECT_EQ(stats.rejections_, result.rejections_);
+    EXPECT_EQ(stats.ll1_fixes_[GrammarFactory::AS_IS] +
+                  stats.ll1_fixes_[GrammarFactory::REMOVE_LEFT_RECURSION] +
+                  stats.ll1_fixes_[GrammarFactory::LEFT_FACTORIZE],
+              stats.generated_);
+    EXPECT_EQ(stats.ll1_fixes_[GrammarFactory::NOT_LL1],
+              stats.attempts_ - stats.generated_);
+    EXPECT_EQ(stats.stages_[GrammarFactory::DRAW_STAGE].runs_,
+              stats.attempts_);
+    // Checks after the first rejection of a candidate do not run
+    for (GrammarFactory::check_stage stage :
+         {GrammarFactory::DRAW_STAGE, GrammarFactory::ANALYSIS_STAGE,
+          GrammarFactory::INFINITE_STAGE}) {
+        const GrammarFactory::stage_stats& st = stats.stages_[stage];
+        EXPECT_LE(st.runs_, stats.attempts_);
+        EXPECT_EQ(std::accumulate(st.buckets_.begin(), st.buckets_.end(),
+                                  std::uint64_t{0}),
+                  st.runs_);
+    }
+    EXPECT_GE(stats.stages_[GrammarFactory::INFINITE_STAGE].failures_,
+              stats.rejections_[GrammarFactory::REJECTED_INFINITE]);
+    EXPECT_EQ(stats.stages_[GrammarFactory::SLR1_AUTOMATON_STAGE].runs_, 0u);
+
+    GrammarFactory::stage_stats timing;
+    timing.Record(1000, false);
+    timing.Record(3, true);
+    EXPECT_EQ(timing.failures_, 1u);
+    EXPECT_EQ(timing.total_ns_, 1003u);
+    EXPECT_EQ(timing.Quantile(0.0), 3u);
+    EXPECT_EQ(timing.Quantile(1.0), 1023u);
+}
+
+TEST(GrammarTest, CheckOrderPutsCheapSelectiveChecksFirst) {
+    CheckOrder order({0, 1});
+    for (std::uint64_t c = 0; c < CheckOrder::REORDER_PERIOD_; ++c) {
+        EXPECT_EQ(order.Order(), (std::vector<std::uint8_t>{0, 1}));
+        // Check 0 is slow and seldom rejects, check 1 is fast and often does
+        order.Record(0, 50000, c % 8 == 0);
+        order.Record(1, 500, c % 2 == 0);
+        order.FinishCandidate();
+    }
+    EXPECT_LT(order.Rank(1), order.Rank(0));
+    EXPECT_EQ(order.Order(), (std::vector<std::uint8_t>{1, 0}));
+}
+
+TEST(GrammarTest, RejectionReasonIgnoresCheckOrder) {
+    // Infinite, and directly left-recursive
+    const Grammar g({{"A", {{"A", "a"}}}});
+    for (std::vector<std::uint8_t> checks :
+         {std::vector<std::uint8_t>{GrammarFactory::LEFT_RECURSION_STAGE,
+                                    GrammarFactory::LL1_TABLE_STAGE,
+                                    GrammarFactory::UNREACHABLE_STAGE,
+                                    GrammarFactory::INFINITE_STAGE},
+          std::vector<std::uint8_t>{GrammarFactory::INFINITE_STAGE,
+                                    GrammarFactory::UNREACHABLE_STAGE,
+                                    GrammarFactory::LEFT_RECURSION_STAGE,
+                                    GrammarFactory::LL1_TABLE_STAGE}}) {
+        GrammarFactory factory;
+        factory.ll1_checks_ = CheckOrder(checks);
+        Grammar                          gr = g;
+        GrammarFactory::rejection_reason reason =
+            GrammarFactory::REJECTED_CONFLICT;
+        EXPECT_NE(factory.MakeLL1(gr, reason), GrammarFactory::AS_IS);
+        EXPECT_EQ(reason, GrammarFactory::REJECTED_INFINITE);
+    }
+}
+
+TEST(GrammarTest, GrammarPoolServesReadyGrammars) {
+    GrammarFactory factory;
+    factory.Init();
+    factory.Seed(22);
+    GrammarPool pool(factory.catalog_, 22,
+                     {{GrammarFactory::LL1_GRAMMAR, 2},
+                      {GrammarFactory::SLR1_GRAMMAR, 3}},
+                     {.low_watermark_  = 2,
+                      .high_watermark_ = 4,
+                      .threads_        = 2});
+    ASSERT_TRUE(pool.WaitFull(std::chrono::seconds(60)));
+
+    // The pool indexed Level 3 for itself
+    EXPECT_EQ(factory.IndexOf(3), nullptr);
+    factory.EnsureIndex(3);
+    for (int i = 0; i < 3; ++i) {
+        const auto ll1 = pool.TryTake(GrammarFactory::LL1_GRAMMAR, 2);
+        ASSERT_NE(ll1, nullptr);
+        ASSERT_TRUE(ll1->ll1_.has_value());
+        EXPECT_FALSE(ll1->ll1_->ll1_t_.empty());
+        EXPECT_EQ(ll1->grammar_.g_,
+                  factory.GenLL1Grammar(2, ll1->index_).g_);
+
+        const auto slr1 = pool.TryTake(GrammarFactory::SLR1_GRAMMAR, 3);
+        ASSERT_NE(slr1, nullptr);
+        ASSERT_TRUE(slr1->slr1_.has_value());
+        EXPECT_FALSE(slr1->slr1_->states_.empty());
+        // The SLR(1) parser augments the grammar it was made from
+        Grammar expected = factory.GenSLR1Grammar(3, slr1->index_);
+        expected.TransformToAugmentedGrammar();
+        EXPECT_EQ(slr1->grammar_.g_, expected.g_);
+    }
+    EXPECT_EQ(pool.TryTake(GrammarFactory::LL1_GRAMMAR, 5), nullptr);
+
+    // Going below the low watermark refills the pool
+    ASSERT_TRUE(pool.WaitFull(std::chrono::seconds(60)));
+    const pool_stats stats = pool.Stats(GrammarFactory::LL1_GRAMMAR, 2);
+    EXPECT_EQ(stats.hits_ + stats.misses_, 3u);
+    EXPECT_EQ(stats.refills_, 2u);
+    EXPECT_EQ(stats.size_, 4u);
+    EXPECT_GE(stats.generated_, 7u);
+    EXPECT_THROW(pool.Stats(GrammarFactory::SLR1_GRAMMAR, 2),
+                 std::out_of_range);
+    EXPECT_THROW(GrammarPool(factory.catalog_, 0, {}, {.high_watermark_ = 0}),
+                 std::invalid_argument);
+}
+
+TEST(GrammarTest, GrammarPoolStopsDuringSlowGeneration) {
+    GrammarFactory factory;
+    factory.Init();
+    const auto start = std::chrono::steady_clock::now();
+    {
+        // LL(1) grammars of Level 12 take far longer than the test
+        GrammarPool pool(factory.catalog_, 0,
+                         {{GrammarFactory::LL1_GRAMMAR, 12}}, {});
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        EXPECT_EQ(pool.TryTake(GrammarFactory::LL1_GRAMMAR, 12), nullptr);
+    }
+    EXPECT_LT(std::chrono::steady_clock::now() - start,
+              std::chrono::seconds(5));
+}
+
+TEST(GrammarTest, CanonicalFormIgnoresRenaming) {
+    const Grammar g({{"A", {{"a", "B"}, {"B", "c"}}},
+                     {"B", {{"b", "B"}, {"EPSILON"}}}});
+    // B -> Y, a -> x, b -> z, c -> w, productions in another order
+    const Grammar renamed({{"A", {{"Y", "w"}, {"x", "Y"}}},
+                           {"Y", {{"EPSILON"}, {"z", "Y"}}}});
+    // Same shape, but the recursion is on the other side
+    const Grammar other({{"A", {{"a", "B"}, {"B", "c"}}},
+                         {"B", {{"B", "b"}, {"EPSILON"}}}});
+    EXPECT_EQ(CanonicalForm(g), CanonicalForm(renamed));
+    EXPECT_EQ(Fingerprint(g), Fingerprint(renamed));
+    EXPECT_NE(CanonicalForm(g), CanonicalForm(other));
+    EXPECT_NE(Fingerprint(g), Fingerprint(other));
+}
+
+TEST(GrammarTest, CanonicalLabelingKeepsNonTerminalsIfAsked) {
+    // A -> t B | B; B -> t' | EPSILON, over symbols A B t t' EPSILON
+    const canonical_input in{{0, 0, 1, 1},
+                             {{2, 1}, {1}, {3}, {4}},
+                             {NON_TERMINAL_ROLE, NON_TERMINAL_ROLE,
+                              TERMINAL_ROLE, TERMINAL_ROLE, EPSILON_ROLE}};
+    // The same with the terminals swapped, then with A and B swapped
+    const canonical_input terminals{{0, 0, 1, 1},
+                                    {{3, 1}, {1}, {2}, {4}},
+                                    in.kinds_};
+    const canonical_input non_terminals{{1, 1, 0, 0},
+                                        {{2, 0}, {0}, {3}, {4}},
+                                        in.kinds_};
+    const canonical_labeling labeling = CanonicalLabeling(in, true);
+    EXPECT_EQ(CanonicalLabeling(terminals, true).form_, labeling.form_);
+    EXPECT_NE(CanonicalLabeling(non_terminals, true).form_, labeling.form_);
+    EXPECT_EQ(CanonicalLabeling(non_terminals, false).form_,
+              CanonicalLabeling(in, false).form_);
+    // The renaming tells the terminals apart, and keeps A before B
+    EXPECT_NE(labeling.colors_[2], labeling.colors_[3]);
+    EXPECT_LT(labeling.colors_[0], labeling.colors_[1]);
+}
+
+TEST(GrammarTest, VerdictCacheEvictsAndPersists) {
+    VerdictCache cache(VerdictCache::SHARDS_);
+    // Fingerprints with the same `hi_` share a shard of one entry
+    const grammar_fingerprint first{0, 1};
+    const grammar_fingerprint second{VerdictCache::SHARDS_, 2};
+    const grammar_fingerprint other{1, 3};
+    cache.Store(first, {true, false, false, 0, 1});
+    cache.Store(other, {false, true, true, 2, 0});
+    EXPECT_TRUE(cache.Find(first).has_value());
+    cache.Store(second, {});
+    EXPECT_FALSE(cache.Find(first).has_value());
+    EXPECT_TRUE(cache.Find(second).has_value());
+    EXPECT_EQ(cache.Hits(), 2u);
+    EXPECT_EQ(cache.Misses(), 1u);
+
+    const std::string path = ::testing::TempDir() + "verdicts.bin";
+    cache.Save(path);
+    VerdictCache loaded(VerdictCache::DEFAULT_CAPACITY_);
+    ASSERT_TRUE(loaded.Load(path));
+    EXPECT_EQ(loaded.Size(), 2u);
+    const std::optional<grammar_verdicts> v = loaded.Find(other);
+    ASSERT_TRUE(v.has_value());
+    EXPECT_FALSE(v->infinite_);
+    EXPECT_TRUE(v->unreachable_);
+    EXPECT_TRUE(v->left_recursive_);
+    EXPECT_EQ(v->ll1_, 2);
+    EXPECT_EQ(v->slr1_, 0);
+    EXPECT_EQ(loaded.Find(second)->ll1_, grammar_verdicts::UNKNOWN_);
+    EXPECT_FALSE(loaded.Load(path + ".missing"));
+    std::ofstream(path) << std::string(64, 'x');
+    EXPECT_THROW(loaded.Load(path), std::runtime_error);
+}
+
+TEST(GrammarTest, FactoryVerdictCacheMatchesChecks) {
+    GrammarFactory factory;
+    factory.Init();
+    factory.verdict_cache_ = std::make_shared<VerdictCache>(1024);
+    factory.Seed(9);
+    for (std::uint64_t i = 0; i < 30; ++i) {
+        Grammar                gr   = factory.PickOne(4, i);
+        const grammar_verdicts v    = factory.Verdicts(gr, true, true);
+        Grammar                copy = gr;
+        EXPECT_EQ(v.ll1_, factory.MakeLL1(copy));
+        EXPECT_EQ(v.slr1_ == 1, factory.IsAcceptedSLR1(gr));
+        const grammar_verdicts again = factory.Verdicts(gr, true, true);
+        EXPECT_EQ(again.ll1_, v.ll1_);
+        EXPECT_EQ(again.slr1_, v.slr1_);
+    }
+    EXPECT_GE(factory.verdict_cache_->Hits(), 30u);
+
+    // The cache does not change what is generated
+    GrammarFactory plain;
+    plain.Init();
+    plain.Seed(9);
+    for (std::uint64_t i = 0; i < 5; ++i) {
+        EXPECT_EQ(factory.GenLL1Grammar(5, i).g_,
+                  plain.GenLL1Grammar(5, i).g_);
+        EXPECT_EQ(factory.GenSLR1Grammar(5, i).g_,
+                  plain.GenSLR1Grammar(5, i).g_);
+    }
+}
+
+TEST(GrammarTest, CorpusRoundTripsGrammarsAndFiltersSamples) {
+    GrammarFactory factory;
+    factory.Init();
+    factory.Seed(3);
+    std::vector<Grammar> grammars;
+    GrammarCorpusWriter  writer;
+    for (std::uint64_t k = 0; k < 20; ++k) {
+        Grammar                       gr  = factory.PickOne(2, k);
+        Grammar                       fix = gr;
+        const GrammarFactory::ll1_fix ll1 = factory.MakeLL1(fix);
+        // Transformed grammars declare new symbols and EPSILON
+        grammars.push_back(ll1 == GrammarFactory::NOT_LL1 ? gr : fix);
+        writer.Add(grammars.back(), 2, ll1, factory.IsAcceptedSLR1(gr));
+    }
+    for (std::uint64_t k = 0; k < 10; ++k) {
+        grammars.push_back(factory.GenSLR1Grammar(5, k));
+        Grammar fix = grammars.back();
+        writer.Add(grammars.back(), 5, factory.MakeLL1(fix), true);
+    }
+    const std::string path = ::testing::TempDir() + "grammar_corpus.bin";
+    writer.Write(path);
+
+    const GrammarCorpus corpus(path);
+    ASSERT_EQ(corpus.Size(), grammars.size());
+    for (std::uint32_t i = 0; i < corpus.Size(); ++i) {
+        const Grammar gr = corpus.At(i).ToGrammar();
+        EXPECT_EQ(gr.g_, grammars[i].g_);
+        EXPECT_EQ(gr.axiom_, grammars[i].axiom_);
+        EXPECT_EQ(gr.st_.names_, grammars[i].st_.names_);
+        EXPECT_EQ(gr.st_.terminal_ids_, grammars[i].st_.terminal_ids_);
+        EXPECT_EQ(gr.st_.non_terminal_ids_, grammars[i].st_.non_terminal_ids_);
+        EXPECT_EQ(gr.st_.terminals_wtho_eol_,
+                  grammars[i].st_.terminals_wtho_eol_);
+        EXPECT_EQ(gr.st_.non_terminals_, grammars[i].st_.non_terminals_);
+    }
+
+    EXPECT_EQ(corpus.Members(2, CORPUS_ANY).size(), 20);
+    EXPECT_TRUE(corpus.Members(3, CORPUS_ANY).empty());
+    PhiloxEngine rng(7);
+    for (int draw = 0; draw < 50; ++draw) {
+        const auto view = corpus.Sample(5, CORPUS_SLR1, rng);
+        ASSERT_TRUE(view.has_value());
+        EXPECT_EQ(view->Level(), 5);
+        EXPECT_TRUE(view->IsSLR1());
+        EXPECT_TRUE(factory.IsAcceptedSLR1(view->ToGrammar()));
+    }
+    for (std::uint32_t i : corpus.Members(2, CORPUS_LL1)) {
+        EXPECT_NE(corpus.At(i).LL1Fix(), GrammarFactory::NOT_LL1);
+    }
+}
+
+TEST(GrammarTest, CorpusRejectsOtherFiles) {
+    const std::string path = ::testing::TempDir() + "not_a_corpus.bin";
+    std::ofstream(path) << std::string(512, 'x');
+    EXPECT_THROW(GrammarCorpus{path}, std::runtime_error);
+    EXPECT_THROW(GrammarCorpus{path + ".missing"}, std::runtime_error);
+}
+
+TEST(GrammarTest, CorpusRejectsOutOfRangeIds) {
+    GrammarFactory factory;
+    factory.Init();
+    factory.Seed(3);
+    GrammarCorpusWriter writer;
+    for (std::uint64_t k = 0; k < 3; ++k) {
+        writer.Add(factory.GenSLR1Grammar(2, k), 2, GrammarFactory::NOT_LL1,
+                   true);
+    }
+    const std::string path = ::testing::TempDir() + "grammar_corpus_ids.bin";
+    writer.Write(path);
+    std::ifstream     in(path, std::ios::binary);
+    const std::string bytes((std::istreambuf_iterator<char>(in)),
+                            std::istreambuf_iterator<char>());
+    ASSERT_NO_THROW(GrammarCorpus{path});
+
+    // Overwrites the first u32 of a section with a value out of range
+    const auto corrupt = [&](corpus_section s) {
+        corpus_header header;
+        std::memcpy(&header, bytes.data(), sizeof(header));
+        std::string         copy = bytes;
+        const std::uint32_t bad  = UINT32_MAX;
+        std::memcpy(copy.data() + header.sections_[s].offset_, &bad,
+                    sizeof(bad));
+        const std::string bad_path = path + ".bad";
+        std::ofstream(bad_path, std::ios::binary) << copy;
+        return bad_path;
+    };
+    for (corpus_section s : {SECTION_SYMBOLS, SECTION_LHS, SECTION_RHS,
+                             SECTION_RHS_OFFSETS, SECTION_MEMBERS}) {
+        EXPECT_THROW(GrammarCorpus{corrupt(s)}, std::runtime_error) << s;
+    }
+}
+
+TEST(GrammarTest, CompactGrammar_ProductionRanges) {
+    Grammar g;
+
+    g.st_.PutSymbol("S", false);
+    g.st_.PutSymbol("A", false);
+    g.st_.PutSymbol("B", false);
+    g.st_.PutSymbol("a", true);
+    g.st_.PutSymbol("b", true);
+
+    g.axiom_ = "S";
+
+    g.AddProduction("S", {"A", g.st_.EOL_});
+    g.AddProduction("A", {"a", "B"});
+    g.AddProduction("A", {"B"});
+    g.AddProduction("B", {"b", "B"});
+    g.AddProduction("B", {g.st_.EPSILON_});
+
+    CompactGrammar cg(g);
+
+    EXPECT_EQ(cg.ProductionCount(), 5);
+    EXPECT_EQ(cg.symbols_.size(), 8);
+    EXPECT_EQ(cg.axiom_, g.AxiomId());
+    for (const auto& [nt, productions] : g.g_) {
+        const SymbolId id    = g.st_.Id(nt);
+        auto           range = cg.ProductionsOf(id);
+        ASSERT_EQ(range.size(), productions.size());
+        for (size_t i = 0; i < productions.size(); ++i) {
+            const std::uint32_t p = range[i];
+            EXPECT_EQ(cg.Lhs(p), id);
+            production rhs;
+            for (SymbolId symbol : cg.Rhs(p)) {
+                rhs.push_back(g.st_.Name(symbol));
+            }
+            EXPECT_EQ(rhs, productions[i]);
+        }
+    }
+    EXPECT_TRUE(cg.IsEpsilon(cg.ProductionsOf(g.st_.Id("B"))[1]));
+    EXPECT_TRUE(cg.ProductionsOf(g.st_.Id("a")).empty());
+}
+
+TEST(GrammarTest, CompactGrammar_RoundTrip) {
+    Grammar g({{"A", {{"a", "A", "B"}, {"EPSILON"}}}, {"B", {{"b"}}}});
+
+    Grammar back = CompactGrammar(g).ToGrammar();
+
+    EXPECT_EQ(back.g_, g.g_);
+    EXPECT_EQ(back.axiom_, g.axiom_);
+    EXPECT_EQ(back.st_.non_terminals_, g.st_.non_terminals_);
+    EXPECT_EQ(back.st_.terminals_, g.st_.terminals_);
+}
+
 TEST(LL1__Test, FirstSet) {
     Grammar g;
 
@@ -1487,6 +2375,7 @@ TEST(LL1__Test, AllFirstSets) {
 
     LL1Parser ll1(g);
 
+    std::unordered_map<std::string, std::unordered_set<std::string>> result;
     std::unordered_map<std::string, std::unordered_set<std::string>> expected{
         {"S", {"a", "b", "d", g.st_.EPSILON_}},
         {"A", {"a", "b", "d", g.st_.EPSILON_}},
@@ -1494,7 +2383,11 @@ TEST(LL1__Test, AllFirstSets) {
         {"C", {"d", g.st_.EPSILON_}},
         {"D", {"a", "d"}}};
 
-    EXPECT_EQ(ll1.first_sets_, expected);
+    for (const std::string& nt : g.st_.non_terminals_) {
+        ll1.First({{nt}}, result[nt]);
+    }
+
+    EXPECT_EQ(result, expected);
 }
 
 TEST(LL1__Test, FollowSet2) {
@@ -1781,6 +2674,200 @@ TEST(LL1__Test, AllFollowSets2) {
     EXPECT_EQ(result, expected);
 }
 
+TEST(LL1__Test, FirstAndFollowWithMoreThan64Terminals) {
+    std::vector<production> a_productions;
+    for (int i = 0; i < 70; ++i) {
+        a_productions.push_back({"t" + std::to_string(i), "B"});
+    }
+    Grammar g({{"A", a_productions}, {"B", {{"x"}, {"EPSILON"}}}});
+
+    LL1Parser ll1(g);
+    ASSERT_TRUE(std::holds_alternative<FirstFollow<DynamicTerminalSet>>(
+        ll1.analysis_->Sets()));
+
+    std::unordered_set<std::string> first;
+    ll1.First({{"A"}}, first);
+    EXPECT_EQ(first.size(), 70);
+    EXPECT_TRUE(first.contains("t69"));
+    EXPECT_EQ(ll1.Follow("B"), std::unordered_set<std::string>{g.st_.EOL_});
+    EXPECT_TRUE(ll1.CreateLL1Table());
+}
+
+TEST(LL1__Test, FirstSetsByComponentsMatchFixpoint) {
+    // A, B and C are mutually recursive through nullable prefixes
+    Grammar g({{"A", {{"B", "a"}, {"EPSILON"}}},
+               {"B", {{"C", "b"}, {"A", "c"}}},
+               {"C", {{"A", "B", "d"}, {"e"}, {"EPSILON"}}}});
+    CompactGrammar cg(g);
+
+    FirstFollow<SmallTerminalSet> components(cg);
+    components.ComputeFirstSets(cg);
+    FirstFollow<SmallTerminalSet> fixpoint(cg);
+    fixpoint.ComputeFirstSetsFixpoint(cg);
+
+    EXPECT_EQ(components.first_, fixpoint.first_);
+    EXPECT_EQ(components.first_stats_.cyclic_components_, 1);
+    EXPECT_LE(components.first_stats_.evaluations_,
+              fixpoint.first_stats_.evaluations_);
+    EXPECT_EQ(FirstFollow<SmallTerminalSet>::ToSymbols(
+                  cg, components.FirstOf(cg, cg.st_.Id("C"))),
+              (std::unordered_set<SymbolId>{cg.st_.Id("b"), cg.st_.Id("c"),
+                                            cg.st_.Id("e"),
+                                            SymbolTable::EPSILON_ID_}));
+}
+
+TEST(LL1__Test, FirstSetsOfAcyclicGrammarEvaluateEachProductionOnce) {
+    // A0 -> A1 | t0, ..., A19 -> x: the global fixpoint needs one pass per
+    // level when non-terminals are visited top-down
+    Grammar g;
+    g.axiom_ = "A0";
+    for (int i = 0; i < 20; ++i) {
+        g.st_.PutSymbol("A" + std::to_string(i), false);
+        g.st_.PutSymbol("t" + std::to_string(i), true);
+    }
+    g.st_.PutSymbol("x", true);
+    for (int i = 0; i < 19; ++i) {
+        g.AddProduction("A" + std::to_string(i),
+                        {"A" + std::to_string(i + 1)});
+        g.AddProduction("A" + std::to_string(i), {"t" + std::to_string(i)});
+    }
+    g.AddProduction("A19", {"x"});
+    CompactGrammar cg(g);
+
+    FirstFollow<SmallTerminalSet> components(cg);
+    components.ComputeFirstSets(cg);
+    FirstFollow<SmallTerminalSet> fixpoint(cg);
+    fixpoint.ComputeFirstSetsFixpoint(cg);
+
+    EXPECT_EQ(components.first_, fixpoint.first_);
+    EXPECT_EQ(components.first_stats_.evaluations_, cg.ProductionCount());
+    EXPECT_EQ(components.first_stats_.components_, 20);
+    EXPECT_EQ(components.first_stats_.cyclic_components_, 0);
+    EXPECT_GT(fixpoint.first_stats_.evaluations_,
+              10 * components.first_stats_.evaluations_);
+    EXPECT_EQ(components.FirstOf(cg, cg.st_.Id("A0")).Count(), 20);
+}
+
+TEST(LL1__Test, FollowSetsByDigraphMatchFixpoint) {
+    // B and C include each other's FOLLOW sets (a cycle of the includes
+    // relation), and D is followed by a nullable suffix
+    Grammar g({{"A", {{"B", "a"}, {"D", "C", "C"}}},
+               {"B", {{"x", "C"}, {"EPSILON"}}},
+               {"C", {{"y", "B"}, {"D"}}},
+               {"D", {{"z"}, {"EPSILON"}}}});
+    CompactGrammar cg(g);
+
+    FirstFollow<SmallTerminalSet> digraph(cg);
+    digraph.ComputeFirstSets(cg);
+    digraph.ComputeFollowSets(cg);
+    FirstFollow<SmallTerminalSet> fixpoint(cg);
+    fixpoint.ComputeFirstSets(cg);
+    fixpoint.ComputeFollowSetsFixpoint(cg);
+    EXPECT_EQ(digraph.follow_, fixpoint.follow_);
+    EXPECT_EQ(FirstFollow<SmallTerminalSet>::ToSymbols(
+                  cg, digraph.FollowOf(cg, cg.st_.Id("B"))),
+              (std::unordered_set<SymbolId>{cg.st_.Id("a"), cg.st_.Id("y"),
+                                            cg.st_.Id("z"),
+                                            SymbolTable::EOL_ID_}));
+
+    GrammarFactory factory;
+    factory.Init();
+    for (int i = 0; i < 50; ++i) {
+        Grammar        generated = factory.PickOne(7);
+        CompactGrammar generated_cg(generated);
+        terminal_sets  by_digraph  = MakeTerminalSets(generated_cg);
+        terminal_sets  by_fixpoint = by_digraph;
+        std::visit(
+            [&](auto& sets) {
+                sets.ComputeFirstSets(generated_cg);
+                sets.ComputeFollowSets(generated_cg);
+            },
+            by_digraph);
+        std::visit(
+            [&](auto& sets) {
+                sets.ComputeFirstSets(generated_cg);
+                sets.ComputeFollowSetsFixpoint(generated_cg);
+            },
+            by_fixpoint);
+        EXPECT_TRUE(std::visit(
+            [&](const auto& sets) {
+                using sets_type = std::decay_t<decltype(sets)>;
+                return sets.follow_ ==
+                       std::get<sets_type>(by_fixpoint).follow_;
+            },
+            by_digraph));
+    }
+}
+
+TEST(LL1__Test, SuffixFirstMatchesFirstOfEverySuffix) {
+    GrammarFactory factory;
+    factory.Init();
+    for (int i = 0; i < 50; ++i) {
+        Grammar         g  = factory.PickOne(i % 7 + 1);
+        GrammarAnalysis analysis(g);
+        std::visit(
+            [&](const auto& sets) {
+                const CompactGrammar& cg = analysis.cg_;
+                for (std::uint32_t p = 0; p < cg.ProductionCount(); ++p) {
+                    const std::span<const SymbolId> rhs = cg.Rhs(p);
+                    for (std::size_t pos = 0; pos <= rhs.size(); ++pos) {
+                        auto expected = sets.MakeSet();
+                        sets.First(cg, rhs.subspan(pos), expected);
+                        EXPECT_EQ(sets.SuffixFirst(cg, p, pos), expected);
+                    }
+                }
+            },
+            analysis.Sets());
+    }
+}
+
+TEST(LL1__Test, ParsersShareGrammarAnalysis) {
+    Grammar g({{"A", {{"a", "A"}, {"B"}}}, {"B", {{"b"}, {"EPSILON"}}}});
+    auto    analysis = std::make_shared<const GrammarAnalysis>(g);
+    EXPECT_EQ(analysis->CachedFacts(), 0);
+
+    GrammarFactory factory;
+    EXPECT_FALSE(factory.IsInfinite(*analysis));
+    EXPECT_EQ(analysis->CachedFacts(), 0);
+    // Left recursion through nullable prefixes needs the nullable symbols
+    factory.HasIndirectLeftRecursion(*analysis);
+    EXPECT_TRUE(analysis->IsCached(GrammarAnalysis::NULLABLE));
+    EXPECT_FALSE(analysis->IsCached(GrammarAnalysis::FIRST));
+
+    LL1Parser ll1(analysis);
+    EXPECT_FALSE(analysis->IsCached(GrammarAnalysis::FIRST));
+    EXPECT_TRUE(ll1.CreateLL1Table());
+    EXPECT_TRUE(analysis->IsCached(GrammarAnalysis::FIRST));
+    EXPECT_TRUE(analysis->IsCached(GrammarAnalysis::FOLLOW));
+
+    // The SLR(1) parser reads the sets computed for the LL(1) parser
+    SLR1Parser slr1(analysis);
+    EXPECT_TRUE(slr1.MakeParser());
+    EXPECT_EQ(&slr1.analysis_->Sets(), &ll1.analysis_->Sets());
+    EXPECT_EQ(slr1.Follow(g.st_.Id("B")),
+              std::unordered_set<SymbolId>{SymbolTable::EOL_ID_});
+    EXPECT_EQ(analysis->NullableSymbols(),
+              (std::unordered_set<SymbolId>{g.st_.Id("A"), g.st_.Id("B"),
+                                            g.st_.Id("S")}));
+}
+
+TEST(LL1__Test, IsLL1MatchesTable) {
+    GrammarFactory factory;
+    factory.Init();
+    factory.Seed(25);
+    for (int i = 0; i < 200; ++i) {
+        Grammar gr = factory.PickOne(1 + i % 3);
+        EXPECT_EQ(LL1Parser(gr).IsLL1(), LL1Parser(gr).CreateLL1Table());
+    }
+
+    // A FIRST/FIRST conflict is found without FOLLOW
+    Grammar g({{"A", {{"a", "B"}, {"a"}}}, {"B", {{"b"}}}});
+    auto    analysis = std::make_shared<const GrammarAnalysis>(g);
+    EXPECT_FALSE(LL1Parser(analysis).IsLL1());
+    EXPECT_TRUE(analysis->IsCached(GrammarAnalysis::FIRST));
+    EXPECT_FALSE(analysis->IsCached(GrammarAnalysis::FOLLOW));
+}
+
 TEST(SLR1_ClosureTest, BasicClosure) {
     Grammar g;
     g.st_.PutSymbol("S", false);
@@ -1801,16 +2888,16 @@ TEST(SLR1_ClosureTest, BasicClosure) {
 
     // Initial item: S -> •E EOL
     std::unordered_set<Lr0Item> items = {
-        {"S", {"E", g.st_.EOL_}, g.st_.EPSILON_, g.st_.EOL_}};
+        MakeItem(slr1, "S", {"E", g.st_.EOL_})};
 
     slr1.Closure(items);
 
     // Expected items after closure
     std::unordered_set<Lr0Item> expected = {
-        {"S", {"E", g.st_.EOL_}, g.st_.EPSILON_, g.st_.EOL_},
-        {"E", {"E", "+", "T"}, g.st_.EPSILON_, g.st_.EOL_},
-        {"E", {"T"}, g.st_.EPSILON_, g.st_.EOL_},
-        {"T", {"n"}, g.st_.EPSILON_, g.st_.EOL_}};
+        MakeItem(slr1, "S", {"E", g.st_.EOL_}),
+        MakeItem(slr1, "E", {"E", "+", "T"}),
+        MakeItem(slr1, "E", {"T"}),
+        MakeItem(slr1, "T", {"n"})};
 
     EXPECT_EQ(items, expected);
 }
@@ -1841,15 +2928,15 @@ TEST(SLR1_ClosureTest, ComplexGrammarWithNullable) {
     SLR1Parser slr1(g);
 
     std::unordered_set<Lr0Item> items = {
-        {"S", {"D", g.st_.EOL_}, g.st_.EPSILON_, g.st_.EOL_}};
+        MakeItem(slr1, "S", {"D", g.st_.EOL_})};
 
     slr1.Closure(items);
 
     std::unordered_set<Lr0Item> expected = {
-        {"S", {"D", g.st_.EOL_}, g.st_.EPSILON_, g.st_.EOL_},
-        {"D", {"A", "B", "C"}, g.st_.EPSILON_, g.st_.EOL_},
-        {"A", {"a", "A"}, g.st_.EPSILON_, g.st_.EOL_},
-        {"A", {g.st_.EPSILON_}, g.st_.EPSILON_, g.st_.EOL_}};
+        MakeItem(slr1, "S", {"D", g.st_.EOL_}),
+        MakeItem(slr1, "D", {"A", "B", "C"}),
+        MakeItem(slr1, "A", {"a", "A"}),
+        MakeItem(slr1, "A", {g.st_.EPSILON_})};
 
     EXPECT_EQ(items, expected);
 }
@@ -1880,12 +2967,12 @@ TEST(SLR1_ClosureTest, CompleteItemClosure) {
     SLR1Parser slr1(g);
 
     std::unordered_set<Lr0Item> items = {
-        {"A", {g.st_.EPSILON_}, g.st_.EPSILON_, g.st_.EOL_}};
+        MakeItem(slr1, "A", {g.st_.EPSILON_})};
 
     slr1.Closure(items);
 
     std::unordered_set<Lr0Item> expected = {
-        {"A", {g.st_.EPSILON_}, 1, g.st_.EPSILON_, g.st_.EOL_}    
+        MakeItem(slr1, "A", {g.st_.EPSILON_}, 1)    
     };
     
     EXPECT_EQ(items, expected);
@@ -1905,12 +2992,12 @@ TEST(SLR1_ClosureTest, NoAdditionalClosureNeeded) {
     SLR1Parser slr1(g);
 
     std::unordered_set<Lr0Item> items = {
-        {"S", {"a", g.st_.EOL_}, g.st_.EPSILON_, g.st_.EOL_}};
+        MakeItem(slr1, "S", {"a", g.st_.EOL_})};
 
     slr1.Closure(items);
 
     std::unordered_set<Lr0Item> expected = {
-        {"S", {"a", g.st_.EOL_}, g.st_.EPSILON_, g.st_.EOL_}};
+        MakeItem(slr1, "S", {"a", g.st_.EOL_})};
 
     EXPECT_EQ(items, expected);
 }
@@ -1935,13 +3022,13 @@ TEST(SLR1_ClosureTest, DotInMiddleOfProduction) {
 
     // Initial item: E -> E • + T
     std::unordered_set<Lr0Item> items = {
-        {"E", {"E", "+", "T"}, 1, g.st_.EPSILON_, g.st_.EOL_}};
+        MakeItem(slr1, "E", {"E", "+", "T"}, 1)};
 
     slr1.Closure(items);
 
     // Should not add any new items since the dot is before a terminal
     std::unordered_set<Lr0Item> expected = {
-        {"E", {"E", "+", "T"}, 1, g.st_.EPSILON_, g.st_.EOL_}};
+        MakeItem(slr1, "E", {"E", "+", "T"}, 1)};
 
     EXPECT_EQ(items, expected);
 }
@@ -1965,14 +3052,14 @@ TEST(SLR1_ClosureTest, DotBeforeNonTerminal) {
 
     // Initial item: S -> A • B EOL
     std::unordered_set<Lr0Item> items = {
-        {"S", {"A", "B", g.st_.EOL_}, 1, g.st_.EPSILON_, g.st_.EOL_}};
+        MakeItem(slr1, "S", {"A", "B", g.st_.EOL_}, 1)};
 
     slr1.Closure(items);
 
     // Should add productions for B since dot is before a non-terminal
     std::unordered_set<Lr0Item> expected = {
-        {"S", {"A", "B", g.st_.EOL_}, 1, g.st_.EPSILON_, g.st_.EOL_},
-        {"B", {"b"}, 0, g.st_.EPSILON_, g.st_.EOL_}};
+        MakeItem(slr1, "S", {"A", "B", g.st_.EOL_}, 1),
+        MakeItem(slr1, "B", {"b"}, 0)};
 
     EXPECT_EQ(items, expected);
 }
@@ -2004,22 +3091,22 @@ TEST(SLR1_ClosureTest, MultipleItemsWithDifferentDotPositions) {
 
     // Initial items with dots in different positions
     std::unordered_set<Lr0Item> items = {
-        {"E", {"E", "+", "T"}, 1, g.st_.EPSILON_, g.st_.EOL_}, // E -> E • + T
-        {"T", {"T", "*", "F"}, 0, g.st_.EPSILON_, g.st_.EOL_}, // T -> • T * F
-        {"F", {"(", "E", ")"}, 2, g.st_.EPSILON_, g.st_.EOL_}  // F -> ( E • )
+        MakeItem(slr1, "E", {"E", "+", "T"}, 1), // E -> E • + T
+        MakeItem(slr1, "T", {"T", "*", "F"}, 0), // T -> • T * F
+        MakeItem(slr1, "F", {"(", "E", ")"}, 2)  // F -> ( E • )
     };
 
     slr1.Closure(items);
 
     // Expected items after closure
     std::unordered_set<Lr0Item> expected = {
-        {"E", {"E", "+", "T"}, 1, g.st_.EPSILON_, g.st_.EOL_},
-        {"T", {"T", "*", "F"}, 0, g.st_.EPSILON_, g.st_.EOL_},
-        {"F", {"(", "E", ")"}, 2, g.st_.EPSILON_, g.st_.EOL_},
+        MakeItem(slr1, "E", {"E", "+", "T"}, 1),
+        MakeItem(slr1, "T", {"T", "*", "F"}, 0),
+        MakeItem(slr1, "F", {"(", "E", ")"}, 2),
         // From T -> • T * F
-        {"T", {"F"}, 0, g.st_.EPSILON_, g.st_.EOL_},
-        {"F", {"(", "E", ")"}, 0, g.st_.EPSILON_, g.st_.EOL_},
-        {"F", {"n"}, 0, g.st_.EPSILON_, g.st_.EOL_},
+        MakeItem(slr1, "T", {"F"}, 0),
+        MakeItem(slr1, "F", {"(", "E", ")"}, 0),
+        MakeItem(slr1, "F", {"n"}, 0),
         // From F -> ( E • )
     };
 
@@ -2045,13 +3132,13 @@ TEST(SLR1_ClosureTest, DotAtEndOfProduction) {
 
     // Initial item: A -> a •
     std::unordered_set<Lr0Item> items = {
-        {"A", {"a"}, 1, g.st_.EPSILON_, g.st_.EOL_}};
+        MakeItem(slr1, "A", {"a"}, 1)};
 
     slr1.Closure(items);
 
     // Should remain unchanged since dot is at the end
     std::unordered_set<Lr0Item> expected = {
-        {"A", {"a"}, 1, g.st_.EPSILON_, g.st_.EOL_}};
+        MakeItem(slr1, "A", {"a"}, 1)};
 
     EXPECT_EQ(items, expected);
 }
@@ -2081,31 +3168,27 @@ TEST(SLR1_ClosureTest, MixedDotPositionsWithNullableSymbols) {
 
     // Initial items with dots in different positions
     std::unordered_set<Lr0Item> items = {
-        {"S",
-         {"A", "B", "C", g.st_.EOL_},
-         1,
-         g.st_.EPSILON_,
-         g.st_.EOL_},                                     // S -> A • B C EOL
-        {"A", {"a", "A"}, 1, g.st_.EPSILON_, g.st_.EOL_}, // A -> a • A
-        {"B", {"b", "B"}, 0, g.st_.EPSILON_, g.st_.EOL_}  // B -> • b B
+        MakeItem(slr1, "S", {"A", "B", "C", g.st_.EOL_}, 1), // S -> A • B C EOL
+        MakeItem(slr1, "A", {"a", "A"}, 1),                  // A -> a • A
+        MakeItem(slr1, "B", {"b", "B"}, 0)                   // B -> • b B
     };
 
     slr1.Closure(items);
 
     // Expected items after closure
     std::unordered_set<Lr0Item> expected = {
-        {"S", {"A", "B", "C", g.st_.EOL_}, 1, g.st_.EPSILON_, g.st_.EOL_},
-        {"A", {"a", "A"}, 1, g.st_.EPSILON_, g.st_.EOL_},
-        {"B", {"b", "B"}, 0, g.st_.EPSILON_, g.st_.EOL_},
+        MakeItem(slr1, "S", {"A", "B", "C", g.st_.EOL_}, 1),
+        MakeItem(slr1, "A", {"a", "A"}, 1),
+        MakeItem(slr1, "B", {"b", "B"}, 0),
         // From S -> A • B C EOL
-        {"B", {"b", "B"}, 0, g.st_.EPSILON_, g.st_.EOL_},
-        {"B", {g.st_.EPSILON_}, 1, "C", g.st_.EOL_},
+        MakeItem(slr1, "B", {"b", "B"}, 0),
+        MakeItem(slr1, "B", {g.st_.EPSILON_}, 1),
         // From A -> a • A
-        {"A", {"a", "A"}, 0, g.st_.EPSILON_, g.st_.EOL_},
-        {"A", {g.st_.EPSILON_}, 1, g.st_.EPSILON_, g.st_.EOL_},
+        MakeItem(slr1, "A", {"a", "A"}, 0),
+        MakeItem(slr1, "A", {g.st_.EPSILON_}, 1),
         // From B -> • b B
-        {"B", {"b", "B"}, 0, g.st_.EPSILON_, g.st_.EOL_},
-        {"B", {g.st_.EPSILON_}, 1, g.st_.EPSILON_, g.st_.EOL_}};
+        MakeItem(slr1, "B", {"b", "B"}, 0),
+        MakeItem(slr1, "B", {g.st_.EPSILON_}, 1)};
 
     EXPECT_EQ(items, expected);
 }
@@ -2128,13 +3211,13 @@ TEST(SLR1_Delta, DeltaFunctionToBasicItemSet) {
     SLR1Parser slr1(g);
 
     std::unordered_set<Lr0Item> items = {
-        {"S", {"A", "B", g.st_.EOL_}, 0, g.st_.EPSILON_, g.st_.EOL_}};
+        MakeItem(slr1, "S", {"A", "B", g.st_.EOL_}, 0)};
 
     auto result = slr1.Delta(items, "A");
     
     std::unordered_set<Lr0Item> expected = {
-        {"S", {"A", "B", g.st_.EOL_}, 1, g.st_.EPSILON_, g.st_.EOL_},
-        {"B", {"b"}, g.st_.EPSILON_, g.st_.EOL_}};
+        MakeItem(slr1, "S", {"A", "B", g.st_.EOL_}, 1),
+        MakeItem(slr1, "B", {"b"})};
     
     EXPECT_EQ(result, expected);
 }
@@ -2157,7 +3240,7 @@ TEST(SLR1_Delta, DeltaFunctionWhenSymbolDoesNotExists) {
     SLR1Parser slr1(g);
 
     std::unordered_set<Lr0Item> items = {
-        {"S", {"A", "B", g.st_.EOL_}, 0, g.st_.EPSILON_, g.st_.EOL_}};
+        MakeItem(slr1, "S", {"A", "B", g.st_.EOL_}, 0)};
 
     auto result = slr1.Delta(items, "Z");
     
@@ -2184,7 +3267,7 @@ TEST(SLR1_Delta, DeltaFunctionWhenSymbolDoesNotExistsAndIsEpsilon) {
     SLR1Parser slr1(g);
 
     std::unordered_set<Lr0Item> items = {
-        {"S", {"A", "B", g.st_.EOL_}, 0, g.st_.EPSILON_, g.st_.EOL_}};
+        MakeItem(slr1, "S", {"A", "B", g.st_.EOL_}, 0)};
 
     auto result = slr1.Delta(items, g.st_.EPSILON_);
     
@@ -2217,7 +3300,7 @@ TEST(SLR1_Delta, DeltaFunctionWhenItemIsComplete) {
     SLR1Parser slr1(g);
 
     std::unordered_set<Lr0Item> items = {
-        {"A", {"a", "A"}, 2, g.st_.EPSILON_, g.st_.EOL_}};
+        MakeItem(slr1, "A", {"a", "A"}, 2)};
 
     auto result = slr1.Delta(items, "A");
     
@@ -2250,7 +3333,7 @@ TEST(SLR1_Delta, DeltaFunctionWhenItemAmdSymbolAreEpsilon) {
     SLR1Parser slr1(g);
 
     std::unordered_set<Lr0Item> items = {
-        {"A", {g.st_.EPSILON_}, g.st_.EPSILON_, g.st_.EOL_}};
+        MakeItem(slr1, "A", {g.st_.EPSILON_})};
 
     auto result = slr1.Delta(items, g.st_.EPSILON_);
     
@@ -2278,7 +3361,7 @@ TEST(SLR1_MakeInitialState, BasicGrammar) {
     EXPECT_EQ(initial_state.id_, 0);
 
     std::unordered_set<Lr0Item> expected_items = {
-        {"S", {"a", g.st_.EOL_}, 0, g.st_.EPSILON_, g.st_.EOL_}};
+        MakeItem(slr1, "S", {"a", g.st_.EOL_}, 0)};
 
     EXPECT_EQ(initial_state.items_, expected_items);
 }
@@ -2305,9 +3388,9 @@ TEST(SLR1_MakeInitialState, MultipleAxiomProductions) {
     const auto& initial_state = *states.begin();
 
     std::unordered_set<Lr0Item> expected_items = {
-        {"S", {"E", g.st_.EOL_}, 0, g.st_.EPSILON_, g.st_.EOL_},
-        {"E", {"a"}, 0, g.st_.EOL_, g.st_.EOL_},
-        {"E", {"b"}, 0, g.st_.EOL_, g.st_.EOL_}};
+        MakeItem(slr1, "S", {"E", g.st_.EOL_}, 0),
+        MakeItem(slr1, "E", {"a"}, 0),
+        MakeItem(slr1, "E", {"b"}, 0)};
 
     EXPECT_EQ(initial_state.items_, expected_items);
 }
@@ -2337,9 +3420,9 @@ TEST(SLR1_MakeInitialState, ComplexGrammarWithNullable) {
     const auto& initial_state = *states.begin();
 
     std::unordered_set<Lr0Item> expected_items = {
-        {"S", {"A", "B", g.st_.EOL_}, 0, g.st_.EPSILON_, g.st_.EOL_},
-        {"A", {"a", "A"}, 0, "B", g.st_.EOL_},
-        {"A", {g.st_.EPSILON_}, 1, "B", g.st_.EOL_}};
+        MakeItem(slr1, "S", {"A", "B", g.st_.EOL_}, 0),
+        MakeItem(slr1, "A", {"a", "A"}, 0),
+        MakeItem(slr1, "A", {g.st_.EPSILON_}, 1)};
 
     EXPECT_EQ(initial_state.items_, expected_items);
 }
@@ -2370,11 +3453,11 @@ TEST(SLR1_MakeInitialState, RecursiveGrammar) {
     const auto& initial_state = *states.begin();
 
     std::unordered_set<Lr0Item> expected_items = {
-        {"S", {"E", g.st_.EOL_}, 0, g.st_.EPSILON_, g.st_.EOL_},
-        {"E", {"E", "+", "T"}, 0, g.st_.EOL_, g.st_.EOL_},
-        {"E", {"T"}, 0, g.st_.EOL_, g.st_.EOL_},
-        {"T", {"T", "*", "n"}, 0, "+", g.st_.EOL_},
-        {"T", {"n"}, 0, "+", g.st_.EOL_}};
+        MakeItem(slr1, "S", {"E", g.st_.EOL_}, 0),
+        MakeItem(slr1, "E", {"E", "+", "T"}, 0),
+        MakeItem(slr1, "E", {"T"}, 0),
+        MakeItem(slr1, "T", {"T", "*", "n"}, 0),
+        MakeItem(slr1, "T", {"n"}, 0)};
 
     EXPECT_EQ(initial_state.items_, expected_items);
 }
@@ -2403,10 +3486,36 @@ TEST(SLR1_MakeInitialState, StateIdAndUniqueness) {
     // Verify the state is properly hashed and compared
     state duplicate;
     duplicate.id_ = 0;
-    duplicate.items_.emplace("S", std::vector<std::string>{"a", g.st_.EOL_}, 0,
-                             g.st_.EPSILON_, g.st_.EOL_);
+    duplicate.items_.insert(MakeItem(slr1, "S", {"a", g.st_.EOL_}, 0));
 
-    EXPECT_TRUE(states.contains(duplicate));
+    EXPECT_NE(std::ranges::find(states, duplicate), states.end());
+}
+
+TEST(SLR1_MakeInitialState, MakeParserInternsStatesByKernel) {
+    Grammar g;
+    g.st_.PutSymbol("S", false);
+    g.st_.PutSymbol("A", false);
+    g.st_.PutSymbol("a", true);
+    g.st_.PutSymbol("b", true);
+
+    g.axiom_ = "S";
+    g.AddProduction("S", {"A", g.st_.EOL_});
+    g.AddProduction("A", {"a", "A"});
+    g.AddProduction("A", {"b"});
+
+    SLR1Parser slr1(g);
+    ASSERT_TRUE(slr1.MakeParser());
+
+    // S -> .A $ | A -> a.A | S -> A.$ | A -> b. | S -> A $. | A -> a A.
+    ASSERT_EQ(slr1.states_.size(), 6);
+    for (unsigned int id = 0; id < slr1.states_.size(); ++id) {
+        EXPECT_EQ(slr1.states_[id].id_, id);
+    }
+    const SymbolId a       = slr1.analysis_->cg_.st_.Id("a");
+    const SymbolId b       = slr1.analysis_->cg_.st_.Id("b");
+    unsigned int   after_a = slr1.transitions_[0][a];
+    EXPECT_EQ(slr1.transitions_[after_a][a], after_a);
+    EXPECT_EQ(slr1.transitions_[after_a][b], slr1.transitions_[0][b]);
 }
 
 TEST(SLR1_SolveLRConflicts, AcceptAction) {
@@ -2422,11 +3531,12 @@ TEST(SLR1_SolveLRConflicts, AcceptAction) {
 
     state st;
     st.id_ = 0;
-    st.items_.emplace("S", std::vector<std::string>{"a", g.st_.EOL_}, 2,
-                      g.st_.EPSILON_, g.st_.EOL_); // Complete item
+    st.items_.insert(
+        MakeItem(slr1, "S", {"a", g.st_.EOL_}, 2)); // Complete item
 
     EXPECT_TRUE(slr1.SolveLRConflicts(st));
-    EXPECT_EQ(slr1.actions_[0][g.st_.EOL_].action, SLR1Parser::Action::Accept);
+    EXPECT_EQ(slr1.actions_[0][SymbolTable::EOL_ID_].action,
+              SLR1Parser::Action::Accept);
 }
 
 TEST(SLR1_SolveLRConflicts, BasicReduce) {
@@ -2445,11 +3555,11 @@ TEST(SLR1_SolveLRConflicts, BasicReduce) {
     slr1.ComputeFollowSets();
     state st;
     st.id_ = 0;
-    st.items_.emplace("E", std::vector<std::string>{"a"}, 1, g.st_.EPSILON_,
-                      g.st_.EOL_); // Complete item
+    st.items_.insert(MakeItem(slr1, "E", {"a"}, 1)); // Complete item
 
     EXPECT_TRUE(slr1.SolveLRConflicts(st));
-    EXPECT_EQ(slr1.actions_[0][g.st_.EOL_].action, SLR1Parser::Action::Reduce);
+    EXPECT_EQ(slr1.actions_[0][SymbolTable::EOL_ID_].action,
+              SLR1Parser::Action::Reduce);
 }
 
 TEST(SLR1_SolveLRConflicts, BasicShift) {
@@ -2467,11 +3577,11 @@ TEST(SLR1_SolveLRConflicts, BasicShift) {
 
     state st;
     st.id_ = 0;
-    st.items_.emplace("E", std::vector<std::string>{"a"}, 0, g.st_.EPSILON_,
-                      g.st_.EOL_); // Dot before terminal
+    st.items_.insert(MakeItem(slr1, "E", {"a"}, 0)); // Dot before terminal
 
     EXPECT_TRUE(slr1.SolveLRConflicts(st));
-    EXPECT_EQ(slr1.actions_[0]["a"].action, SLR1Parser::Action::Shift);
+    EXPECT_EQ(slr1.actions_[0][slr1.analysis_->cg_.st_.Id("a")].action,
+              SLR1Parser::Action::Shift);
 }
 
 TEST(SLR1_SolveLRConflicts, SolveShiftReduceConflict) {
@@ -2492,10 +3602,8 @@ TEST(SLR1_SolveLRConflicts, SolveShiftReduceConflict) {
 
     state st;
     st.id_ = 0;
-    st.items_.emplace("E", std::vector<std::string>{"a"}, 1, g.st_.EPSILON_,
-                      g.st_.EOL_);
-    st.items_.emplace("E", std::vector<std::string>{"a", "E"}, 0,
-                      g.st_.EPSILON_, g.st_.EOL_);
+    st.items_.insert(MakeItem(slr1, "E", {"a"}, 1));
+    st.items_.insert(MakeItem(slr1, "E", {"a", "E"}, 0));
 
     EXPECT_TRUE(slr1.SolveLRConflicts(st)); // Should NOT detect conflict
 }
@@ -2520,23 +3628,16 @@ TEST(SLR1_SolveLRConflicts, ShiftReduceConflict) {
     state st;
     st.id_ = 0;
 
-    st.items_.emplace("E", std::vector<std::string>{"a"}, 1, g.st_.EPSILON_,
-                      g.st_.EOL_);
-    st.items_.emplace("E", std::vector<std::string>{"a", "E"}, 1,
-                      g.st_.EPSILON_, g.st_.EOL_);
-    st.items_.emplace("E", std::vector<std::string>{"a"}, 0, g.st_.EPSILON_,
-                      g.st_.EOL_);
-    st.items_.emplace("E", std::vector<std::string>{"a", "E"}, 0,
-                      g.st_.EPSILON_, g.st_.EOL_);
-    st.items_.emplace("E", std::vector<std::string>{"E", "a"}, 0,
-                      g.st_.EPSILON_, g.st_.EOL_);
+    st.items_.insert(MakeItem(slr1, "E", {"a"}, 1));
+    st.items_.insert(MakeItem(slr1, "E", {"a", "E"}, 1));
+    st.items_.insert(MakeItem(slr1, "E", {"a"}, 0));
+    st.items_.insert(MakeItem(slr1, "E", {"a", "E"}, 0));
+    st.items_.insert(MakeItem(slr1, "E", {"E", "a"}, 0));
 
     state st1;
     st.id_ = 1;
-    st.items_.emplace("E", std::vector<std::string>{"a", "E"}, 2,
-                      g.st_.EPSILON_, g.st_.EOL_);
-    st.items_.emplace("E", std::vector<std::string>{"E", "a"}, 1,
-                      g.st_.EPSILON_, g.st_.EOL_);
+    st.items_.insert(MakeItem(slr1, "E", {"a", "E"}, 2));
+    st.items_.insert(MakeItem(slr1, "E", {"E", "a"}, 1));
 
     EXPECT_FALSE(slr1.SolveLRConflicts(st));
     EXPECT_TRUE(slr1.SolveLRConflicts(st1));
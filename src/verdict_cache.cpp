@@ -0,0 +1,327 @@
+#include "verdict_cache.hpp"
+#include "grammar.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+/// @brief Name of every role in the canonical text.
+constexpr char ROLE_NAMES[] = {'$', 'e', 'S', 't', 'n'};
+
+canonical_input MakeInput(const Grammar& gr) {
+    canonical_input                              in;
+    std::unordered_map<std::string, std::uint32_t> ids;
+    const auto id = [&](const std::string& name) {
+        auto [it, inserted] = ids.try_emplace(
+            name, static_cast<std::uint32_t>(in.kinds_.size()));
+        if (inserted) {
+            in.kinds_.push_back(name == gr.st_.EOL_       ? EOL_ROLE
+                                : name == gr.st_.EPSILON_ ? EPSILON_ROLE
+                                : name == gr.axiom_       ? AXIOM_ROLE
+                                : gr.st_.IsTerminal(name) ? TERMINAL_ROLE
+                                                          : NON_TERMINAL_ROLE);
+        }
+        return it->second;
+    };
+    id(gr.axiom_);
+    for (const auto& [nt, prods] : gr.g_) {
+        const std::uint32_t lhs = id(nt);
+        for (const production& prod : prods) {
+            in.lhs_.push_back(lhs);
+            std::vector<std::uint32_t>& rhs = in.rhs_.emplace_back();
+            for (const std::string& symbol : prod) {
+                rhs.push_back(id(symbol));
+            }
+        }
+    }
+    return in;
+}
+
+/// @brief Combines a value into a hash (SplitMix64 finalizer).
+std::uint64_t Mix(std::uint64_t hash, std::uint64_t value) {
+    std::uint64_t z = hash ^ (value + 0x9e3779b97f4a7c15);
+    z               = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+    z               = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+    return z ^ (z >> 31);
+}
+
+/**
+ * @brief Splits colors by the places every symbol occurs in, until no color
+ * splits any more. Colors stay ranks, and a symbol never moves ahead of a
+ * symbol that had a smaller color.
+ *
+ * Places are compared by hash. A collision only keeps two symbols tied, for
+ * Search to tell apart, so it never makes two grammars share a form.
+ */
+void Refine(const canonical_input& in, std::vector<std::uint32_t>& colors) {
+    const std::size_t n = colors.size();
+    std::size_t       count =
+        *std::max_element(colors.begin(), colors.end()) + std::size_t{1};
+    std::vector<std::vector<std::uint64_t>> places(n);
+    std::vector<std::uint64_t>              signatures(n);
+    std::vector<std::uint32_t>              order(n);
+    while (true) {
+        for (auto& p : places) {
+            p.clear();
+        }
+        for (std::size_t p = 0; p < in.lhs_.size(); ++p) {
+            std::uint64_t shape = Mix(0, colors[in.lhs_[p]]);
+            for (std::uint32_t symbol : in.rhs_[p]) {
+                shape = Mix(shape, colors[symbol]);
+            }
+            // Own production, then every position of the right-hand side
+            places[in.lhs_[p]].push_back(Mix(shape, 0));
+            for (std::size_t i = 0; i < in.rhs_[p].size(); ++i) {
+                places[in.rhs_[p][i]].push_back(Mix(shape, i + 1));
+            }
+        }
+        for (std::size_t x = 0; x < n; ++x) {
+            std::ranges::sort(places[x]);
+            signatures[x] = 0;
+            for (std::uint64_t place : places[x]) {
+                signatures[x] = Mix(signatures[x], place);
+            }
+            order[x] = static_cast<std::uint32_t>(x);
+        }
+        const auto key = [&](std::uint32_t x) {
+            return std::pair(colors[x], signatures[x]);
+        };
+        std::ranges::sort(order, {}, key);
+        std::uint32_t              rank = 0;
+        std::vector<std::uint32_t> refined(n);
+        for (std::size_t k = 0; k < n; ++k) {
+            if (k > 0 && key(order[k]) != key(order[k - 1])) {
+                ++rank;
+            }
+            refined[order[k]] = rank;
+        }
+        colors = std::move(refined);
+        if (rank + std::size_t{1} == count) {
+            return;
+        }
+        count = rank + std::size_t{1};
+    }
+}
+
+/**
+ * @brief Writes a grammar whose symbols all have different colors, with
+ * every symbol named by its role and color.
+ */
+std::string Render(const canonical_input&            in,
+                   const std::vector<std::uint32_t>& colors) {
+    const auto name = [&](std::uint32_t x) {
+        return ROLE_NAMES[in.kinds_[x]] + std::to_string(colors[x]);
+    };
+    std::vector<std::string> prods;
+    for (std::size_t p = 0; p < in.lhs_.size(); ++p) {
+        std::string text = name(in.lhs_[p]) + " ->";
+        for (std::uint32_t symbol : in.rhs_[p]) {
+            text += " " + name(symbol);
+        }
+        prods.push_back(std::move(text));
+    }
+    std::ranges::sort(prods);
+    std::string result;
+    for (const std::string& prod : prods) {
+        result += prod + "\n";
+    }
+    return result;
+}
+
+/**
+ * @brief Refines the colors, then tries every symbol of the first tied
+ * color as the smallest one, depth first, keeping the smallest text.
+ */
+void Search(const canonical_input& in, std::vector<std::uint32_t> colors,
+            canonical_labeling& best, std::size_t& leaves) {
+    Refine(in, colors);
+    std::vector<std::uint32_t> sizes(colors.size(), 0);
+    for (std::uint32_t c : colors) {
+        ++sizes[c];
+    }
+    const auto tied = std::ranges::find_if(
+        sizes, [](std::uint32_t size) { return size > 1; });
+    if (tied == sizes.end()) {
+        std::string text = Render(in, colors);
+        if (leaves == 0 || text < best.form_) {
+            best.form_   = std::move(text);
+            best.colors_ = std::move(colors);
+        }
+        ++leaves;
+        return;
+    }
+    const auto cell = static_cast<std::uint32_t>(tied - sizes.begin());
+    for (std::size_t x = 0; x < colors.size(); ++x) {
+        if (colors[x] != cell || leaves >= MAX_CANONICAL_LEAVES) {
+            continue;
+        }
+        std::vector<std::uint32_t> split(colors.size());
+        for (std::size_t y = 0; y < colors.size(); ++y) {
+            split[y] = 2 * colors[y] + (colors[y] == cell && y != x ? 1 : 0);
+        }
+        Search(in, std::move(split), best, leaves);
+    }
+}
+
+/// @brief Bytes of one entry of a saved cache.
+struct saved_entry {
+    std::uint64_t hi_;
+    std::uint64_t lo_;
+    std::uint8_t  infinite_;
+    std::uint8_t  unreachable_;
+    std::uint8_t  left_recursive_;
+    std::uint8_t  ll1_;
+    std::uint8_t  slr1_;
+    std::uint8_t  padding_[3];
+};
+
+constexpr char CACHE_MAGIC[8] = {'G', 'R', 'V', 'E', 'R', 'D', 'C', 'T'};
+
+} // namespace
+
+canonical_labeling CanonicalLabeling(const canonical_input& in,
+                                     bool                   terminals_only) {
+    std::vector<std::uint32_t> colors = in.kinds_;
+    if (terminals_only) {
+        // Every symbol but the terminals gets a color of its own, in the
+        // order of the roles, then of the numbers
+        std::vector<std::uint32_t> order(colors.size());
+        std::iota(order.begin(), order.end(), std::uint32_t{0});
+        const auto key = [&](std::uint32_t x) {
+            return std::pair(in.kinds_[x],
+                             in.kinds_[x] == TERMINAL_ROLE ? 0 : x);
+        };
+        std::ranges::sort(order, {}, key);
+        std::uint32_t rank = 0;
+        for (std::size_t k = 0; k < order.size(); ++k) {
+            if (k > 0 && key(order[k]) != key(order[k - 1])) {
+                ++rank;
+            }
+            colors[order[k]] = rank;
+        }
+    }
+    canonical_labeling best;
+    std::size_t        leaves = 0;
+    Search(in, std::move(colors), best, leaves);
+    return best;
+}
+
+std::string CanonicalForm(const Grammar& gr) {
+    return CanonicalLabeling(MakeInput(gr), false).form_;
+}
+
+grammar_fingerprint Fingerprint(const Grammar& gr) {
+    using u128               = unsigned __int128;
+    constexpr u128 fnv_prime = (u128{1} << 88) + 0x13B;
+    u128           hash      = (u128{0x6c62272e07bb0142} << 64) |
+                    u128{0x62b821756295c58d};
+    for (char c : CanonicalForm(gr)) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= fnv_prime;
+    }
+    return {static_cast<std::uint64_t>(hash >> 64),
+            static_cast<std::uint64_t>(hash)};
+}
+
+VerdictCache::VerdictCache(std::size_t capacity)
+    : shard_capacity_(std::max<std::size_t>(capacity / SHARDS_, 1)),
+      shards_(std::make_unique<shard[]>(SHARDS_)) {}
+
+std::optional<grammar_verdicts>
+VerdictCache::Find(const grammar_fingerprint& fp) {
+    shard&                      s = ShardOf(fp);
+    std::lock_guard<std::mutex> lock(s.mutex_);
+    auto                        it = s.index_.find(fp);
+    if (it == s.index_.end()) {
+        ++misses_;
+        return std::nullopt;
+    }
+    ++hits_;
+    s.recency_.splice(s.recency_.begin(), s.recency_, it->second);
+    return it->second->second;
+}
+
+void VerdictCache::Store(const grammar_fingerprint& fp,
+                         const grammar_verdicts&    v) {
+    shard&                      s = ShardOf(fp);
+    std::lock_guard<std::mutex> lock(s.mutex_);
+    if (auto it = s.index_.find(fp); it != s.index_.end()) {
+        it->second->second = v;
+        s.recency_.splice(s.recency_.begin(), s.recency_, it->second);
+        return;
+    }
+    if (s.index_.size() == shard_capacity_) {
+        s.index_.erase(s.recency_.back().first);
+        s.recency_.pop_back();
+    }
+    s.recency_.emplace_front(fp, v);
+    s.index_.emplace(fp, s.recency_.begin());
+}
+
+std::size_t VerdictCache::Size() const {
+    std::size_t size = 0;
+    for (std::size_t i = 0; i < SHARDS_; ++i) {
+        std::lock_guard<std::mutex> lock(shards_[i].mutex_);
+        size += shards_[i].index_.size();
+    }
+    return size;
+}
+
+void VerdictCache::Save(const std::string& path) const {
+    std::vector<saved_entry> entries;
+    for (std::size_t i = 0; i < SHARDS_; ++i) {
+        std::lock_guard<std::mutex> lock(shards_[i].mutex_);
+        // Least recent first, so that Load restores the order
+        for (auto it = shards_[i].recency_.rbegin();
+             it != shards_[i].recency_.rend(); ++it) {
+            const auto& [fp, v] = *it;
+            entries.push_back({fp.hi_, fp.lo_, v.infinite_, v.unreachable_,
+                               v.left_recursive_, v.ll1_, v.slr1_, {}});
+        }
+    }
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    const std::uint64_t count = entries.size();
+    out.write(CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    out.write(reinterpret_cast<const char*>(&VERSION_), sizeof(VERSION_));
+    out.write(reinterpret_cast<const char*>(&count), sizeof(count));
+    out.write(reinterpret_cast<const char*>(entries.data()),
+              static_cast<std::streamsize>(count * sizeof(saved_entry)));
+    if (!out) {
+        throw std::runtime_error("Cannot write verdict cache: " + path);
+    }
+}
+
+bool VerdictCache::Load(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        return false;
+    }
+    char          magic[sizeof(CACHE_MAGIC)];
+    std::uint32_t version = 0;
+    std::uint64_t count   = 0;
+    in.read(magic, sizeof(magic));
+    in.read(reinterpret_cast<char*>(&version), sizeof(version));
+    in.read(reinterpret_cast<char*>(&count), sizeof(count));
+    if (!in || std::memcmp(magic, CACHE_MAGIC, sizeof(magic)) != 0 ||
+        version != VERSION_) {
+        throw std::runtime_error("Not a verdict cache of version " +
+                                 std::to_string(VERSION_) + ": " + path);
+    }
+    saved_entry entry;
+    for (std::uint64_t i = 0; i < count; ++i) {
+        if (!in.read(reinterpret_cast<char*>(&entry), sizeof(entry))) {
+            throw std::runtime_error("Truncated verdict cache: " + path);
+        }
+        Store({entry.hi_, entry.lo_},
+              {entry.infinite_ != 0, entry.unreachable_ != 0,
+               entry.left_recursive_ != 0, entry.ll1_, entry.slr1_});
+    }
+    return true;
+}